@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cuckoo.h"
+#include "ipt.h"
+
+// Page table lookup benchmark: the flat frames[] scan used by `-pt flat`
+// against the hashed inverted page table used by `-pt inverted` and the
+// cuckoo directory used by `-pt cuckoo`, followed by a cuckoo load-factor
+// sweep on a table that is not allowed to grow.
+//
+// Usage: pt_bench [max_frames] [lookups]
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static unsigned long long rng_state = 0x9e3779b97f4a7c15ULL;
+
+static unsigned long rng_next(void) {
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (unsigned long)(rng_state * 0x2545f4914f6cdd1dULL);
+}
+
+// Sparse vpn for frame i, spread over a 48-bit address space
+static unsigned long vpn_of(int i) {
+    return ((unsigned long)i * 0x9e3779b1UL) & 0xfffffffffUL;
+}
+
+static void bench_flat(int num_frames, long lookups) {
+    long *frames = (long *)malloc((size_t)num_frames * sizeof(long));
+    if (!frames) { perror("flat"); return; }
+    for (int i = 0; i < num_frames; i++) frames[i] = (long)vpn_of(i);
+
+    // A flat scan is O(frames); cap the total work so large sizes finish
+    long max_work = 2000000000L;
+    if (lookups > max_work / num_frames) lookups = max_work / num_frames;
+    if (lookups < 1) lookups = 1;
+
+    long found = 0;
+    double t0 = now_sec();
+    for (long n = 0; n < lookups; n++) {
+        long want = (long)vpn_of((int)(rng_next() % (unsigned long)num_frames));
+        for (int i = 0; i < num_frames; i++) {
+            if (frames[i] == want) { found++; break; }
+        }
+    }
+    double dt = now_sec() - t0;
+
+    printf("%-9s %10d %12ld %12.1f %14.2f %8.1f\n", "flat", num_frames,
+           lookups, dt * 1e9 / (double)lookups,
+           (double)lookups / dt / 1e6, (double)sizeof(long));
+    if (found != lookups) fprintf(stderr, "flat: lost lookups\n");
+    free(frames);
+}
+
+static void bench_inverted(int num_frames, long lookups) {
+    InvertedPageTable ipt;
+    FrameTable ft;
+    if (ft_init(&ft, num_frames, 0, 0) != 0) { perror("inverted"); return; }
+    if (ipt_init(&ipt, num_frames) != 0) { perror("inverted"); ft_free(&ft); return; }
+    for (int i = 0; i < num_frames; i++) {
+        ft_set_vpn(&ft, i, (long)vpn_of(i));
+        ipt_map(&ipt, i, vpn_of(i));
+    }
+
+    long found = 0;
+    double t0 = now_sec();
+    for (long n = 0; n < lookups; n++) {
+        unsigned long want = vpn_of((int)(rng_next() % (unsigned long)num_frames));
+        if (ipt_lookup(&ipt, &ft, want) != -1) found++;
+    }
+    double dt = now_sec() - t0;
+
+    printf("%-9s %10d %12ld %12.1f %14.2f %8.1f\n", "inverted", num_frames,
+           lookups, dt * 1e9 / (double)lookups,
+           (double)lookups / dt / 1e6,
+           (double)ipt_bytes(&ipt) / (double)num_frames);
+    if (found != lookups) fprintf(stderr, "inverted: lost lookups\n");
+    ipt_free(&ipt);
+    ft_free(&ft);
+}
+
+static void bench_cuckoo(int num_frames, long lookups) {
+    CuckooMap dir;
+    if (cuckoo_init(&dir, (size_t)num_frames) != 0) { perror("cuckoo"); return; }
+    for (int i = 0; i < num_frames; i++) cuckoo_insert(&dir, vpn_of(i), i);
+
+    long found = 0;
+    double t0 = now_sec();
+    for (long n = 0; n < lookups; n++) {
+        unsigned long want = vpn_of((int)(rng_next() % (unsigned long)num_frames));
+        if (cuckoo_find(&dir, want) != -1) found++;
+    }
+    double dt = now_sec() - t0;
+
+    printf("%-9s %10d %12ld %12.1f %14.2f %8.1f\n", "cuckoo", num_frames,
+           lookups, dt * 1e9 / (double)lookups,
+           (double)lookups / dt / 1e6,
+           (double)cuckoo_bytes(&dir) / (double)num_frames);
+    if (found != lookups) fprintf(stderr, "cuckoo: lost lookups\n");
+    cuckoo_free(&dir);
+}
+
+// Fill a fixed-size table step by step and time hits and misses at each
+// load factor, up to the point where the first insert fails.
+static void bench_cuckoo_load(int slots, long lookups) {
+    CuckooMap m;
+    if (cuckoo_init(&m, (size_t)slots) != 0) { perror("cuckoo"); return; }
+    m.fixed = 1;
+
+    size_t cap = (size_t)(m.mask + 1) * CUCKOO_WAYS;
+    const double steps[] = { 0.50, 0.75, 0.90, 0.95, 0.98, 1.00 };
+    int n = 0;
+
+    printf("\n%-6s %10s %12s %12s\n", "load", "keys", "hit ns", "miss ns");
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        int full = 0;
+        while ((double)n < steps[s] * (double)cap) {
+            if (cuckoo_insert(&m, vpn_of(n), n) != 0) { full = 1; break; }
+            n++;
+        }
+        if (n == 0) break;
+
+        double t0 = now_sec();
+        long found = 0;
+        for (long k = 0; k < lookups; k++) {
+            if (cuckoo_find(&m, vpn_of((int)(rng_next() % (unsigned long)n))) != -1) found++;
+        }
+        double hit_ns = (now_sec() - t0) * 1e9 / (double)lookups;
+
+        t0 = now_sec();
+        for (long k = 0; k < lookups; k++) {
+            if (cuckoo_find(&m, vpn_of(n + (int)(rng_next() % 1000000UL))) != -1) found--;
+        }
+        double miss_ns = (now_sec() - t0) * 1e9 / (double)lookups;
+
+        printf("%-6.3f %10d %12.1f %12.1f\n", cuckoo_load(&m), n, hit_ns, miss_ns);
+        if (found != lookups) fprintf(stderr, "cuckoo: wrong lookups\n");
+        if (full) {
+            printf("first failed insert at load %.3f\n", cuckoo_load(&m));
+            break;
+        }
+    }
+    cuckoo_free(&m);
+}
+
+int main(int argc, char *argv[]) {
+    int max_frames = (argc > 1) ? atoi(argv[1]) : (1 << 22);
+    long lookups   = (argc > 2) ? atol(argv[2]) : 10000000L;
+    if (max_frames <= 0 || lookups <= 0) {
+        fprintf(stderr, "Usage: %s [max_frames] [lookups]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-9s %10s %12s %12s %14s %8s\n", "table", "frames", "lookups",
+           "ns/lookup", "Mlookups/s", "B/frame");
+    for (int frames = 1024; frames > 0 && frames <= max_frames; frames *= 16) {
+        bench_flat(frames, lookups);
+        bench_inverted(frames, lookups);
+        bench_cuckoo(frames, lookups);
+    }
+
+    bench_cuckoo_load(max_frames, lookups);
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Least-frequently-used replacement as a policy plugin. Each frame counts
+// the accesses to its current page; the page with the fewest goes, the
+// longest resident one on a tie. Optional argument: halve all counts every
+// N faults, so pages that were hot long ago can age out ("lfu.so:4096").
+//
+//     make plugins && ./ossim -a plugin:build/lfu.so trace.txt
+
+#include <stdlib.h>
+
+#include "policy.h"
+
+typedef struct {
+    int n;
+    unsigned long *count;
+    unsigned long *loaded;  // tick the page was faulted in
+    long decay, faults;
+} Lfu;
+
+static void *lfu_create(int num_frames, const char *args) {
+    Lfu *l = (Lfu *)calloc(1, sizeof(Lfu));
+    if (!l) return NULL;
+    l->n = num_frames;
+    l->decay = atol(args);
+    l->count = (unsigned long *)calloc((size_t)num_frames, sizeof(unsigned long));
+    l->loaded = (unsigned long *)calloc((size_t)num_frames, sizeof(unsigned long));
+    if (!l->count || !l->loaded || l->decay < 0) {
+        free(l->count);
+        free(l->loaded);
+        free(l);
+        return NULL;
+    }
+    return l;
+}
+
+static void lfu_destroy(void *state) {
+    Lfu *l = (Lfu *)state;
+    free(l->count);
+    free(l->loaded);
+    free(l);
+}
+
+static inline void lfu_hit(void *state, const PolicyEvent *e) {
+    ((Lfu *)state)->count[e->frame] += e->count;
+}
+
+static inline void lfu_fault(void *state, const PolicyEvent *e) {
+    Lfu *l = (Lfu *)state;
+    l->count[e->frame] = e->count;
+    l->loaded[e->frame] = e->tick;
+    if (l->decay > 0 && ++l->faults % l->decay == 0) {
+        for (int f = 0; f < l->n; f++) l->count[f] >>= 1;
+    }
+}
+
+static inline void lfu_evict(void *state, const PolicyEvent *e) {
+    ((Lfu *)state)->count[e->frame] = 0;
+}
+
+OSSIM_POLICY_BATCH(lfu_batch, lfu_hit, lfu_fault, lfu_evict)
+
+static int lfu_choose_victim(void *state, unsigned long tick) {
+    Lfu *l = (Lfu *)state;
+    (void)tick;
+    int victim = 0;
+    for (int f = 1; f < l->n; f++) {
+        if (l->count[f] < l->count[victim] ||
+            (l->count[f] == l->count[victim] && l->loaded[f] < l->loaded[victim])) {
+            victim = f;
+        }
+    }
+    return victim;
+}
+
+static const OssimPolicy lfu_policy = {
+    .abi = OSSIM_POLICY_ABI,
+    .name = "LFU",
+    .create = lfu_create,
+    .destroy = lfu_destroy,
+    .choose_victim = lfu_choose_victim,
+    .on_batch = lfu_batch,
+};
+
+const OssimPolicy *ossim_policy(void) {
+    return &lfu_policy;
+}
@@ -0,0 +1,61 @@
+// LRU as a policy plugin, written with the per-event hooks. It makes the
+// same choices as the built-in -a lru, so it doubles as a check of the
+// plugin interface:
+//
+//     make plugins && ./ossim -a plugin:build/lru.so trace.txt
+
+#include <stdlib.h>
+
+#include "policy.h"
+
+typedef struct {
+    int n;
+    unsigned long *last_used;
+} Lru;
+
+static void *lru_create(int num_frames, const char *args) {
+    (void)args;
+    Lru *l = (Lru *)malloc(sizeof(Lru));
+    if (!l) return NULL;
+    l->n = num_frames;
+    l->last_used = (unsigned long *)calloc((size_t)num_frames, sizeof(unsigned long));
+    if (!l->last_used) {
+        free(l);
+        return NULL;
+    }
+    return l;
+}
+
+static void lru_destroy(void *state) {
+    Lru *l = (Lru *)state;
+    free(l->last_used);
+    free(l);
+}
+
+static void lru_touch(void *state, const PolicyEvent *e) {
+    ((Lru *)state)->last_used[e->frame] = e->tick;
+}
+
+static int lru_choose_victim(void *state, unsigned long tick) {
+    Lru *l = (Lru *)state;
+    (void)tick;
+    int victim = 0;
+    for (int f = 1; f < l->n; f++) {
+        if (l->last_used[f] < l->last_used[victim]) victim = f;
+    }
+    return victim;
+}
+
+static const OssimPolicy lru_policy = {
+    .abi = OSSIM_POLICY_ABI,
+    .name = "LRU (plugin)",
+    .create = lru_create,
+    .destroy = lru_destroy,
+    .choose_victim = lru_choose_victim,
+    .on_hit = lru_touch,
+    .on_fault = lru_touch,
+};
+
+const OssimPolicy *ossim_policy(void) {
+    return &lru_policy;
+}
@@ -0,0 +1,237 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cstack.h"
+#include "sim.h"
+
+// ---- Counter stack ----
+
+static int push(CounterStack *s) {
+    if (s->n == s->cap) {
+        int cap = s->cap ? s->cap * 2 : 64;
+        Hll *c = (Hll *)realloc(s->c, (size_t)cap * sizeof(Hll));
+        if (c) s->c = c;
+        double *last = (double *)realloc(s->last, (size_t)cap * sizeof(double));
+        if (last) s->last = last;
+        if (!c || !last) return -1;
+        s->cap = cap;
+    }
+    if (hll_init(&s->c[s->n]) != 0) return -1;
+    s->last[s->n] = 0.0;
+    s->n++;
+    return 0;
+}
+
+int cstack_init(CounterStack *s) {
+    CounterStack zero = {0};
+    *s = zero;
+    return push(s);
+}
+
+void cstack_free(CounterStack *s) {
+    for (int i = 0; i < s->n; i++) hll_free(&s->c[i]);
+    free(s->c);
+    free(s->last);
+
+    CounterStack zero = {0};
+    *s = zero;
+}
+
+void cstack_access(CounterStack *s, unsigned long key) {
+    int idx, rank;
+    hll_slot(hll_hash(key), &idx, &rank);
+    // Older counters hold every register at least as high as newer ones
+    for (int i = s->n - 1; i >= 0; i--)
+        if (!hll_raise(&s->c[i], idx, rank)) break;
+}
+
+static int bucket(double depth) {
+    if (depth <= 1.0) return 0;
+    int b = (int)ceil(log2(depth));
+    return b < CSTACK_BUCKETS ? b : CSTACK_BUCKETS - 1;
+}
+
+int cstack_step(CounterStack *s, long accesses, MrcWindow *w) {
+    double grew_older = 0.0, count_older = 0.0;
+    for (int i = 0; i < s->n; i++) {
+        double count = hll_count(&s->c[i]);
+        double grew = count - s->last[i];
+        // The depth lies between the two counts; take the midpoint
+        if (i == 0) w->cold += grew;
+        else w->hist[bucket(0.5 * (count_older + count))] += grew - grew_older;
+        grew_older = grew;
+        count_older = count;
+        s->last[i] = count;
+    }
+    w->hist[bucket(0.5 * (1.0 + count_older))] += (double)accesses - grew_older;
+
+    int k = 1;
+    for (int i = 1; i < s->n; i++) {
+        if (s->last[i] >= (1.0 - CSTACK_PRUNE) * s->last[k - 1]) {
+            hll_free(&s->c[i]);
+            continue;
+        }
+        s->c[k] = s->c[i];
+        s->last[k] = s->last[i];
+        k++;
+    }
+    s->n = k;
+    return push(s);
+}
+
+// ---- Windowed report ----
+
+// Fault rates at 1, 2, 4 ... frames. Counter noise can make a larger memory
+// look worse than a smaller one, which LRU never is; the row is kept
+// non-increasing.
+static void fault_rates(const MrcWindow *w, double *rate) {
+    double faults = w->cold;
+    for (int b = 1; b < CSTACK_BUCKETS; b++) faults += w->hist[b];
+    double prev = 1.0;
+    for (int b = 0; b < CSTACK_BUCKETS; b++) {
+        double r = w->accesses > 0 ? faults / (double)w->accesses : 0.0;
+        r = r < 0.0 ? 0.0 : r > prev ? prev : r;
+        rate[b] = prev = r;
+        if (b + 1 < CSTACK_BUCKETS) faults -= w->hist[b + 1];
+    }
+}
+
+// Largest label: 20 digits, a suffix and the terminator
+#define LABEL_LEN 24
+
+static void size_label(char *buf, size_t len, int b) {
+    if (b >= 20) snprintf(buf, len, "%luM", 1UL << (b - 20));
+    else if (b >= 10) snprintf(buf, len, "%luK", 1UL << (b - 10));
+    else snprintf(buf, len, "%lu", 1UL << b);
+}
+
+// Reuses within a step all get about half the newest counter's count, which
+// can be anything up to the step, so sizes below the step are not resolved;
+// the bucket of the first size that is
+static int first_bucket(long step) {
+    int b = 0;
+    while (b < CSTACK_BUCKETS - 1 && (1L << b) < step) b++;
+    return b;
+}
+
+static void print_windows(const MrcWindow *win, int nwin, long window, long step,
+                          int max_counters) {
+    // Columns from the step's resolution up to the first size that holds
+    // every window's reuses
+    int first = first_bucket(step), top = first;
+    for (int w = 0; w < nwin; w++)
+        for (int b = 0; b < CSTACK_BUCKETS; b++)
+            if (win[w].hist[b] >= 0.5 && b > top) top = b;
+
+    printf("\n--- Windowed miss ratio curves (LRU) ---\n");
+    printf("Windows: %d of %ld accesses, up to %d counters (%d KB)\n", nwin, window,
+           max_counters, max_counters * HLL_REGS / 1024);
+    if (first > 0)
+        printf("Sizes from %lu frames: steps of %ld accesses leave smaller ones unresolved\n",
+               1UL << first, step);
+    printf("Fault rate (%%) by window and memory size in frames:\n");
+    printf("%12s %9s", "start", "pages");
+    for (int b = first; b <= top; b++) {
+        char label[LABEL_LEN];
+        size_label(label, sizeof label, b);
+        printf(" %6s", label);
+    }
+    printf("\n");
+    long long start = 0;
+    for (int w = 0; w < nwin; w++) {
+        double rate[CSTACK_BUCKETS];
+        fault_rates(&win[w], rate);
+        printf("%12lld %9.0f", start, win[w].pages);
+        for (int b = first; b <= top; b++) printf(" %6.1f", 100.0 * rate[b]);
+        printf("\n");
+        start += win[w].accesses;
+    }
+}
+
+static int write_csv(const char *path, const MrcWindow *win, int nwin, long step) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror("Error opening curve output");
+        return -1;
+    }
+    int first = first_bucket(step);
+    fprintf(out, "start,accesses,pages");
+    for (int b = first; b < CSTACK_BUCKETS; b++) fprintf(out, ",%lu", 1UL << b);
+    fprintf(out, "\n");
+    long long start = 0;
+    for (int w = 0; w < nwin; w++) {
+        double rate[CSTACK_BUCKETS];
+        fault_rates(&win[w], rate);
+        fprintf(out, "%lld,%lld,%.0f", start, win[w].accesses, win[w].pages);
+        for (int b = first; b < CSTACK_BUCKETS; b++) fprintf(out, ",%.6f", rate[b]);
+        fprintf(out, "\n");
+        start += win[w].accesses;
+    }
+    fclose(out);
+    printf("Wrote %d windows to %s\n", nwin, path);
+    return 0;
+}
+
+int cstack_run(TraceReader *tr, long window, long step, const char *csv_path) {
+    CounterStack s;
+    Hll pages = {0};
+    if (cstack_init(&s) != 0 || hll_init(&pages) != 0) {
+        perror("Error allocating counter stack");
+        cstack_free(&s);
+        return -1;
+    }
+
+    MrcWindow *win = NULL, zero = {0}, cur = zero;
+    int nwin = 0, cap = 0, max_counters = 1, rc = 0;
+    long in_step = 0;
+    TraceRecord rec;
+    for (;;) {
+        int more = trace_next(tr, &rec);
+        if (more) {
+            if (rec.op != 'R' && rec.op != 'W') continue;
+            unsigned long key = rec.addr / PAGE_SIZE;
+            cstack_access(&s, key);
+            hll_add(&pages, key);
+            in_step++;
+            cur.accesses += (long long)rec.count;
+            cur.hist[0] += (double)(rec.count - 1);     // the rest of a run
+        }
+        int end_window = cur.accesses >= window || (!more && cur.accesses > 0);
+        if (in_step > 0 && (in_step == step || end_window)) {
+            if (s.n > max_counters) max_counters = s.n;
+            if (cstack_step(&s, in_step, &cur) != 0) {
+                rc = -1;
+                break;
+            }
+            in_step = 0;
+        }
+        if (end_window) {
+            if (nwin == cap) {
+                cap = cap ? cap * 2 : 64;
+                MrcWindow *grown = (MrcWindow *)realloc(win, (size_t)cap * sizeof(MrcWindow));
+                if (!grown) {
+                    rc = -1;
+                    break;
+                }
+                win = grown;
+            }
+            cur.pages = hll_count(&pages);
+            win[nwin++] = cur;
+            cur = zero;
+            hll_reset(&pages);
+        }
+        if (!more) break;
+    }
+
+    if (rc != 0) {
+        perror("Error growing counter stack");
+    } else {
+        print_windows(win, nwin, window, step, max_counters);
+        if (csv_path) rc = write_csv(csv_path, win, nwin, step);
+    }
+    free(win);
+    hll_free(&pages);
+    cstack_free(&s);
+    return rc;
+}
@@ -0,0 +1,53 @@
+#ifndef CSTACK_H
+#define CSTACK_H
+
+#include "hll.h"
+#include "trace.h"
+
+// Windowed miss ratio curves from counter stacks (Wires et al.), in memory
+// that does not grow with the trace. A new HyperLogLog counter starts every
+// step accesses and counts the distinct pages seen since. Counters only
+// grow, and every counter started before another one has counted all of
+// its pages too. During a step, the accesses a counter did not count but
+// the next newer one did are reuses of pages last used between the two
+// counters' starts: their LRU stack depth is about the older counter's
+// count. Accesses new even to the oldest counter are cold misses, and
+// those not new to the newest one are reuses within the step.
+//
+// A counter whose count comes within a small fraction of the next older
+// one tells the two apart for too few pages and is dropped, which bounds
+// the stack to O(log(footprint) / fraction) counters.
+//
+// Depths are binned by powers of two for each window of accesses, giving
+// fault rates over time at power-of-two memory sizes.
+
+#define CSTACK_BUCKETS 41       // depth <= 1, (1,2], (2,4] ... (2^39, 2^40]
+#define CSTACK_PRUNE   0.02
+
+typedef struct {
+    Hll *c;                     // counters, oldest first
+    double *last;               // count at the end of the previous step
+    int n, cap;
+} CounterStack;
+
+typedef struct {
+    long long accesses;
+    double pages;               // distinct pages in the window
+    double cold;
+    double hist[CSTACK_BUCKETS];    // accesses by depth bucket
+} MrcWindow;
+
+int  cstack_init(CounterStack *s);
+void cstack_free(CounterStack *s);
+
+void cstack_access(CounterStack *s, unsigned long key);
+
+// Ends a step of `accesses` accesses: bins their depths into w, prunes and
+// starts the next counter
+int  cstack_step(CounterStack *s, long accesses, MrcWindow *w);
+
+// -mrc-window: curves for every `window` accesses, counters every `step`;
+// a fault-rate matrix on stdout and, if csv_path is set, in CSV
+int  cstack_run(TraceReader *tr, long window, long step, const char *csv_path);
+
+#endif
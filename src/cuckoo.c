@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) && defined(__x86_64__)
+#include <emmintrin.h>
+#define CUCKOO_SSE2 1
+#endif
+
+#include "cuckoo.h"
+
+#define CUCKOO_MAX_KICKS 500
+
+static unsigned long long cuckoo_hash(unsigned long key) {
+    unsigned long long h = (unsigned long long)key;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// The two candidate buckets come from the two halves of one 64-bit hash
+static unsigned long bucket1(const CuckooMap *m, unsigned long key) {
+    return (unsigned long)cuckoo_hash(key) & m->mask;
+}
+
+static unsigned long bucket2(const CuckooMap *m, unsigned long key) {
+    return (unsigned long)(cuckoo_hash(key) >> 32) & m->mask;
+}
+
+// Index of key within the bucket, or -1. Compares all four ways at once.
+static int bucket_find(const CuckooBucket *b, unsigned long key) {
+#ifdef CUCKOO_SSE2
+    __m128i k  = _mm_set1_epi64x((long long)key);
+    __m128i lo = _mm_cmpeq_epi32(_mm_load_si128((const __m128i *)&b->keys[0]), k);
+    __m128i hi = _mm_cmpeq_epi32(_mm_load_si128((const __m128i *)&b->keys[2]), k);
+    // A 64-bit lane matches only if both of its 32-bit halves matched
+    lo = _mm_and_si128(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_and_si128(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+    int bits = _mm_movemask_pd(_mm_castsi128_pd(lo)) |
+               (_mm_movemask_pd(_mm_castsi128_pd(hi)) << 2);
+    return bits ? __builtin_ctz((unsigned int)bits) : -1;
+#else
+    for (int w = 0; w < CUCKOO_WAYS; w++) {
+        if (b->keys[w] == key) return w;
+    }
+    return -1;
+#endif
+}
+
+static int alloc_buckets(CuckooMap *m, unsigned long nbuckets) {
+    m->buckets = (CuckooBucket *)aligned_alloc(64, nbuckets * sizeof(CuckooBucket));
+    if (!m->buckets) return -1;
+    for (unsigned long i = 0; i < nbuckets; i++) {
+        for (int w = 0; w < CUCKOO_WAYS; w++) {
+            m->buckets[i].keys[w] = CUCKOO_EMPTY_KEY;
+            m->buckets[i].vals[w] = -1;
+        }
+    }
+    m->mask  = nbuckets - 1;
+    m->count = 0;
+    return 0;
+}
+
+int cuckoo_init(CuckooMap *m, size_t capacity) {
+    unsigned long nbuckets = 2;
+    while ((double)nbuckets * CUCKOO_WAYS * 0.9 < (double)capacity) nbuckets <<= 1;
+
+    memset(m, 0, sizeof(*m));
+    m->rng = 0x9e3779b97f4a7c15ULL;
+    return alloc_buckets(m, nbuckets);
+}
+
+void cuckoo_free(CuckooMap *m) {
+    free(m->buckets);
+    m->buckets = NULL;
+    m->count = 0;
+}
+
+int cuckoo_find(const CuckooMap *m, unsigned long key) {
+    const CuckooBucket *b = &m->buckets[bucket1(m, key)];
+    int w = bucket_find(b, key);
+    if (w >= 0) return b->vals[w];
+
+    b = &m->buckets[bucket2(m, key)];
+    w = bucket_find(b, key);
+    return (w >= 0) ? b->vals[w] : -1;
+}
+
+static int place_empty(CuckooBucket *b, unsigned long key, int val) {
+    int w = bucket_find(b, CUCKOO_EMPTY_KEY);
+    if (w < 0) return 0;
+    b->keys[w] = key;
+    b->vals[w] = val;
+    return 1;
+}
+
+// Random-walk relocation. Every displacement is recorded so a failed walk
+// can be undone and leave the table exactly as it was.
+static int relocate(CuckooMap *m, unsigned long key, int val) {
+    unsigned long path_bucket[CUCKOO_MAX_KICKS];
+    int path_way[CUCKOO_MAX_KICKS];
+    unsigned long b = bucket1(m, key);
+
+    for (int n = 0; n < CUCKOO_MAX_KICKS; n++) {
+        m->rng ^= m->rng >> 12;
+        m->rng ^= m->rng << 25;
+        m->rng ^= m->rng >> 27;
+        int w = (int)((m->rng * 0x2545f4914f6cdd1dULL) >> 62);
+
+        CuckooBucket *bk = &m->buckets[b];
+        unsigned long k2 = bk->keys[w];
+        int v2 = bk->vals[w];
+        bk->keys[w] = key;
+        bk->vals[w] = val;
+        path_bucket[n] = b;
+        path_way[n] = w;
+        key = k2;
+        val = v2;
+
+        unsigned long b1 = bucket1(m, key);
+        b = (b1 == b) ? bucket2(m, key) : b1;
+        if (place_empty(&m->buckets[b], key, val)) return 0;
+    }
+
+    for (int n = CUCKOO_MAX_KICKS - 1; n >= 0; n--) {
+        CuckooBucket *bk = &m->buckets[path_bucket[n]];
+        unsigned long k2 = bk->keys[path_way[n]];
+        int v2 = bk->vals[path_way[n]];
+        bk->keys[path_way[n]] = key;
+        bk->vals[path_way[n]] = val;
+        key = k2;
+        val = v2;
+    }
+    return -1;
+}
+
+static int grow(CuckooMap *m) {
+    CuckooBucket *old = m->buckets;
+    unsigned long old_n = m->mask + 1;
+
+    if (alloc_buckets(m, old_n * 2) != 0) {
+        m->buckets = old;
+        m->mask = old_n - 1;
+        return -1;
+    }
+    for (unsigned long i = 0; i < old_n; i++) {
+        for (int w = 0; w < CUCKOO_WAYS; w++) {
+            if (old[i].keys[w] != CUCKOO_EMPTY_KEY) {
+                cuckoo_insert(m, old[i].keys[w], old[i].vals[w]);
+            }
+        }
+    }
+    free(old);
+    return 0;
+}
+
+int cuckoo_insert(CuckooMap *m, unsigned long key, int val) {
+    for (;;) {
+        CuckooBucket *b1 = &m->buckets[bucket1(m, key)];
+        CuckooBucket *b2 = &m->buckets[bucket2(m, key)];
+        int w;
+
+        if ((w = bucket_find(b1, key)) >= 0) { b1->vals[w] = val; return 0; }
+        if ((w = bucket_find(b2, key)) >= 0) { b2->vals[w] = val; return 0; }
+
+        if (place_empty(b1, key, val) || place_empty(b2, key, val) ||
+            relocate(m, key, val) == 0) {
+            m->count++;
+            return 0;
+        }
+        // A fixed table reports being full so it can be measured at any load
+        if (m->fixed || grow(m) != 0) return -1;
+    }
+}
+
+void cuckoo_erase(CuckooMap *m, unsigned long key) {
+    CuckooBucket *b = &m->buckets[bucket1(m, key)];
+    int w = bucket_find(b, key);
+    if (w < 0) {
+        b = &m->buckets[bucket2(m, key)];
+        w = bucket_find(b, key);
+    }
+    if (w < 0) return;
+
+    b->keys[w] = CUCKOO_EMPTY_KEY;
+    b->vals[w] = -1;
+    m->count--;
+}
+
+double cuckoo_load(const CuckooMap *m) {
+    return (double)m->count / (double)((m->mask + 1) * CUCKOO_WAYS);
+}
+
+size_t cuckoo_bytes(const CuckooMap *m) {
+    return (size_t)(m->mask + 1) * sizeof(CuckooBucket);
+}
@@ -0,0 +1,44 @@
+#ifndef CUCKOO_H
+#define CUCKOO_H
+
+#include <stddef.h>
+
+// Bucketized cuckoo hash map from a 64-bit key (a vpn) to an int (a frame
+// or TLB slot). Each key lives in one of two 4-way buckets, and a bucket
+// fills exactly one cache line, so a lookup reads at most two lines no
+// matter how full the table is. Inserts relocate keys between their two
+// buckets and grow the table only when a bounded relocation walk fails.
+
+#define CUCKOO_WAYS      4
+#define CUCKOO_EMPTY_KEY (~0UL)
+
+typedef struct {
+    unsigned long keys[CUCKOO_WAYS];
+    int vals[CUCKOO_WAYS];
+    char pad[64 - CUCKOO_WAYS * (sizeof(unsigned long) + sizeof(int))];
+} __attribute__((aligned(64))) CuckooBucket;
+
+typedef struct {
+    CuckooBucket *buckets;
+    unsigned long mask;       // bucket count - 1 (power of two)
+    size_t count;             // stored keys
+    int fixed;                // if set, inserts fail instead of growing (the
+                              // load-factor sweep in bench/pt_bench.c)
+    unsigned long long rng;   // victim choice during relocation walks
+} CuckooMap;
+
+// Sizes the table for `capacity` keys at ~90% load.
+int  cuckoo_init(CuckooMap *m, size_t capacity);
+void cuckoo_free(CuckooMap *m);
+
+// Returns the value stored for key, or -1 if absent.
+int  cuckoo_find(const CuckooMap *m, unsigned long key);
+
+// Inserts or updates key. Returns -1 only if the table is full and fixed.
+int  cuckoo_insert(CuckooMap *m, unsigned long key, int val);
+void cuckoo_erase(CuckooMap *m, unsigned long key);
+
+double cuckoo_load(const CuckooMap *m);
+size_t cuckoo_bytes(const CuckooMap *m);
+
+#endif
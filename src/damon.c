@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "damon.h"
+#include "sim.h"
+
+// Above this many pages, accuracy is judged on a random sample of them
+#define DAMON_EVAL_PAGES 4096
+
+void damon_config_defaults(DamonConfig *dc) {
+    dc->sample_interval = 100;
+    dc->aggr_samples = 20;
+    dc->min_regions = 10;
+    dc->max_regions = 1000;
+    dc->gap = 4096;         // 16 MB
+    dc->cold_aggrs = 0;
+}
+
+int damon_init(Damon *d, const DamonConfig *dc, int num_frames) {
+    Damon zero = {0};
+    *d = zero;
+    d->cfg = *dc;
+    d->rng = 0x9e3779b97f4a7c15ULL;
+    d->next_sample = (unsigned long)dc->sample_interval;
+
+    // Splitting builds the new list next to the old one
+    d->regions = (DamonRegion *)malloc(2 * (size_t)dc->max_regions * sizeof(DamonRegion));
+    d->young = (unsigned char *)calloc((size_t)num_frames, 1);
+    if (!d->regions || !d->young || cuckoo_init(&d->pages, 1024) != 0) {
+        damon_free(d);
+        return -1;
+    }
+    return 0;
+}
+
+void damon_free(Damon *d) {
+    free(d->regions);
+    free(d->young);
+    cuckoo_free(&d->pages);
+    free(d->key);
+    free(d->last_aggr);
+    free(d->reclaimed_at);
+
+    Damon zero = {0};
+    *d = zero;
+}
+
+static unsigned long long next_rand(Damon *d) {
+    d->rng ^= d->rng >> 12;
+    d->rng ^= d->rng << 25;
+    d->rng ^= d->rng >> 27;
+    return d->rng * 0x2545f4914f6cdd1dULL;
+}
+
+static unsigned long region_pages(const DamonRegion *r) {
+    return r->end - r->start + 1;
+}
+
+// Index of the region holding key, or -1
+static int find_region(const Damon *d, unsigned long key) {
+    int lo = 0, hi = d->nregions;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (d->regions[mid].start <= key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo > 0 && key <= d->regions[lo - 1].end) return lo - 1;
+    return -1;
+}
+
+// Picks a new page to watch in r and clears its accessed bit
+static void arm(Simulator *sim, Damon *d, DamonRegion *r) {
+    r->sample = r->start + (unsigned long)(next_rand(d) % region_pages(r));
+    int f = sim_frame_of(sim, r->sample);
+    if (f >= 0) d->young[f] = 0;
+}
+
+// ---- Address space ----
+
+static int grow(void **p, int cap, size_t elem) {
+    void *q = realloc(*p, (size_t)cap * elem);
+    if (!q) return -1;
+    *p = q;
+    return 0;
+}
+
+void damon_new_page(Damon *d, unsigned long key) {
+    if (cuckoo_find(&d->pages, key) < 0) {
+        if (d->npages == d->pages_cap) {
+            int cap = d->pages_cap ? d->pages_cap * 2 : 1024;
+            if (grow((void **)&d->key, cap, sizeof(unsigned long)) != 0 ||
+                grow((void **)&d->last_aggr, cap, sizeof(long long)) != 0 ||
+                grow((void **)&d->reclaimed_at, cap, sizeof(long long)) != 0) {
+                return;
+            }
+            d->pages_cap = cap;
+        }
+        int i = d->npages++;
+        d->key[i] = key;
+        d->last_aggr[i] = -1;
+        d->reclaimed_at[i] = -1;
+        cuckoo_insert(&d->pages, key, i);
+    }
+
+    // First region starting after key, and the one before it
+    int lo = 0, hi = d->nregions;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (d->regions[mid].start <= key) lo = mid + 1;
+        else hi = mid;
+    }
+    DamonRegion *left = (lo > 0) ? &d->regions[lo - 1] : NULL;
+    DamonRegion *right = (lo < d->nregions) ? &d->regions[lo] : NULL;
+    if (left && key <= left->end) return;
+
+    // Grow the nearer region over a small gap; start a new one otherwise
+    unsigned long dl = left ? key - left->end : ~0UL;
+    unsigned long dr = right ? right->start - key : ~0UL;
+    unsigned long dmin = (dl < dr) ? dl : dr;
+    if (d->nregions > 0 &&
+        (dmin <= (unsigned long)d->cfg.gap || d->nregions == d->cfg.max_regions)) {
+        if (dl <= dr) left->end = key;
+        else right->start = key;
+        return;
+    }
+
+    memmove(&d->regions[lo + 1], &d->regions[lo],
+            (size_t)(d->nregions - lo) * sizeof(DamonRegion));
+    DamonRegion r = { key, key, key, 0, 0, 0 };
+    d->regions[lo] = r;
+    d->nregions++;
+}
+
+void damon_access(Damon *d, int f, unsigned long key) {
+    d->young[f] = 1;
+    int i = cuckoo_find(&d->pages, key);
+    if (i >= 0) d->last_aggr[i] = d->aggr_id;
+}
+
+void damon_fault(Damon *d, unsigned long key) {
+    int i = cuckoo_find(&d->pages, key);
+    if (i >= 0 && d->reclaimed_at[i] >= 0) {
+        d->refaults++;
+        d->reclaimed_at[i] = -1;
+    }
+}
+
+// ---- Sampling ----
+
+static void sample(Simulator *sim, Damon *d) {
+    d->samples++;
+    d->exact_checks += d->npages;
+    d->region_sum += d->nregions;
+    for (int i = 0; i < d->nregions; i++) {
+        DamonRegion *r = &d->regions[i];
+        int f = sim_frame_of(sim, r->sample);
+        if (f >= 0 && d->young[f]) r->nr_accesses++;
+        arm(sim, d, r);
+        d->checks++;
+    }
+}
+
+// ---- Aggregation ----
+
+// Compares each page's verdict (cold if its region saw no access) with
+// whether the page was really accessed this interval
+static void evaluate(Damon *d) {
+    int n = d->npages;
+    int sampled = n > DAMON_EVAL_PAGES;
+    int count = sampled ? DAMON_EVAL_PAGES : n;
+    for (int k = 0; k < count; k++) {
+        int i = sampled ? (int)(next_rand(d) % (unsigned long long)n) : k;
+        int r = find_region(d, d->key[i]);
+        if (r < 0) continue;
+        int cold = d->regions[r].nr_accesses == 0;
+        if (d->last_aggr[i] == d->aggr_id) {
+            d->true_hot++;
+            d->hot_as_cold += cold;
+        } else {
+            d->true_cold++;
+            d->cold_as_cold += cold;
+        }
+    }
+}
+
+// Pages out the resident pages of regions idle for long enough
+static void pageout(Simulator *sim, Damon *d) {
+    int any = 0;
+    for (int i = 0; i < d->nregions && !any; i++) {
+        any = d->regions[i].nr_accesses == 0 && d->regions[i].age >= d->cfg.cold_aggrs;
+    }
+    if (!any) return;
+
+    for (int f = 0; f < sim->cfg.num_frames; f++) {
+        long key = ft_vpn(&sim->ft, f);
+        if (key == FRAME_EMPTY || ksm_is_stable_key((unsigned long)key)) continue;
+        int r = find_region(d, (unsigned long)key);
+        if (r < 0 || d->regions[r].nr_accesses != 0 ||
+            d->regions[r].age < d->cfg.cold_aggrs) {
+            continue;
+        }
+        int i = cuckoo_find(&d->pages, (unsigned long)key);
+        if (i >= 0) d->reclaimed_at[i] = d->aggr_id;
+        sim_reclaim_frame(sim, f);
+        d->reclaimed++;
+    }
+}
+
+// Merges neighbours with similar counts, keeping at least min_regions
+static void merge_regions(Damon *d, int thresh) {
+    unsigned long total = 0;
+    for (int i = 0; i < d->nregions; i++) total += region_pages(&d->regions[i]);
+    unsigned long limit = total / (unsigned long)d->cfg.min_regions;
+    if (limit < 1) limit = 1;
+
+    int w = 0;
+    for (int i = 0; i < d->nregions; i++) {
+        DamonRegion *b = &d->regions[i];
+        if (w > 0) {
+            DamonRegion *a = &d->regions[w - 1];
+            unsigned long sa = region_pages(a), sb = region_pages(b);
+            if (a->end + 1 == b->start && abs(a->nr_accesses - b->nr_accesses) <= thresh &&
+                sa + sb <= limit) {
+                double wa = (double)sa / (double)(sa + sb);
+                a->nr_accesses = (int)(wa * a->nr_accesses + (1.0 - wa) * b->nr_accesses + 0.5);
+                a->age = (int)(wa * a->age + (1.0 - wa) * b->age + 0.5);
+                a->end = b->end;
+                d->merges++;
+                continue;
+            }
+        }
+        d->regions[w++] = *b;
+    }
+    d->nregions = w;
+}
+
+// Splits every region in two at a random point, up to max_regions
+static void split_regions(Simulator *sim, Damon *d) {
+    if (d->nregions > d->cfg.max_regions / 2) return;
+    DamonRegion *out = d->regions + d->cfg.max_regions;
+    int n = 0;
+    for (int i = 0; i < d->nregions; i++) {
+        DamonRegion r = d->regions[i];
+        unsigned long size = region_pages(&r);
+        int left = d->nregions - i - 1;     // still to be copied
+        if (size < 2 || n + 2 + left > d->cfg.max_regions) {
+            out[n++] = r;
+            continue;
+        }
+        // Somewhere between 10% and 90% of the way
+        unsigned long cut = size * (1 + next_rand(d) % 9) / 10;
+        if (cut < 1) cut = 1;
+        DamonRegion a = r, b = r;
+        a.end = r.start + cut - 1;
+        b.start = r.start + cut;
+        out[n] = a;
+        out[n + 1] = b;
+        if (r.sample > a.end) arm(sim, d, &out[n]);
+        else arm(sim, d, &out[n + 1]);
+        n += 2;
+        d->splits++;
+    }
+    memcpy(d->regions, out, (size_t)n * sizeof(DamonRegion));
+    d->nregions = n;
+}
+
+static void aggregate(Simulator *sim, Damon *d) {
+    d->aggregations++;
+    evaluate(d);
+
+    int thresh = d->cfg.aggr_samples / 10;
+    if (thresh < 1) thresh = 1;
+    for (int i = 0; i < d->nregions; i++) {
+        DamonRegion *r = &d->regions[i];
+        if (abs(r->nr_accesses - r->last_nr) <= thresh) r->age++;
+        else r->age = 0;
+    }
+    if (d->cfg.cold_aggrs > 0) pageout(sim, d);
+    merge_regions(d, thresh);
+
+    for (int i = 0; i < d->nregions; i++) {
+        d->regions[i].last_nr = d->regions[i].nr_accesses;
+        d->regions[i].nr_accesses = 0;
+    }
+    split_regions(sim, d);
+    d->aggr_id++;
+}
+
+void damon_tick(Simulator *sim) {
+    Damon *d = sim->damon;
+    while (sim->tick >= d->next_sample) {
+        d->next_sample += (unsigned long)d->cfg.sample_interval;
+        sample(sim, d);
+        if (++d->samples_in_aggr == d->cfg.aggr_samples) {
+            d->samples_in_aggr = 0;
+            aggregate(sim, d);
+        }
+    }
+}
+
+// ---- Report ----
+
+void damon_print_stats(const Damon *d) {
+    printf("\n--- DAMON ---\n");
+    printf("Sampling every %ld accesses, aggregating every %d samples "
+           "(%lld intervals)\n", d->cfg.sample_interval, d->cfg.aggr_samples,
+           d->aggregations);
+    printf("Regions: %d now, %.1f average (%d-%d), %lld splits, %lld merges\n",
+           d->nregions, d->samples > 0 ? d->region_sum / (double)d->samples : 0.0,
+           d->cfg.min_regions, d->cfg.max_regions, d->splits, d->merges);
+    printf("Monitoring work: %lld page checks, per-page accessed bits: %.0f (%.3f%%)\n",
+           d->checks, d->exact_checks,
+           d->exact_checks > 0.0 ? 100.0 * (double)d->checks / d->exact_checks : 0.0);
+    printf("Accuracy: %.1f%% of idle pages seen as idle, %.1f%% of accessed pages "
+           "seen as idle\n",
+           d->true_cold > 0 ? 100.0 * (double)d->cold_as_cold / (double)d->true_cold : 0.0,
+           d->true_hot > 0 ? 100.0 * (double)d->hot_as_cold / (double)d->true_hot : 0.0);
+    if (d->cfg.cold_aggrs > 0) {
+        printf("Pageout (idle for %d intervals): %lld pages, %lld refaulted (%.1f%%)\n",
+               d->cfg.cold_aggrs, d->reclaimed, d->refaults,
+               d->reclaimed > 0 ? 100.0 * (double)d->refaults / (double)d->reclaimed : 0.0);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef DAMON_H
+#define DAMON_H
+
+#include "cuckoo.h"
+
+// Region-based access monitoring in the style of DAMON. The address space
+// is covered by a bounded number of regions of contiguous pages. Every
+// sampling interval the monitor checks one randomly chosen page per region
+// for an access since the previous sample (a private accessed bit, so the
+// replacement policy's own bits are untouched) and counts hits per region.
+// Every aggregation interval adjacent regions with similar counts are
+// merged, and regions are split at random points to look for finer
+// structure, so the monitoring cost depends on the region count and not
+// on the size of the address space. A region's age counts the aggregation
+// intervals its access count has stayed about the same.
+//
+// The optional pageout scheme reclaims the resident pages of regions that
+// saw no access for `cold_aggrs` intervals. To judge accuracy the monitor
+// also keeps exact per-page access times and, each aggregation interval,
+// compares every page's cold/hot verdict with the truth.
+
+struct Simulator;
+
+typedef struct {
+    long sample_interval;   // accesses between samples
+    int aggr_samples;       // samples per aggregation interval
+    int min_regions, max_regions;
+    long gap;               // pages farther than this from a region start a new one
+    int cold_aggrs;         // pageout after this many idle intervals, 0 = off
+} DamonConfig;
+
+typedef struct {
+    unsigned long start, end;   // page keys, inclusive
+    unsigned long sample;       // page whose accessed bit is being watched
+    int nr_accesses;            // samples that saw an access this interval
+    int last_nr;                // count of the previous interval
+    int age;
+} DamonRegion;
+
+typedef struct Damon {
+    DamonConfig cfg;
+    DamonRegion *regions;       // sorted by address, disjoint
+    int nregions;
+    unsigned char *young;       // per frame: accessed since last checked
+    unsigned long long rng;
+    unsigned long next_sample;  // tick of the next sample
+    int samples_in_aggr;
+    long long aggr_id;
+
+    // Ground truth, per page ever touched
+    CuckooMap pages;            // page key -> index
+    unsigned long *key;
+    long long *last_aggr;       // aggregation interval of the last access
+    long long *reclaimed_at;    // interval it was paged out, -1 if resident
+    int npages, pages_cap;
+
+    long long samples, checks;
+    double exact_checks;        // what per-page accessed bits would scan
+    long long aggregations, splits, merges;
+    long long true_cold, true_hot, cold_as_cold, hot_as_cold;
+    long long reclaimed, refaults;
+    double region_sum;          // for the average region count
+} Damon;
+
+void damon_config_defaults(DamonConfig *dc);
+
+int  damon_init(Damon *d, const DamonConfig *dc, int num_frames);
+void damon_free(Damon *d);
+
+// A page is touched for the first time; extends the monitored space
+void damon_new_page(Damon *d, unsigned long key);
+
+// An access to `key` in frame f
+void damon_access(Damon *d, int f, unsigned long key);
+
+// A page is faulted in; counts refaults of reclaimed pages
+void damon_fault(Damon *d, unsigned long key);
+
+// Runs samples and aggregations that are due
+void damon_tick(struct Simulator *sim);
+
+void damon_print_stats(const Damon *d);
+
+#endif
@@ -0,0 +1,345 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "far.h"
+
+#define FAR_PAGE 4096
+
+// Stand-in protocol: a header, `n` slot numbers, then for writes `n` pages.
+// Writes are acknowledged with one byte, reads answered with the pages.
+typedef struct {
+    unsigned int op;        // 'R' or 'W'
+    unsigned int n;
+} FarMsg;
+
+void far_config_defaults(FarConfig *fc) {
+    fc->rtt = 6000.0;       // ~2 us at 3 GHz
+    fc->bandwidth = 4.0;    // ~100 Gb/s at 3 GHz
+    fc->msg_cost = 500.0;
+    fc->page_cost = 200.0;
+    fc->batch = 16;
+    fc->max_batches = 8;
+    fc->sock = NULL;
+}
+
+// ---- Socket helpers ----
+
+static int send_all(int fd, const void *buf, size_t len) {
+    const unsigned char *p = (const unsigned char *)buf;
+    while (len > 0) {
+        ssize_t k = send(fd, p, len, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return -1;
+        p += k;
+        len -= (size_t)k;
+    }
+    return 0;
+}
+
+static int recv_all(int fd, void *buf, size_t len) {
+    unsigned char *p = (unsigned char *)buf;
+    while (len > 0) {
+        ssize_t k = recv(fd, p, len, 0);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return -1;
+        p += k;
+        len -= (size_t)k;
+    }
+    return 0;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int unix_addr(struct sockaddr_un *sa, const char *path) {
+    memset(sa, 0, sizeof(*sa));
+    sa->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa->sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(sa->sun_path, path);
+    return 0;
+}
+
+// ---- Init / free ----
+
+int far_init(Far *far, const FarConfig *fc) {
+    Far zero = {0};
+    *far = zero;
+    far->cfg = *fc;
+    far->fd = -1;
+    far->xfer = FAR_PAGE / fc->bandwidth;
+
+    far->pending = (int *)malloc((size_t)fc->batch * sizeof(int));
+    far->inflight = (double *)malloc((size_t)fc->max_batches * sizeof(double));
+    far->page = (unsigned char *)calloc(FAR_PAGE, 1);
+    if (!far->pending || !far->inflight || !far->page) {
+        perror("Error allocating far memory");
+        far_free(far);
+        return -1;
+    }
+
+    if (fc->sock) {
+        struct sockaddr_un sa;
+        if (unix_addr(&sa, fc->sock) != 0) {
+            far_free(far);
+            return -1;
+        }
+        far->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (far->fd < 0 || connect(far->fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+            perror(fc->sock);
+            far_free(far);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void far_free(Far *far) {
+    if (far->fd >= 0) close(far->fd);
+    free(far->pending);
+    free(far->inflight);
+    free(far->page);
+
+    Far zero = {0};
+    *far = zero;
+    far->fd = -1;
+}
+
+// ---- Stand-in ----
+
+// Sends one message to the stand-in and times it. A broken connection
+// drops back to the model alone.
+static void sock_exchange(Far *far, char op, const int *slots, int n) {
+    if (far->fd < 0) return;
+    double t0 = now_ns();
+    FarMsg msg = { (unsigned int)op, (unsigned int)n };
+    int ok = send_all(far->fd, &msg, sizeof(msg)) == 0 &&
+             send_all(far->fd, slots, (size_t)n * sizeof(int)) == 0;
+
+    for (int i = 0; ok && i < n; i++) {
+        if (op == 'W') {
+            // Tag the page with its slot so reads can be checked
+            memcpy(far->page, &slots[i], sizeof(int));
+            ok = send_all(far->fd, far->page, FAR_PAGE) == 0;
+        } else {
+            ok = recv_all(far->fd, far->page, FAR_PAGE) == 0;
+            int tag;
+            memcpy(&tag, far->page, sizeof(int));
+            if (ok && tag != slots[i]) far->sock_errors++;
+        }
+    }
+    if (ok && op == 'W') {
+        char ack;
+        ok = recv_all(far->fd, &ack, 1) == 0;
+    }
+    if (!ok) {
+        perror("Far-memory stand-in");
+        close(far->fd);
+        far->fd = -1;
+        return;
+    }
+
+    double dt = now_ns() - t0;
+    far->sock_msgs++;
+    if (op == 'W') {
+        far->sock_write_ns += dt;
+        far->sock_write_msgs++;
+    } else {
+        far->sock_read_ns += dt;
+        far->sock_read_msgs++;
+    }
+}
+
+// ---- Transfers ----
+
+static double max2(double a, double b) {
+    return a > b ? a : b;
+}
+
+// Sends the pending batch; returns when the sender may continue
+static double flush(Far *far, double now) {
+    if (far->npending == 0) return now;
+
+    // Retire finished writes, then wait for a credit if none is left
+    double t = now;
+    int n = 0;
+    for (int i = 0; i < far->ninflight; i++) {
+        if (far->inflight[i] > t) far->inflight[n++] = far->inflight[i];
+    }
+    far->ninflight = n;
+    if (n == far->cfg.max_batches) {
+        int first = 0;
+        for (int i = 1; i < n; i++) {
+            if (far->inflight[i] < far->inflight[first]) first = i;
+        }
+        t = far->inflight[first];
+        far->inflight[first] = far->inflight[--far->ninflight];
+        far->stall += t - now;
+    }
+
+    double start = max2(t, far->tx_free);
+    far->tx_free = start + far->cfg.msg_cost +
+                   (double)far->npending * (far->cfg.page_cost + far->xfer);
+    far->inflight[far->ninflight++] = far->tx_free + far->cfg.rtt;
+
+    sock_exchange(far, 'W', far->pending, far->npending);
+    far->write_msgs++;
+    far->npending = 0;
+    return t;
+}
+
+double far_read(Far *far, const int *slots, int n, double now) {
+    // Reads must not overtake a queued write of the same page
+    int queued = 0;
+    for (int i = 0; i < far->npending && !queued; i++) {
+        for (int j = 0; j < n; j++) queued |= far->pending[i] == slots[j];
+    }
+    if (queued) now = flush(far, now);
+
+    // The request travels out, then the pages come back in order
+    double start = max2(now + far->cfg.rtt / 2.0, far->rx_free);
+    double first = start + far->cfg.msg_cost + far->cfg.page_cost + far->xfer;
+    far->rx_free = start + far->cfg.msg_cost +
+                   (double)n * (far->cfg.page_cost + far->xfer);
+    double done = first + far->cfg.rtt / 2.0;
+
+    sock_exchange(far, 'R', slots, n);
+    far->reads += n;
+    far->read_msgs++;
+    far->read_lat_sum += done - now;
+    return done;
+}
+
+double far_write(Far *far, int slot, double now) {
+    far->pending[far->npending++] = slot;
+    far->writes++;
+    if (far->npending < far->cfg.batch) return now;
+    return flush(far, now);
+}
+
+// ---- Report ----
+
+void far_print_stats(const Far *far) {
+    printf("\n--- Far memory ---\n");
+    printf("Link: %.0f cycles RTT, %.2f bytes/cycle (%.0f cycles/page), "
+           "%.0f cycles/message, %.0f cycles/page overhead\n",
+           far->cfg.rtt, far->cfg.bandwidth, far->xfer, far->cfg.msg_cost,
+           far->cfg.page_cost);
+    printf("Reads: %lld pages in %lld messages, %.0f cycles average fault latency\n",
+           far->reads, far->read_msgs,
+           far->read_msgs > 0 ? far->read_lat_sum / (double)far->read_msgs : 0.0);
+    printf("Writes: %lld pages in %lld messages (batch %d), %.0f cycles stalled "
+           "(%d in flight max)\n", far->writes, far->write_msgs, far->cfg.batch,
+           far->stall, far->cfg.max_batches);
+    if (far->cfg.sock) {
+        printf("Stand-in %s: %lld messages%s\n", far->cfg.sock, far->sock_msgs,
+               far->fd < 0 ? " (connection lost)" : "");
+        printf("  read: %.2f us/message, write: %.2f us/message, %lld bad pages\n",
+               far->sock_read_msgs > 0 ? far->sock_read_ns / 1e3 / (double)far->sock_read_msgs : 0.0,
+               far->sock_write_msgs > 0 ? far->sock_write_ns / 1e3 / (double)far->sock_write_msgs : 0.0,
+               far->sock_errors);
+    }
+}
+
+// ---- Stand-in server ----
+
+// Pages by slot; slots are dense, so a growable array does
+typedef struct {
+    unsigned char **pages;
+    size_t cap;
+} PageStore;
+
+static unsigned char *store_page(PageStore *ps, unsigned int slot) {
+    if (slot >= ps->cap) {
+        size_t cap = ps->cap ? ps->cap : 1024;
+        while (cap <= slot) cap *= 2;
+        unsigned char **p = (unsigned char **)realloc(ps->pages, cap * sizeof(*p));
+        if (!p) return NULL;
+        memset(p + ps->cap, 0, (cap - ps->cap) * sizeof(*p));
+        ps->pages = p;
+        ps->cap = cap;
+    }
+    if (!ps->pages[slot]) ps->pages[slot] = (unsigned char *)calloc(FAR_PAGE, 1);
+    return ps->pages[slot];
+}
+
+static void serve_client(int fd, PageStore *ps) {
+    unsigned int *slots = NULL;
+    unsigned int cap = 0;
+    long long reads = 0, writes = 0;
+
+    FarMsg msg;
+    while (recv_all(fd, &msg, sizeof(msg)) == 0) {
+        if (msg.n > cap) {
+            unsigned int *s = (unsigned int *)realloc(slots, msg.n * sizeof(unsigned int));
+            if (!s) break;
+            slots = s;
+            cap = msg.n;
+        }
+        if (recv_all(fd, slots, msg.n * sizeof(unsigned int)) != 0) break;
+
+        int ok = 1;
+        for (unsigned int i = 0; ok && i < msg.n; i++) {
+            unsigned char *page = store_page(ps, slots[i]);
+            if (!page) ok = 0;
+            else if (msg.op == 'W') ok = recv_all(fd, page, FAR_PAGE) == 0;
+            else ok = send_all(fd, page, FAR_PAGE) == 0;
+        }
+        if (ok && msg.op == 'W') ok = send_all(fd, "k", 1) == 0;
+        if (!ok) break;
+        if (msg.op == 'W') writes += msg.n;
+        else reads += msg.n;
+    }
+
+    printf("Client done: %lld pages read, %lld written\n", reads, writes);
+    fflush(stdout);
+    free(slots);
+    close(fd);
+}
+
+int far_serve(const char *path) {
+    struct sockaddr_un sa;
+    if (unix_addr(&sa, path) != 0) return -1;
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(lfd, (struct sockaddr *)&sa, sizeof(sa)) != 0 || listen(lfd, 4) != 0) {
+        perror(path);
+        close(lfd);
+        return -1;
+    }
+    printf("Far-memory stand-in listening on %s\n", path);
+    fflush(stdout);
+
+    // One client at a time; pages persist across clients
+    PageStore ps = {0};
+    for (;;) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            break;
+        }
+        serve_client(fd, &ps);
+    }
+
+    for (size_t i = 0; i < ps.cap; i++) free(ps.pages[i]);
+    free(ps.pages);
+    close(lfd);
+    return -1;
+}
@@ -0,0 +1,68 @@
+#ifndef FAR_H
+#define FAR_H
+
+// Far-memory backend for the swap space: pages live in a remote node's
+// memory and move over an RDMA-style link. A message pays a fixed posting
+// cost, every page in it a per-page cost plus its transfer time at the
+// link bandwidth, and the whole message one network round trip. Evicted
+// pages are batched into write messages sent asynchronously; eviction only
+// stalls when `max_batches` writes are still in flight. A major fault
+// sends one read for the faulting page and its readahead window and waits
+// for the first page.
+//
+// With a socket path, every message is also sent to a stand-in server
+// (`ossim -far-serve path`) that really stores the pages, so the software
+// cost of the transport can be measured next to the model.
+
+typedef struct {
+    double rtt;             // network round trip, cycles
+    double bandwidth;       // bytes per cycle in each direction
+    double msg_cost;        // cycles to post and complete one message
+    double page_cost;       // cycles of per-page work (copy, registration)
+    int batch;              // evicted pages per write message
+    int max_batches;        // write messages in flight before eviction stalls
+    const char *sock;       // stand-in server, NULL for the model only
+} FarConfig;
+
+typedef struct Far {
+    FarConfig cfg;
+    double xfer;            // one page over the link
+    double tx_free, rx_free;    // when each direction is idle
+
+    int *pending;           // slots evicted but not yet sent
+    int npending;
+    double *inflight;       // completion times of write messages
+    int ninflight;
+
+    int fd;                 // stand-in connection, -1 if none
+    unsigned char *page;    // transfer buffer
+
+    long long reads, read_msgs, writes, write_msgs;
+    double read_lat_sum;
+    double stall;           // eviction time lost waiting for write credits
+
+    // Stand-in measurements (wall clock)
+    long long sock_msgs, sock_errors;
+    double sock_read_ns, sock_write_ns;
+    long long sock_read_msgs, sock_write_msgs;
+} Far;
+
+void far_config_defaults(FarConfig *fc);
+
+int  far_init(Far *far, const FarConfig *fc);
+void far_free(Far *far);
+
+// Reads the given slots in one message at time `now`. Returns when the
+// first one (the faulting page) has arrived.
+double far_read(Far *far, const int *slots, int n, double now);
+
+// Queues an evicted slot for the next write message. Returns when the
+// evicting CPU may continue.
+double far_write(Far *far, int slot, double now);
+
+void far_print_stats(const Far *far);
+
+// Runs the stand-in server on a Unix socket until killed
+int  far_serve(const char *path);
+
+#endif
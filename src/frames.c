@@ -0,0 +1,154 @@
+#include <stdlib.h>
+
+#include "frames.h"
+
+static unsigned int ft_hash(unsigned long vpn, unsigned int mask) {
+    unsigned long long h = (unsigned long long)vpn;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (unsigned int)h & mask;
+}
+
+int ft_init(FrameTable *ft, int num_frames, int compact, int need_stamps) {
+    FrameTable zero = {0};
+    *ft = zero;
+    ft->num_frames = num_frames;
+    ft->compact = compact;
+    size_t n = (size_t)num_frames;
+
+    if (!compact) {
+        ft->vpn       = (long *)malloc(n * sizeof(long));
+        ft->last_used = (unsigned long *)calloc(n, sizeof(unsigned long));
+        ft->ref_bits  = (int *)calloc(n, sizeof(int));
+        ft->dirty     = (int *)calloc(n, sizeof(int));
+        if (!ft->vpn || !ft->last_used || !ft->ref_bits || !ft->dirty) {
+            ft_free(ft);
+            return -1;
+        }
+        for (int i = 0; i < num_frames; i++) ft->vpn[i] = FRAME_EMPTY;
+        return 0;
+    }
+
+    // One anchor per four frames: chains average four links
+    unsigned int buckets = 1;
+    while ((size_t)buckets * 4 < n) buckets <<= 1;
+
+    ft->mask    = buckets - 1;
+    ft->cvpn    = (unsigned int *)malloc(n * sizeof(unsigned int));
+    ft->next    = (unsigned int *)malloc(n * sizeof(unsigned int));
+    ft->flags   = (unsigned char *)calloc((n + 3) / 4, 1);
+    ft->anchors = (unsigned int *)malloc((size_t)buckets * sizeof(unsigned int));
+    if (need_stamps) ft->stamp = (unsigned int *)calloc(n, sizeof(unsigned int));
+
+    if (!ft->cvpn || !ft->next || !ft->flags || !ft->anchors ||
+        (need_stamps && !ft->stamp)) {
+        ft_free(ft);
+        return -1;
+    }
+    for (int i = 0; i < num_frames; i++) {
+        ft->cvpn[i] = FT_COMPACT_NO_VPN;
+        ft->next[i] = FT_NIL;
+    }
+    for (unsigned int b = 0; b < buckets; b++) ft->anchors[b] = FT_NIL;
+    return 0;
+}
+
+void ft_free(FrameTable *ft) {
+    free(ft->vpn);
+    free(ft->last_used);
+    free(ft->ref_bits);
+    free(ft->dirty);
+    free(ft->cvpn);
+    free(ft->stamp);
+    free(ft->flags);
+    free(ft->anchors);
+    free(ft->next);
+
+    FrameTable zero = {0};
+    *ft = zero;
+}
+
+size_t ft_bytes(const FrameTable *ft) {
+    size_t n = (size_t)ft->num_frames;
+    if (!ft->compact) {
+        return n * (sizeof(long) + sizeof(unsigned long) + 2 * sizeof(int));
+    }
+    return n * 2 * sizeof(unsigned int) + (n + 3) / 4 +
+           (size_t)(ft->mask + 1) * sizeof(unsigned int) +
+           (ft->stamp ? n * sizeof(unsigned int) : 0);
+}
+
+int ft_find(const FrameTable *ft, unsigned long vpn) {
+    if (vpn > FT_COMPACT_MAX_VPN) return -1;
+    unsigned int f = ft->anchors[ft_hash(vpn, ft->mask)];
+    while (f != FT_NIL) {
+        if (ft->cvpn[f] == (unsigned int)vpn) return (int)f;
+        f = ft->next[f];
+    }
+    return -1;
+}
+
+void ft_set_vpn(FrameTable *ft, int f, long vpn) {
+    if (!ft->compact) {
+        ft->vpn[f] = vpn;
+        return;
+    }
+
+    if (ft->cvpn[f] != FT_COMPACT_NO_VPN) {
+        unsigned int *link = &ft->anchors[ft_hash(ft->cvpn[f], ft->mask)];
+        while (*link != (unsigned int)f) link = &ft->next[*link];
+        *link = ft->next[f];
+        ft->next[f] = FT_NIL;
+        ft->cvpn[f] = FT_COMPACT_NO_VPN;
+    }
+
+    if (vpn != FRAME_EMPTY) {
+        unsigned int *anchor = &ft->anchors[ft_hash((unsigned long)vpn, ft->mask)];
+        ft->cvpn[f] = (unsigned int)vpn;
+        ft->next[f] = *anchor;
+        *anchor = (unsigned int)f;
+    }
+}
+
+typedef struct {
+    unsigned int stamp;
+    unsigned int frame;
+} StampRank;
+
+static int cmp_stamp(const void *a, const void *b) {
+    unsigned int x = ((const StampRank *)a)->stamp;
+    unsigned int y = ((const StampRank *)b)->stamp;
+    return (x > y) - (x < y);
+}
+
+void ft_rebase(FrameTable *ft, unsigned long tick) {
+    // LRU only compares stamps, so replacing them by their rank keeps every
+    // decision identical while shrinking the range to [0, num_frames).
+    size_t n = (size_t)ft->num_frames;
+    StampRank *order = (StampRank *)malloc(n * sizeof(StampRank));
+    unsigned int rank = 0;
+
+    if (order) {
+        for (size_t i = 0; i < n; i++) {
+            order[i].stamp = ft->stamp[i];
+            order[i].frame = (unsigned int)i;
+        }
+        qsort(order, n, sizeof(StampRank), cmp_stamp);
+        for (size_t i = 0; i < n; i++) {
+            if (i > 0 && order[i].stamp != order[i - 1].stamp) rank++;
+            ft->stamp[order[i].frame] = rank;
+        }
+        free(order);
+    } else {
+        // Out of memory: shift by the oldest stamp instead. Still exact
+        // unless live stamps span more than 2^32 accesses.
+        unsigned int lo = 0xffffffffU;
+        for (size_t i = 0; i < n; i++) if (ft->stamp[i] < lo) lo = ft->stamp[i];
+        for (size_t i = 0; i < n; i++) ft->stamp[i] -= lo;
+        rank = 0;
+        for (size_t i = 0; i < n; i++) if (ft->stamp[i] > rank) rank = ft->stamp[i];
+    }
+
+    ft->epoch = tick - ((unsigned long)rank + 1);
+}
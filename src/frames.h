@@ -0,0 +1,99 @@
+#ifndef FRAMES_H
+#define FRAMES_H
+
+#include <stddef.h>
+
+// Per-frame metadata (resident vpn, LRU time, reference and dirty bits).
+//
+// The wide layout keeps one full-width array per field. The compact layout
+// is meant for very large memories: 32-bit vpns, 32-bit LRU stamps relative
+// to a moving epoch (only allocated when the policy needs them), reference
+// and dirty bits packed two per frame, and a chained hash directory with
+// 32-bit links and one anchor per four frames.
+
+#define FRAME_EMPTY (-1L)
+
+#define FT_NIL            0xffffffffU
+#define FT_COMPACT_NO_VPN 0xffffffffU
+#define FT_COMPACT_MAX_VPN (0xffffffffUL - 1)   // ~16 TB of 4 KB pages
+
+typedef struct {
+    int num_frames;
+    int compact;
+
+    // wide layout
+    long *vpn;                  // FRAME_EMPTY if free
+    unsigned long *last_used;
+    int *ref_bits;
+    int *dirty;
+
+    // compact layout
+    unsigned int *cvpn;         // FT_COMPACT_NO_VPN if free
+    unsigned int *stamp;        // last use - epoch, NULL unless stamps needed
+    unsigned char *flags;       // 2 bits per frame: ref, dirty
+    unsigned int *anchors;      // hash bucket -> first frame, FT_NIL if empty
+    unsigned int *next;         // frame -> next frame in chain
+    unsigned int mask;          // anchor count - 1
+    unsigned long epoch;
+} FrameTable;
+
+int    ft_init(FrameTable *ft, int num_frames, int compact, int need_stamps);
+void   ft_free(FrameTable *ft);
+size_t ft_bytes(const FrameTable *ft);
+
+// Compact layout only: frame holding vpn, or -1.
+int  ft_find(const FrameTable *ft, unsigned long vpn);
+void ft_set_vpn(FrameTable *ft, int f, long vpn);
+
+// Re-numbers all stamps by rank once they no longer fit in 32 bits.
+void ft_rebase(FrameTable *ft, unsigned long tick);
+
+#define FT_REF   1u
+#define FT_DIRTY 2u
+
+static inline long ft_vpn(const FrameTable *ft, int f) {
+    if (!ft->compact) return ft->vpn[f];
+    return (ft->cvpn[f] == FT_COMPACT_NO_VPN) ? FRAME_EMPTY : (long)ft->cvpn[f];
+}
+
+static inline unsigned long ft_last_used(const FrameTable *ft, int f) {
+    if (!ft->compact) return ft->last_used[f];
+    return ft->stamp ? ft->stamp[f] : 0;
+}
+
+static inline void ft_set_last_used(FrameTable *ft, int f, unsigned long tick) {
+    if (!ft->compact) { ft->last_used[f] = tick; return; }
+    if (!ft->stamp) return;
+    if (tick - ft->epoch > 0xffffffffUL) ft_rebase(ft, tick);
+    ft->stamp[f] = (unsigned int)(tick - ft->epoch);
+}
+
+static inline int ft_flag(const FrameTable *ft, int f, unsigned int bit) {
+    return (ft->flags[f >> 2] >> ((f & 3) * 2)) & bit ? 1 : 0;
+}
+
+static inline void ft_set_flag(FrameTable *ft, int f, unsigned int bit, int on) {
+    unsigned char m = (unsigned char)(bit << ((f & 3) * 2));
+    if (on) ft->flags[f >> 2] |= m;
+    else    ft->flags[f >> 2] &= (unsigned char)~m;
+}
+
+static inline int ft_ref(const FrameTable *ft, int f) {
+    return ft->compact ? ft_flag(ft, f, FT_REF) : ft->ref_bits[f];
+}
+
+static inline void ft_set_ref(FrameTable *ft, int f, int on) {
+    if (ft->compact) ft_set_flag(ft, f, FT_REF, on);
+    else ft->ref_bits[f] = on;
+}
+
+static inline int ft_dirty(const FrameTable *ft, int f) {
+    return ft->compact ? ft_flag(ft, f, FT_DIRTY) : ft->dirty[f];
+}
+
+static inline void ft_set_dirty(FrameTable *ft, int f, int on) {
+    if (ft->compact) ft_set_flag(ft, f, FT_DIRTY, on);
+    else ft->dirty[f] = on;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hll.h"
+
+int hll_init(Hll *h) {
+    h->reg = (unsigned char *)malloc(HLL_REGS);
+    if (!h->reg) return -1;
+    hll_reset(h);
+    return 0;
+}
+
+void hll_free(Hll *h) {
+    free(h->reg);
+    h->reg = NULL;
+}
+
+void hll_reset(Hll *h) {
+    memset(h->reg, 0, HLL_REGS);
+    h->sum = HLL_REGS;
+    h->zeros = HLL_REGS;
+}
+
+unsigned long hll_hash(unsigned long key) {    // splitmix64 finalizer
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9UL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebUL;
+    key ^= key >> 31;
+    return key;
+}
+
+void hll_slot(unsigned long hash, int *idx, int *rank) {
+    *idx = (int)(hash >> (64 - HLL_BITS));
+    unsigned long rest = hash << HLL_BITS;
+    *rank = rest ? __builtin_clzl(rest) + 1 : 64 - HLL_BITS + 1;
+}
+
+int hll_raise(Hll *h, int idx, int rank) {
+    int old = h->reg[idx];
+    if (old >= rank) return 0;
+    h->sum += ldexp(1.0, -rank) - ldexp(1.0, -old);
+    h->zeros -= old == 0;
+    h->reg[idx] = (unsigned char)rank;
+    return 1;
+}
+
+void hll_add(Hll *h, unsigned long key) {
+    int idx, rank;
+    hll_slot(hll_hash(key), &idx, &rank);
+    hll_raise(h, idx, rank);
+}
+
+double hll_count(const Hll *h) {
+    double m = HLL_REGS;
+    double e = 0.7213 / (1.0 + 1.079 / m) * m * m / h->sum;
+    // Linear counting is more accurate while many registers are empty
+    if (e <= 2.5 * m && h->zeros > 0) e = m * log(m / h->zeros);
+    return e;
+}
@@ -0,0 +1,32 @@
+#ifndef HLL_H
+#define HLL_H
+
+// HyperLogLog distinct counter: 2^HLL_BITS one-byte registers, about 1.6%
+// standard error at any count. The register sum behind the estimate is
+// kept up to date on every update, so reading the count is O(1).
+
+#define HLL_BITS 12
+#define HLL_REGS (1 << HLL_BITS)
+
+typedef struct {
+    unsigned char *reg;
+    double sum;                 // sum of 2^-reg over all registers
+    int zeros;                  // registers still zero
+} Hll;
+
+int    hll_init(Hll *h);
+void   hll_free(Hll *h);
+void   hll_reset(Hll *h);
+
+// Hash of a 64-bit key, split into a register and the rank the key
+// proposes for it
+unsigned long hll_hash(unsigned long key);
+void   hll_slot(unsigned long hash, int *idx, int *rank);
+
+// Raises register idx to rank; returns 1 if it grew
+int    hll_raise(Hll *h, int idx, int rank);
+void   hll_add(Hll *h, unsigned long key);
+
+double hll_count(const Hll *h);
+
+#endif
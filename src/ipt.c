@@ -0,0 +1,70 @@
+#include <stdlib.h>
+
+#include "ipt.h"
+
+static unsigned long ipt_hash(unsigned long vpn) {
+    // 64-bit finalizer (MurmurHash3 fmix64)
+    unsigned long long h = (unsigned long long)vpn;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (unsigned long)h;
+}
+
+int ipt_init(InvertedPageTable *ipt, int num_frames) {
+    // One anchor per frame on average keeps chains around length 1
+    unsigned long buckets = 1;
+    while (buckets < (unsigned long)num_frames) buckets <<= 1;
+
+    ipt->num_frames = num_frames;
+    ipt->mask    = buckets - 1;
+    ipt->anchors = (int *)malloc(buckets * sizeof(int));
+    ipt->next    = (int *)malloc((size_t)num_frames * sizeof(int));
+
+    if (!ipt->anchors || !ipt->next) {
+        ipt_free(ipt);
+        return -1;
+    }
+
+    for (unsigned long b = 0; b < buckets; b++) ipt->anchors[b] = -1;
+    for (int i = 0; i < num_frames; i++) ipt->next[i] = -1;
+    return 0;
+}
+
+void ipt_free(InvertedPageTable *ipt) {
+    free(ipt->anchors);
+    free(ipt->next);
+    ipt->anchors = NULL;
+    ipt->next = NULL;
+}
+
+int ipt_lookup(const InvertedPageTable *ipt, const FrameTable *ft, unsigned long vpn) {
+    int f = ipt->anchors[ipt_hash(vpn) & ipt->mask];
+    while (f != -1) {
+        if ((unsigned long)ft_vpn(ft, f) == vpn) return f;
+        f = ipt->next[f];
+    }
+    return -1;
+}
+
+void ipt_map(InvertedPageTable *ipt, int frame, unsigned long vpn) {
+    unsigned long b = ipt_hash(vpn) & ipt->mask;
+    ipt->next[frame] = ipt->anchors[b];
+    ipt->anchors[b]  = frame;
+}
+
+void ipt_unmap(InvertedPageTable *ipt, const FrameTable *ft, int frame) {
+    long vpn = ft_vpn(ft, frame);
+    if (vpn == FRAME_EMPTY) return;
+
+    int *link = &ipt->anchors[ipt_hash((unsigned long)vpn) & ipt->mask];
+    while (*link != frame) link = &ipt->next[*link];
+    *link = ipt->next[frame];
+    ipt->next[frame] = -1;
+}
+
+size_t ipt_bytes(const InvertedPageTable *ipt) {
+    return (size_t)(ipt->mask + 1) * sizeof(int) + (size_t)ipt->num_frames * sizeof(int);
+}
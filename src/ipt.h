@@ -0,0 +1,38 @@
+#ifndef IPT_H
+#define IPT_H
+
+#include <stddef.h>
+
+#include "frames.h"
+
+// Inverted page table: one entry per physical frame, reached through a
+// hash anchor table keyed by page key. The simulator's page keys already
+// carry the ASID (SIM_ASID_SHIFT), so address spaces stay apart without a
+// per-frame ASID. Its size depends only on the number of frames, never on
+// the size of the virtual address space.
+//
+// The page a frame holds is the frame table's vpn; the IPT only adds the
+// anchors and the chain links, about 8 bytes a frame, and chain walks
+// compare against ft_vpn(). A frame is mapped with its vpn already set and
+// unmapped before it changes.
+
+typedef struct {
+    int num_frames;
+    unsigned long mask;       // anchor table size - 1 (power of two)
+    int *anchors;             // hash bucket -> first frame in chain, -1 if empty
+    int *next;                // frame -> next frame in the same chain, -1 at end
+} InvertedPageTable;
+
+int  ipt_init(InvertedPageTable *ipt, int num_frames);
+void ipt_free(InvertedPageTable *ipt);
+
+// Returns the frame holding vpn, or -1 if it is not resident.
+int  ipt_lookup(const InvertedPageTable *ipt, const FrameTable *ft, unsigned long vpn);
+
+// Maps vpn into a free frame. The frame must have been unmapped first.
+void ipt_map(InvertedPageTable *ipt, int frame, unsigned long vpn);
+void ipt_unmap(InvertedPageTable *ipt, const FrameTable *ft, int frame);
+
+size_t ipt_bytes(const InvertedPageTable *ipt);
+
+#endif
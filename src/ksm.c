@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ksm.h"
+#include "sim.h"
+
+#define KSM_KNOWN   1u      // content hash is known
+#define KSM_CHECKED 2u      // hash unchanged since the scanner last saw it
+#define KSM_MERGED  4u      // mapped to a stable frame or the zero page
+#define KSM_ZERO    8u      // mapped to the zero page
+#define KSM_SWAPPED 16u     // its stable frame was evicted; the copy is on swap
+
+void ksm_config_defaults(KsmConfig *kc) {
+    kc->pages_to_scan = 100;
+    kc->interval = 1000;
+    kc->page_cost = 2000.0;
+}
+
+int ksm_init(Ksm *k, const KsmConfig *kc) {
+    Ksm zero = {0};
+    *k = zero;
+    k->cfg = *kc;
+    if (cuckoo_init(&k->pages, 1024) != 0 ||
+        cuckoo_init(&k->stable, 1024) != 0 ||
+        cuckoo_init(&k->unstable, 1024) != 0) {
+        ksm_free(k);
+        return -1;
+    }
+    return 0;
+}
+
+void ksm_free(Ksm *k) {
+    cuckoo_free(&k->pages);
+    cuckoo_free(&k->stable);
+    cuckoo_free(&k->unstable);
+    free(k->key);
+    free(k->content);
+    free(k->flags);
+    free(k->stable_of);
+    free(k->sframe);
+    free(k->sharers);
+    free(k->scontent);
+
+    Ksm zero = {0};
+    *k = zero;
+}
+
+// Content hashes are cuckoo keys; keep them clear of the empty-key marker
+static unsigned long content_key(unsigned long long c) {
+    return (c == CUCKOO_EMPTY_KEY) ? (unsigned long)c - 1 : (unsigned long)c;
+}
+
+static unsigned long stable_key(int s) {
+    return (KSM_ASID << 48) | (unsigned long)s;
+}
+
+static void note_saved(Ksm *k) {
+    long long saved = k->pages_sharing + k->zero_pages;
+    if (saved > k->peak_saved) k->peak_saved = saved;
+}
+
+static int grow(void **p, int cap, size_t elem) {
+    void *q = realloc(*p, (size_t)cap * elem);
+    if (!q) return -1;
+    *p = q;
+    return 0;
+}
+
+static int new_entry(Ksm *k, unsigned long key) {
+    if (k->nentries == k->entries_cap) {
+        int cap = k->entries_cap ? k->entries_cap * 2 : 1024;
+        if (grow((void **)&k->key, cap, sizeof(unsigned long)) != 0 ||
+            grow((void **)&k->content, cap, sizeof(unsigned long long)) != 0 ||
+            grow((void **)&k->flags, cap, 1) != 0 ||
+            grow((void **)&k->stable_of, cap, sizeof(int)) != 0) {
+            return -1;
+        }
+        k->entries_cap = cap;
+    }
+    int e = k->nentries++;
+    k->key[e] = key;
+    k->flags[e] = 0;
+    k->stable_of[e] = -1;
+    cuckoo_insert(&k->pages, key, e);
+    return e;
+}
+
+static int new_stable(Ksm *k, int frame, unsigned long long content) {
+    if (k->nstable == k->stable_cap) {
+        int cap = k->stable_cap ? k->stable_cap * 2 : 256;
+        if (grow((void **)&k->sframe, cap, sizeof(int)) != 0 ||
+            grow((void **)&k->sharers, cap, sizeof(int)) != 0 ||
+            grow((void **)&k->scontent, cap, sizeof(unsigned long long)) != 0) {
+            return -1;
+        }
+        k->stable_cap = cap;
+    }
+    int s = k->nstable++;
+    k->sframe[s] = frame;
+    k->sharers[s] = 0;
+    k->scontent[s] = content;
+    cuckoo_insert(&k->stable, content_key(content), s);
+    k->pages_shared++;
+    return s;
+}
+
+// Stable frame s no longer exists; its sharers notice lazily on access
+static void drop_stable(Ksm *k, int s) {
+    cuckoo_erase(&k->stable, content_key(k->scontent[s]));
+    k->pages_sharing -= k->sharers[s] > 0 ? k->sharers[s] - 1 : 0;
+    k->pages_shared--;
+    k->sframe[s] = -1;
+}
+
+// Entry e now maps stable frame s; frame f (its own, if any) is given back
+static void merge_into(Simulator *sim, int e, int f, int s) {
+    Ksm *k = sim->ksm;
+    if (f >= 0) sim_release_frame(sim, f);
+    k->flags[e] |= KSM_MERGED;
+    k->stable_of[e] = s;
+    if (k->sharers[s]++ > 0) k->pages_sharing++;
+    k->merged++;
+    note_saved(k);
+}
+
+int ksm_lookup(Simulator *sim, unsigned long key) {
+    Ksm *k = sim->ksm;
+    int e = cuckoo_find(&k->pages, key);
+    if (e < 0 || !(k->flags[e] & KSM_MERGED)) return -1;
+    if (k->flags[e] & KSM_ZERO) return KSM_ZERO_FRAME;
+
+    int s = k->stable_of[e];
+    if (k->sframe[s] >= 0) return k->sframe[s];
+
+    // The stable frame was evicted, and this page with it; the fault that
+    // follows reads the stable copy back (ksm_fault)
+    k->flags[e] = (unsigned char)((k->flags[e] & ~KSM_MERGED) | KSM_SWAPPED);
+    return -1;
+}
+
+void ksm_fault(Simulator *sim, unsigned long key, int major) {
+    Ksm *k = sim->ksm;
+    int e = cuckoo_find(&k->pages, key);
+    int s = -1;
+    if (e >= 0 && (k->flags[e] & KSM_SWAPPED)) {
+        s = k->stable_of[e];
+        k->flags[e] &= (unsigned char)~KSM_SWAPPED;
+        k->stable_of[e] = -1;
+    }
+    if (!sim->swap) return;
+
+    // A copy of its own from before the merge is still valid: merged pages
+    // are never written
+    if (major) {
+        int own = cuckoo_find(&sim->swap->slot_of, key) >= 0;
+        swap_in(sim, s >= 0 && !own ? stable_key(s) : key);
+    }
+    // The last sharer to come back frees the stable copy's slot
+    if (s >= 0 && --k->sharers[s] == 0) swap_dirty(sim->swap, stable_key(s));
+}
+
+void ksm_cow_break(Simulator *sim, unsigned long key) {
+    Ksm *k = sim->ksm;
+    int e = cuckoo_find(&k->pages, key);
+    if (e < 0 || !(k->flags[e] & KSM_MERGED)) return;
+    k->cow_breaks++;
+
+    if (k->flags[e] & KSM_ZERO) {
+        k->zero_pages--;
+    } else {
+        int s = k->stable_of[e];
+        if (--k->sharers[s] > 0) {
+            k->pages_sharing--;
+        } else {
+            int f = k->sframe[s];
+            drop_stable(k, s);
+            sim_release_frame(sim, f);
+        }
+    }
+    k->flags[e] &= (unsigned char)~(KSM_MERGED | KSM_ZERO);
+    k->stable_of[e] = -1;
+}
+
+void ksm_note_write(Simulator *sim, unsigned long key) {
+    Ksm *k = sim->ksm;
+    int e = cuckoo_find(&k->pages, key);
+    if (e >= 0) k->flags[e] &= (unsigned char)~(KSM_KNOWN | KSM_CHECKED);
+}
+
+void ksm_set_content(Simulator *sim, unsigned long key, unsigned long long content) {
+    Ksm *k = sim->ksm;
+    int e = cuckoo_find(&k->pages, key);
+    if (e < 0 && (e = new_entry(k, key)) < 0) return;   // untracked: never merged
+    k->content[e] = content;
+    k->flags[e] = (unsigned char)((k->flags[e] & ~KSM_CHECKED) | KSM_KNOWN);
+}
+
+void ksm_evicted(Simulator *sim, unsigned long key) {
+    if (!ksm_is_stable_key(key)) return;
+    Ksm *k = sim->ksm;
+    int s = (int)(key & 0xffffffffUL);
+    if (sim->cfg.tlb_size > 0) tlb_invalidate_frame(&sim->tlb, k->sframe[s]);
+    drop_stable(k, s);
+    k->stable_evictions++;
+}
+
+// Examines the page in frame f
+static void scan_frame(Simulator *sim, int f) {
+    Ksm *k = sim->ksm;
+    long key = ft_vpn(&sim->ft, f);
+    if (key == FRAME_EMPTY || ksm_is_stable_key((unsigned long)key)) return;
+    k->scanned++;
+
+    int e = cuckoo_find(&k->pages, (unsigned long)key);
+    if (e < 0 || !(k->flags[e] & KSM_KNOWN)) return;
+
+    // Like ksmd, only merge pages whose checksum held still for a pass
+    if (!(k->flags[e] & KSM_CHECKED)) {
+        k->flags[e] |= KSM_CHECKED;
+        return;
+    }
+
+    unsigned long long c = k->content[e];
+    if (c == 0) {
+        sim_release_frame(sim, f);
+        k->flags[e] |= KSM_MERGED | KSM_ZERO;
+        k->zero_pages++;
+        k->zero_merged++;
+        note_saved(k);
+        return;
+    }
+
+    int s = cuckoo_find(&k->stable, content_key(c));
+    if (s >= 0) {
+        merge_into(sim, e, f, s);
+        return;
+    }
+
+    // A still-valid unstable candidate with the same content becomes the
+    // stable frame; otherwise this page becomes the candidate.
+    int u = cuckoo_find(&k->unstable, content_key(c));
+    if (u >= 0 && u != e && (k->flags[u] & (KSM_KNOWN | KSM_CHECKED | KSM_MERGED)) ==
+                            (KSM_KNOWN | KSM_CHECKED) && k->content[u] == c) {
+        int fu = sim_frame_of(sim, k->key[u]);
+        if (fu >= 0) {
+            s = new_stable(k, fu, c);
+            if (s < 0) return;
+            sim_unmap_frame(sim, fu);
+            sim_map_frame(sim, fu, stable_key(s));
+            merge_into(sim, u, -1, s);
+            merge_into(sim, e, f, s);
+            cuckoo_erase(&k->unstable, content_key(c));
+            return;
+        }
+    }
+    cuckoo_insert(&k->unstable, content_key(c), e);
+}
+
+void ksm_tick(Simulator *sim) {
+    Ksm *k = sim->ksm;
+    if (sim->tick % (unsigned long)k->cfg.interval != 0) return;
+    k->batches++;
+
+    int n = sim->cfg.num_frames;
+    for (int i = 0; i < k->cfg.pages_to_scan; i++) {
+        scan_frame(sim, k->cursor);
+        if (++k->cursor == n) {
+            // End of a pass: the unstable tree is rebuilt from scratch
+            k->cursor = 0;
+            cuckoo_free(&k->unstable);
+            cuckoo_init(&k->unstable, 1024);
+        }
+    }
+}
+
+void ksm_print_stats(const Ksm *k, long long accesses) {
+    double cost = (double)k->scanned * k->cfg.page_cost;
+
+    printf("\n--- Same-page merging ---\n");
+    printf("Scan: %d pages every %ld accesses (%lld batches, %lld pages scanned)\n",
+           k->cfg.pages_to_scan, k->cfg.interval, k->batches, k->scanned);
+    printf("Scan CPU cost: %.0f cycles (%.2f cycles/access)\n", cost,
+           accesses > 0 ? cost / (double)accesses : 0.0);
+    printf("Pages merged: %lld (+%lld zero pages)\n", k->merged, k->zero_merged);
+    printf("Pages shared: %lld, sharing: %lld, zero-mapped: %lld\n",
+           k->pages_shared, k->pages_sharing, k->zero_pages);
+    printf("Frames saved: %lld now, %lld peak\n",
+           k->pages_sharing + k->zero_pages, k->peak_saved);
+    printf("COW breaks: %lld\n", k->cow_breaks);
+    printf("Stable frames evicted: %lld\n", k->stable_evictions);
+}
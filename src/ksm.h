@@ -0,0 +1,92 @@
+#ifndef KSM_H
+#define KSM_H
+
+#include "cuckoo.h"
+
+// Kernel same-page merging model. Traces may tag writes with the content
+// hash of the page after the write ("W 0x1000 =9f3c"; "=0" is a zero page).
+// A scanner walks resident frames a batch at a time. A page whose hash did
+// not change since the previous pass is merged: into the zero page if it
+// is all zeroes, into an existing stable (shared, write-protected) frame
+// with the same hash, or, together with an earlier candidate from the
+// unstable tree, into a new stable frame. Merged pages give their frames
+// back. A write to a merged page is a copy-on-write break, which needs a
+// fresh frame again. Evicting a stable frame drops all of its sharers;
+// the frame is swapped out once, and each sharer's next fault reads it.
+
+struct Simulator;
+
+typedef struct {
+    int pages_to_scan;      // frames examined per batch
+    long interval;          // accesses between batches
+    double page_cost;       // cycles to checksum or compare one page
+} KsmConfig;
+
+// Stable frames are owned by a reserved address space in the page key
+#define KSM_ASID           0xffffUL
+#define KSM_ZERO_FRAME     (-2)
+
+typedef struct Ksm {
+    KsmConfig cfg;
+
+    // Pages whose content has been reported, indexed through `pages`
+    CuckooMap pages;                // page key -> entry
+    unsigned long *key;
+    unsigned long long *content;
+    unsigned char *flags;
+    int *stable_of;                 // stable frame a merged entry maps
+    int nentries, entries_cap;
+
+    // Stable frames
+    CuckooMap stable;               // content -> stable index
+    int *sframe;                    // frame, or -1 once freed or evicted
+    int *sharers;
+    unsigned long long *scontent;
+    int nstable, stable_cap;
+
+    CuckooMap unstable;             // content -> entry, rebuilt every pass
+    int cursor;                     // next frame to scan
+
+    long long batches, scanned;
+    long long merged, zero_merged, cow_breaks, stable_evictions;
+    long long pages_shared;         // live stable frames
+    long long pages_sharing;        // frames saved by stable sharing
+    long long zero_pages;           // pages mapped to the zero page
+    long long peak_saved;
+} Ksm;
+
+void ksm_config_defaults(KsmConfig *kc);
+
+int  ksm_init(Ksm *k, const KsmConfig *kc);
+void ksm_free(Ksm *k);
+
+// Frame a merged page reads from (KSM_ZERO_FRAME for the zero page), or -1
+// if the page is not merged or its stable frame has been evicted.
+int  ksm_lookup(struct Simulator *sim, unsigned long key);
+
+// Unmerges a page about to be written; the caller gives it a new frame.
+void ksm_cow_break(struct Simulator *sim, unsigned long key);
+
+// Content tracking: a write makes the content unknown until it is reported.
+void ksm_note_write(struct Simulator *sim, unsigned long key);
+void ksm_set_content(struct Simulator *sim, unsigned long key,
+                     unsigned long long content);
+
+// Eviction of the frame holding `key`. An evicted stable frame goes to
+// swap once, under its own key.
+void ksm_evicted(struct Simulator *sim, unsigned long key);
+
+// A fault brings `key` back; a major one reads it from swap, from the
+// stable frame's copy if the page was merged into one since evicted
+void ksm_fault(struct Simulator *sim, unsigned long key, int major);
+
+// Runs a scan batch when one is due
+void ksm_tick(struct Simulator *sim);
+
+void ksm_print_stats(const Ksm *k, long long accesses);
+
+static inline int ksm_is_stable_key(unsigned long key) {
+    return (key >> 48) == KSM_ASID;
+}
+
+#endif
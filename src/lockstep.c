@@ -0,0 +1,178 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lockstep.h"
+
+typedef struct {
+    TraceRecord rec[LOCKSTEP_BLOCK];
+    int n;
+    int refs;                   // policies yet to replay the block
+} Block;
+
+typedef struct {
+    Block ring[LOCKSTEP_RING];
+    long produced;              // blocks filled so far
+    int done;                   // the trace has ended
+    pthread_mutex_t lock;
+    pthread_cond_t filled, freed;
+} Ring;
+
+typedef struct {
+    Ring *ring;
+    Simulator sim;
+    long next;                  // next block to replay
+    double cpu;                 // seconds of this thread's CPU time
+    int rc;
+} Worker;
+
+static void replay(Worker *w, const Block *b) {
+    for (int i = 0; i < b->n && w->rc == 0; i++)
+        if (sim_replay_record(&w->sim, &b->rec[i]) < 0) w->rc = -1;
+}
+
+static void *worker_run(void *arg) {
+    Worker *w = (Worker *)arg;
+    Ring *r = w->ring;
+    for (;;) {
+        pthread_mutex_lock(&r->lock);
+        while (w->next == r->produced && !r->done) pthread_cond_wait(&r->filled, &r->lock);
+        int end = w->next == r->produced;
+        pthread_mutex_unlock(&r->lock);
+        if (end) break;
+
+        // A failed policy keeps releasing blocks so the others go on
+        Block *b = &r->ring[w->next % LOCKSTEP_RING];
+        if (w->rc == 0) replay(w, b);
+        w->next++;
+
+        pthread_mutex_lock(&r->lock);
+        if (--b->refs == 0) pthread_cond_signal(&r->freed);
+        pthread_mutex_unlock(&r->lock);
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    w->cpu = (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+    return NULL;
+}
+
+// Parser side: fills free blocks until the trace ends
+static long long produce(Ring *r, TraceReader *tr, int n) {
+    long long records = 0;
+    for (;;) {
+        pthread_mutex_lock(&r->lock);
+        Block *b = &r->ring[r->produced % LOCKSTEP_RING];
+        while (b->refs > 0) pthread_cond_wait(&r->freed, &r->lock);
+        pthread_mutex_unlock(&r->lock);
+
+        b->n = 0;
+        while (b->n < LOCKSTEP_BLOCK && trace_next(tr, &b->rec[b->n])) b->n++;
+        records += b->n;
+        if (b->n > 0) {
+            pthread_mutex_lock(&r->lock);
+            b->refs = n;
+            r->produced++;
+            pthread_cond_broadcast(&r->filled);
+            pthread_mutex_unlock(&r->lock);
+        }
+        if (b->n < LOCKSTEP_BLOCK) break;
+    }
+    pthread_mutex_lock(&r->lock);
+    r->done = 1;
+    pthread_cond_broadcast(&r->filled);
+    pthread_mutex_unlock(&r->lock);
+    return records;
+}
+
+static void print_table(const Worker *w, int n, double wall, long long records) {
+    printf("\n--- Lockstep policies ---\n");
+    printf("Trace: %lld records in one pass, %.2f s; %d policies on their own threads\n",
+           records, wall, n);
+    printf("%-12s %12s %9s %12s %12s %14s %8s\n", "policy", "faults", "rate",
+           "major", "write-backs", "AMAT", "cpu s");
+    for (int i = 0; i < n; i++) {
+        const SimStats *st = &w[i].sim.stats;
+        long long accesses = st->trace_accesses > 0 ? st->trace_accesses
+                                                    : st->reads + st->writes;
+        printf("%-12.12s %12lld %8.2f%% %12lld %12lld %14.1f %8.2f%s\n",
+               sim_alg_name(&w[i].sim), st->page_faults,
+               accesses > 0 ? 100.0 * (double)st->page_faults / (double)accesses : 0.0,
+               st->major_faults, st->write_backs, sim_amat(&w[i].sim), w[i].cpu,
+               w[i].rc != 0 ? "  (failed)" : "");
+    }
+}
+
+int lockstep_run(const SimConfig *cfgs, int n, TraceReader *tr, const SwapConfig *swap,
+                 const SsdConfig *ssd, const FarConfig *far) {
+    Ring *r = (Ring *)calloc(1, sizeof(Ring));
+    Worker *w = (Worker *)calloc((size_t)n, sizeof(Worker));
+    pthread_t *tid = (pthread_t *)malloc((size_t)n * sizeof(pthread_t));
+    if (!r || !w || !tid) {
+        perror("Error allocating lockstep ring");
+        free(r);
+        free(w);
+        free(tid);
+        return -1;
+    }
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->filled, NULL);
+    pthread_cond_init(&r->freed, NULL);
+
+    int ready = 0, rc = 0;
+    for (; ready < n; ready++) {
+        w[ready].ring = r;
+        if (sim_init(&w[ready].sim, &cfgs[ready]) != 0) {
+            rc = -1;
+            break;
+        }
+        if ((swap && sim_enable_swap(&w[ready].sim, swap) != 0) ||
+            (ssd && sim_enable_ssd(&w[ready].sim, ssd) != 0) ||
+            (far && sim_enable_far(&w[ready].sim, far) != 0)) {
+            sim_free(&w[ready].sim);
+            rc = -1;
+            break;
+        }
+    }
+
+    int started = 0;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (; rc == 0 && started < n; started++) {
+        if (pthread_create(&tid[started], NULL, worker_run, &w[started]) != 0) {
+            perror("Error starting policy thread");
+            rc = -1;
+            break;
+        }
+    }
+    // Without all threads the blocks would never be freed; end at once
+    long long records = rc == 0 ? produce(r, tr, n) : 0;
+    if (rc != 0) {
+        pthread_mutex_lock(&r->lock);
+        r->done = 1;
+        pthread_cond_broadcast(&r->filled);
+        pthread_mutex_unlock(&r->lock);
+    }
+    for (int i = 0; i < started; i++) pthread_join(tid[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    // A filtered trace is rated against the accesses it was made from
+    if (tr->filter)
+        for (int i = 0; i < n; i++) w[i].sim.stats.trace_accesses = tr->accesses;
+    if (rc == 0) {
+        print_table(w, n, (double)(t1.tv_sec - t0.tv_sec) +
+                              1e-9 * (double)(t1.tv_nsec - t0.tv_nsec), records);
+        for (int i = 0; i < n; i++)
+            if (w[i].rc != 0) rc = -1;
+    }
+
+    for (int i = 0; i < ready; i++) sim_free(&w[i].sim);
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->filled);
+    pthread_cond_destroy(&r->freed);
+    free(r);
+    free(w);
+    free(tid);
+    return rc;
+}
@@ -0,0 +1,21 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "sim.h"
+#include "trace.h"
+
+// Lockstep mode (-a fifo,lru,clock): one pass over the trace drives a
+// simulator per policy, each on its own thread. The parser fills blocks of
+// decoded records in a ring. A block is handed to every policy at once and
+// counts the policies that have yet to replay it; the last one to finish
+// frees it for the parser. Nothing but the ring is held in memory, and the
+// slowest policy sets the pace.
+
+#define LOCKSTEP_BLOCK 4096     // records per block
+#define LOCKSTEP_RING  16       // blocks in flight
+
+// cfgs[i]: the configuration of policy i; swap, ssd and far may be NULL
+int lockstep_run(const SimConfig *cfgs, int n, TraceReader *tr, const SwapConfig *swap,
+                 const SsdConfig *ssd, const FarConfig *far);
+
+#endif
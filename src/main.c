@@ -2,133 +2,708 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define PAGE_SIZE 4096
-#define DEFAULT_NUM_FRAMES 3
+#include "cstack.h"
+#include "lockstep.h"
+#include "mrc.h"
+#include "partition.h"
+#include "sched.h"
+#include "serve.h"
+#include "sizing.h"
+#include "sim.h"
+#include "trace.h"
 
-typedef enum { ALG_FIFO, ALG_LRU, ALG_CLOCK } Algorithm;
-typedef enum { WP_WRITE_THROUGH, WP_WRITE_BACK } WritePolicy;
-
-typedef struct {
-    int valid;
-    unsigned int vpn;
-    int frame_index;
-    unsigned long last_used; // for TLB LRU
-} TLBEntry;
+static void usage(const char *prog) {
+    printf("Usage: %s -a fifo|lru|clock|srrip|brrip|drrip|ship|plugin:path.so[:args][,...] "
+           "[-rrpv-bits 2|3] [-f num_frames] [-t tlb_entries] "
+           "[-wt | -wb] [-pt flat|inverted|cuckoo] [-compact] [-q] "
+           "[-swapcache pages] [-lat tlb|mem|zero|minor|disk=cycles] "
+           "[-swap slots [-readahead none|slot|vma] [-ra pages]] "
+           "[-ssd [-ssd-geom channels,dies] [-ssd-lat read,prog,erase] "
+           "[-ssd-qd depth] [-ssd-op fraction]] "
+           "[-far [-far-rtt cycles] [-far-bw bytes/cycle] [-far-cost msg,page] "
+           "[-far-batch pages] [-far-sock path] [-far-sweep]] "
+           "[-rle] [-filter entries] [-ksm pages [-ksm-interval accesses]] "
+           "[-damon [-damon-sample accesses] [-damon-aggr samples] "
+           "[-damon-regions min,max] [-damon-pageout intervals]] "
+           "[-reclaim-slo refaults/access [-reclaim-period accesses]] "
+           "[-dirty background,limit [-dirty-expire accesses] [-dirty-lat cycles]] "
+           "<tracefile>...\n", prog);
+    printf("       %s -a opt-mrc [-f max_frames] [-mrc-csv path] [-mrc-threads n] [-rle] <tracefile>...\n",
+           prog);
+    printf("       %s -mrc-window accesses [-mrc-step accesses] [-mrc-csv path] [-rle] "
+           "<tracefile>...\n", prog);
+    printf("       %s -partition -f total_frames [-part-slo rate,...] [-rle] "
+           "<tracefile>...\n", prog);
+    printf("       %s -target-fault-rate rate | -target-amat cycles [-search-threads n] "
+           "[options] <tracefile>...\n", prog);
+    printf("       %s -mp max_procs [-sched rr|cfs] [-quantum accesses] "
+           "[-disks n] [options] <tracefile>...\n", prog);
+    printf("       %s [-collapse] [-filter entries] -o <outfile> <tracefile>...\n",
+           prog);
+    printf("       %s -serve <socket> [-serve-workers n] [options] <tracefile>...\n", prog);
+    printf("       %s -far-serve <socket>\n", prog);
+}
 
-static void print_frames(const int *frames, int n) {
-    printf("Frames: [");
-    for (int i = 0; i < n; i++) {
-        if (frames[i] == -1) printf(" -");
-        else printf(" %d", frames[i]);
-    }
-    printf(" ]\n");
+// "-lat kind=cycles" overrides one latency
+static int parse_latency(SimConfig *cfg, const char *arg) {
+    const char *eq = strchr(arg, '=');
+    if (!eq) return -1;
+    size_t len = (size_t)(eq - arg);
+    double v = atof(eq + 1);
+    if (v < 0.0) return -1;
+
+    if      (len == 3 && strncmp(arg, "tlb", 3) == 0)   cfg->tlb_lat = v;
+    else if (len == 3 && strncmp(arg, "mem", 3) == 0)   cfg->mem_lat = v;
+    else if (len == 4 && strncmp(arg, "zero", 4) == 0)  cfg->zero_lat = v;
+    else if (len == 5 && strncmp(arg, "minor", 5) == 0) cfg->minor_lat = v;
+    else if (len == 4 && strncmp(arg, "disk", 4) == 0)  cfg->disk_lat = v;
+    else return -1;
+    return 0;
 }
 
-static int tlb_lookup(TLBEntry *tlb, int tlb_size, unsigned int vpn,
-                      unsigned long tick, int *out_frame) {
-    if (!tlb || tlb_size <= 0) return 0;
-    for (int i = 0; i < tlb_size; i++) {
-        if (tlb[i].valid && tlb[i].vpn == vpn) {
-            tlb[i].last_used = tick;
-            *out_frame = tlb[i].frame_index;
-            return 1; // hit
+// "-a fifo,lru,clock": one configuration per policy, the rest shared.
+// The names are cut out of list in place. Returns the count or -1.
+static int parse_algorithm_list(const SimConfig *base, char *list, SimConfig **out) {
+    int n = 1;
+    for (const char *c = list; *c; c++) n += *c == ',';
+    SimConfig *cfgs = (SimConfig *)malloc((size_t)n * sizeof(SimConfig));
+    if (!cfgs) return -1;
+    char *name = list;
+    for (int i = 0; i < n; i++) {
+        char *comma = strchr(name, ',');
+        if (comma) *comma = '\0';
+        cfgs[i] = *base;
+        if (sim_config_algorithm(&cfgs[i], name) != 0) {
+            fprintf(stderr, "Unknown policy: %s\n", name);
+            free(cfgs);
+            return -1;
         }
+        if (comma) name = comma + 1;
     }
-    return 0; // miss
+    *out = cfgs;
+    return n;
 }
 
-static void tlb_insert(TLBEntry *tlb, int tlb_size, unsigned int vpn,
-                       int frame_index, unsigned long tick) {
-    if (!tlb || tlb_size <= 0) return;
+// Several trace files are merged by timestamp into one stream
+static int open_traces(TraceReader *tr, char **traces, int ntraces, int collapse) {
+    if (ntraces == 1) return trace_open(tr, traces[0], collapse);
+    return trace_open_merged(tr, traces, ntraces, collapse);
+}
 
-    // If already there, update it
-    for (int i = 0; i < tlb_size; i++) {
-        if (tlb[i].valid && tlb[i].vpn == vpn) {
-            tlb[i].frame_index = frame_index;
-            tlb[i].last_used = tick;
-            return;
-        }
+// Preprocessing: write the trace back out, collapsed, filtered and/or merged
+static int preprocess_trace(char **traces, int ntraces, const char *out_path,
+                            int collapse, int filter_entries) {
+    TraceReader tr;
+    if (open_traces(&tr, traces, ntraces, collapse) != 0) {
+        perror("Error opening trace file");
+        return 1;
+    }
+    if (filter_entries > 0 && trace_set_filter(&tr, filter_entries) != 0) {
+        perror("Error allocating trace filter");
+        trace_close(&tr);
+        return 1;
+    }
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        perror("Error opening output file");
+        trace_close(&tr);
+        return 1;
     }
 
-    // Find empty slot
-    for (int i = 0; i < tlb_size; i++) {
-        if (!tlb[i].valid) {
-            tlb[i].valid = 1;
-            tlb[i].vpn = vpn;
-            tlb[i].frame_index = frame_index;
-            tlb[i].last_used = tick;
-            return;
-        }
+    TraceRecord rec;
+    while (trace_next(&tr, &rec)) trace_write(out, &rec);
+
+    long long in_accesses = tr.accesses;
+    if (filter_entries > 0) {
+        fprintf(out, "# filtered by %d-entry LRU: exact for LRU with >= %d frames; "
+                "%lld accesses dropped, %lld records re-emitted, %lld passed through\n",
+                filter_entries, filter_entries, tr.filtered, tr.reemitted, tr.passed);
     }
 
-    // Evict LRU entry
-    int victim = 0;
-    for (int i = 1; i < tlb_size; i++) {
-        if (tlb[i].last_used < tlb[victim].last_used) victim = i;
+    trace_close(&tr);
+    fclose(out);
+
+    printf("Wrote %lld records for %lld accesses", tr.records, in_accesses);
+    if (tr.records > 0) {
+        printf(" (%.2fx)", (double)in_accesses / (double)tr.records);
     }
-    tlb[victim].valid = 1;
-    tlb[victim].vpn = vpn;
-    tlb[victim].frame_index = frame_index;
-    tlb[victim].last_used = tick;
+    printf("\n");
+    return 0;
 }
 
-static void tlb_invalidate_vpn(TLBEntry *tlb, int tlb_size, unsigned int vpn) {
-    if (!tlb || tlb_size <= 0) return;
-    for (int i = 0; i < tlb_size; i++) {
-        if (tlb[i].valid && tlb[i].vpn == vpn) {
-            tlb[i].valid = 0;
-        }
+// One far-memory run of the whole trace; returns the simulated time or -1
+static double far_run(const SimConfig *cfg, const SwapConfig *swc, const FarConfig *fc,
+                      char **traces, int ntraces, int collapse, SimStats *stats) {
+    TraceReader tr;
+    if (open_traces(&tr, traces, ntraces, collapse) != 0) {
+        perror("Error opening trace file");
+        return -1.0;
     }
+    Simulator sim;
+    if (sim_init(&sim, cfg) != 0) {
+        trace_close(&tr);
+        return -1.0;
+    }
+    if (sim_enable_swap(&sim, swc) != 0 || sim_enable_far(&sim, fc) != 0) {
+        sim_free(&sim);
+        trace_close(&tr);
+        return -1.0;
+    }
+
+    TraceRecord rec;
+    int failed = 0;
+    while (!failed && trace_next(&tr, &rec))
+        if (sim_replay_record(&sim, &rec) < 0) failed = 1;
+
+    // An address it cannot simulate fails the run
+    double t = failed ? -1.0 : sim.now;
+    *stats = sim.stats;
+    trace_close(&tr);
+    sim_free(&sim);
+    return t;
 }
 
-static void usage(const char *prog) {
-    printf("Usage: %s -a fifo|lru|clock [-f num_frames] [-t tlb_entries] "
-           "[-wt | -wb] <tracefile>\n", prog);
+// Far-memory sweep: runtime with a shrinking share of the footprint in
+// local memory, against all of it fitting locally
+static int far_sweep(const SimConfig *base, const SwapConfig *base_swc,
+                     const FarConfig *fc, char **traces, int ntraces, int collapse) {
+    static const int local_pct[] = { 100, 75, 50, 25, 10, 5 };
+
+    TraceReader tr;
+    CuckooMap pages;
+    if (open_traces(&tr, traces, ntraces, collapse) != 0) {
+        perror("Error opening trace file");
+        return 1;
+    }
+    if (cuckoo_init(&pages, 1024) != 0) {
+        perror("Error allocating footprint map");
+        trace_close(&tr);
+        return 1;
+    }
+    TraceRecord rec;
+    long footprint = 0;
+    while (trace_next(&tr, &rec)) {
+        if (rec.op != 'R' && rec.op != 'W') continue;
+        unsigned long key = rec.addr / PAGE_SIZE;
+        if (cuckoo_find(&pages, key) < 0) {
+            cuckoo_insert(&pages, key, 0);
+            footprint++;
+        }
+    }
+    cuckoo_free(&pages);
+    trace_close(&tr);
+
+    printf("\n--- Far memory sweep (footprint %ld pages) ---\n", footprint);
+    printf("%6s %8s %12s %14s %16s %9s\n", "local", "frames", "major flt",
+           "wait/fault", "cycles", "slowdown");
+
+    double local_time = 0.0;
+    for (size_t i = 0; i < sizeof(local_pct) / sizeof(local_pct[0]); i++) {
+        SimConfig cfg = *base;
+        cfg.num_frames = (int)(footprint * local_pct[i] / 100);
+        if (cfg.num_frames < 1) cfg.num_frames = 1;
+        cfg.quiet = 1;
+        // Room for every page plus the slots parked in per-CPU caches
+        SwapConfig swc = *base_swc;
+        swc.slots = (int)footprint + swc.cluster * 2 + swc.cpu_cache * SWAP_MAX_CPUS;
+
+        SimStats st;
+        double t = far_run(&cfg, &swc, fc, traces, ntraces, collapse, &st);
+        if (t < 0.0) return 1;
+        if (i == 0) local_time = t;
+
+        printf("%5d%% %8d %12lld %14.0f %16.0f %8.2fx\n", local_pct[i],
+               cfg.num_frames, st.major_faults,
+               st.major_faults > 0 ? st.major_wait / (double)st.major_faults : 0.0,
+               t, local_time > 0.0 ? t / local_time : 0.0);
+    }
+    return 0;
 }
 
-int main(int argc, char *argv[]) {
+// Everything but the trace list, which main owns so that every return
+// path frees it
+static int run(int argc, char *argv[], char **traces) {
     printf("OS Simulator starting...\n");
 
-    Algorithm alg = ALG_FIFO;
-    WritePolicy write_policy = WP_WRITE_THROUGH;
-    int tlb_size = 0;
-    int num_frames = DEFAULT_NUM_FRAMES;
+    SimConfig cfg;
+    sim_config_defaults(&cfg);
+    int rle = 0;
+    int filter_entries = 0;
+    const char *out_path = NULL;
     const char *trace_path = NULL;
+    SchedConfig sc;
+    sched_config_defaults(&sc);
+    KsmConfig kc;
+    ksm_config_defaults(&kc);
+    int ksm = 0;
+    DamonConfig dc;
+    damon_config_defaults(&dc);
+    int damon = 0;
+    ReclaimConfig rcc;
+    reclaim_config_defaults(&rcc);
+    int reclaim = 0;
+    WritebackConfig wbc;
+    writeback_config_defaults(&wbc);
+    int dirty = 0;
+    SwapConfig swc;
+    swap_config_defaults(&swc);
+    SsdConfig ssc;
+    ssd_config_defaults(&ssc);
+    int ssd = 0;
+    FarConfig fc;
+    far_config_defaults(&fc);
+    int far = 0, far_sweep_on = 0;
+    int mp = 0;
+    int opt_mrc = 0, frames_set = 0, mrc_threads = 1;
+    char *alg_list = NULL;
+    long mrc_window = 0, mrc_step = 64;
+    int partition = 0;
+    SizingConfig zc = {0};
+    zc.threads = 4;
+    const char *part_slo = NULL;
+    const char *mrc_csv = NULL;
+    const char *serve_path = NULL;
+    int serve_workers = SERVE_WORKERS;
+    int ntraces = 0;
 
     // ---- Parse args ----
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-a") == 0) {
             if (i + 1 >= argc) { usage(argv[0]); return 1; }
             i++;
-            if      (strcmp(argv[i], "fifo")  == 0) alg = ALG_FIFO;
-            else if (strcmp(argv[i], "lru")   == 0) alg = ALG_LRU;
-            else if (strcmp(argv[i], "clock") == 0) alg = ALG_CLOCK;
-            else { usage(argv[0]); return 1; }
+            if (strcmp(argv[i], "opt-mrc") == 0) opt_mrc = 1;
+            else if (strchr(argv[i], ',')) alg_list = argv[i];
+            else if (sim_config_algorithm(&cfg, argv[i]) != 0) { usage(argv[0]); return 1; }
+
+        } else if (strcmp(argv[i], "-rrpv-bits") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            cfg.rrpv_bits = atoi(argv[i]);
+            if (cfg.rrpv_bits != 2 && cfg.rrpv_bits != 3) {
+                fprintf(stderr, "RRPVs are 2 or 3 bits\n");
+                return 1;
+            }
 
         } else if (strcmp(argv[i], "-f") == 0) {
             if (i + 1 >= argc) { usage(argv[0]); return 1; }
             i++;
-            num_frames = atoi(argv[i]);
-            if (num_frames <= 0) {
+            cfg.num_frames = atoi(argv[i]);
+            frames_set = 1;
+            if (cfg.num_frames <= 0) {
                 fprintf(stderr, "Number of frames must be > 0\n");
                 return 1;
             }
 
+        } else if (strcmp(argv[i], "-mrc-csv") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            mrc_csv = argv[i];
+
+        } else if (strcmp(argv[i], "-partition") == 0) {
+            partition = 1;
+
+        } else if (strcmp(argv[i], "-part-slo") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            partition = 1;
+            part_slo = argv[i];
+
+        } else if (strcmp(argv[i], "-target-fault-rate") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            zc.fault_rate = atof(argv[i]);
+            // Fractions or percentages
+            if (zc.fault_rate >= 1.0) zc.fault_rate /= 100.0;
+            if (zc.fault_rate <= 0.0 || zc.fault_rate >= 1.0) {
+                fprintf(stderr, "Target fault rate must be between 0 and 1\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-target-amat") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            zc.amat = atof(argv[i]);
+            if (zc.amat <= 0.0) {
+                fprintf(stderr, "Target AMAT must be > 0 cycles\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-search-threads") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            zc.threads = atoi(argv[i]);
+            if (zc.threads <= 0) {
+                fprintf(stderr, "Number of threads must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-serve") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            serve_path = argv[++i];
+
+        } else if (strcmp(argv[i], "-serve-workers") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            serve_workers = atoi(argv[i]);
+            if (serve_workers <= 0) {
+                fprintf(stderr, "Number of workers must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-mrc-window") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            mrc_window = atol(argv[i]);
+            if (mrc_window <= 0) {
+                fprintf(stderr, "Window must be > 0 accesses\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-mrc-step") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            mrc_step = atol(argv[i]);
+            if (mrc_step <= 0) {
+                fprintf(stderr, "Counter step must be > 0 accesses\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-mrc-threads") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            mrc_threads = atoi(argv[i]);
+            if (mrc_threads <= 0) {
+                fprintf(stderr, "Number of threads must be > 0\n");
+                return 1;
+            }
+
         } else if (strcmp(argv[i], "-t") == 0) {
             if (i + 1 >= argc) { usage(argv[0]); return 1; }
             i++;
-            tlb_size = atoi(argv[i]);
-            if (tlb_size < 0) tlb_size = 0;
+            cfg.tlb_size = atoi(argv[i]);
+            if (cfg.tlb_size < 0) cfg.tlb_size = 0;
 
         } else if (strcmp(argv[i], "-wt") == 0) {
-            write_policy = WP_WRITE_THROUGH;
+            cfg.write_policy = WP_WRITE_THROUGH;
 
         } else if (strcmp(argv[i], "-wb") == 0) {
-            write_policy = WP_WRITE_BACK;
+            cfg.write_policy = WP_WRITE_BACK;
+
+        } else if (strcmp(argv[i], "-pt") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            if      (strcmp(argv[i], "flat")     == 0) cfg.pt_mode = PT_FLAT;
+            else if (strcmp(argv[i], "inverted") == 0) cfg.pt_mode = PT_INVERTED;
+            else if (strcmp(argv[i], "cuckoo")   == 0) cfg.pt_mode = PT_CUCKOO;
+            else { usage(argv[0]); return 1; }
+
+        } else if (strcmp(argv[i], "-compact") == 0) {
+            cfg.compact = 1;
+
+        } else if (strcmp(argv[i], "-q") == 0) {
+            cfg.quiet = 1;
+
+        } else if (strcmp(argv[i], "-swapcache") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            cfg.swap_cache = atoi(argv[i]);
+            if (cfg.swap_cache < 0) cfg.swap_cache = 0;
+
+        } else if (strcmp(argv[i], "-lat") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            if (parse_latency(&cfg, argv[i]) != 0) { usage(argv[0]); return 1; }
+
+        } else if (strcmp(argv[i], "-swap") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            swc.slots = atoi(argv[i]);
+            if (swc.slots <= 0) {
+                fprintf(stderr, "Swap slots must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-readahead") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            if      (strcmp(argv[i], "none") == 0) swc.readahead = RA_NONE;
+            else if (strcmp(argv[i], "slot") == 0) swc.readahead = RA_SLOT;
+            else if (strcmp(argv[i], "vma")  == 0) swc.readahead = RA_VMA;
+            else { usage(argv[0]); return 1; }
+
+        } else if (strcmp(argv[i], "-ra") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            swc.ra_pages = atoi(argv[i]);
+            if (swc.ra_pages <= 0 || swc.ra_pages > SWAP_RA_MAX ||
+                (swc.ra_pages & (swc.ra_pages - 1)) != 0) {
+                fprintf(stderr, "Readahead must be a power of two up to %d\n",
+                        SWAP_RA_MAX);
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-ssd") == 0) {
+            ssd = 1;
+
+        } else if (strcmp(argv[i], "-ssd-geom") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            if (sscanf(argv[i], "%d,%d", &ssc.channels, &ssc.dies_per_channel) != 2 ||
+                ssc.channels <= 0 || ssc.dies_per_channel <= 0) {
+                usage(argv[0]);
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-ssd-lat") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            if (sscanf(argv[i], "%lf,%lf,%lf", &ssc.read_lat, &ssc.prog_lat,
+                       &ssc.erase_lat) != 3 ||
+                ssc.read_lat < 0.0 || ssc.prog_lat < 0.0 || ssc.erase_lat < 0.0) {
+                usage(argv[0]);
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-ssd-qd") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            ssc.queue_depth = atoi(argv[i]);
+            if (ssc.queue_depth <= 0) {
+                fprintf(stderr, "SSD queue depth must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-ssd-op") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            ssc.op = atof(argv[i]);
+            if (ssc.op <= 0.0) {
+                fprintf(stderr, "SSD over-provisioning must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-far") == 0) {
+            far = 1;
+
+        } else if (strcmp(argv[i], "-far-rtt") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            fc.rtt = atof(argv[i]);
+            if (fc.rtt < 0.0) { usage(argv[0]); return 1; }
+
+        } else if (strcmp(argv[i], "-far-bw") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            fc.bandwidth = atof(argv[i]);
+            if (fc.bandwidth <= 0.0) {
+                fprintf(stderr, "Far-memory bandwidth must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-far-cost") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            if (sscanf(argv[i], "%lf,%lf", &fc.msg_cost, &fc.page_cost) != 2 ||
+                fc.msg_cost < 0.0 || fc.page_cost < 0.0) {
+                usage(argv[0]);
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-far-batch") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            fc.batch = atoi(argv[i]);
+            if (fc.batch <= 0) {
+                fprintf(stderr, "Far-memory batch must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-far-sock") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            fc.sock = argv[++i];
+
+        } else if (strcmp(argv[i], "-far-sweep") == 0) {
+            far = 1;
+            far_sweep_on = 1;
+
+        } else if (strcmp(argv[i], "-far-serve") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            return far_serve(argv[i + 1]) != 0;
+
+        } else if (strcmp(argv[i], "-rle") == 0) {
+            rle = 1;
+
+        } else if (strcmp(argv[i], "-collapse") == 0) {
+            rle = 1;
+
+        } else if (strcmp(argv[i], "-filter") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            filter_entries = atoi(argv[i]);
+            if (filter_entries <= 0) {
+                fprintf(stderr, "Filter entries must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-o") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            out_path = argv[++i];
+
+        } else if (strcmp(argv[i], "-mp") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            mp = 1;
+            sc.max_procs = atoi(argv[i]);
+            if (sc.max_procs <= 0 || sc.max_procs > 0xffff) {
+                fprintf(stderr, "Process count must be in 1..65535\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-sched") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            if      (strcmp(argv[i], "rr")  == 0) sc.policy = SCHED_RR;
+            else if (strcmp(argv[i], "cfs") == 0) sc.policy = SCHED_CFS;
+            else { usage(argv[0]); return 1; }
+
+        } else if (strcmp(argv[i], "-quantum") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            sc.quantum = atol(argv[i]);
+            if (sc.quantum <= 0) {
+                fprintf(stderr, "Quantum must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-disks") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            sc.disks = atoi(argv[i]);
+            if (sc.disks <= 0) {
+                fprintf(stderr, "Number of disks must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-ksm") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            ksm = 1;
+            kc.pages_to_scan = atoi(argv[i]);
+            if (kc.pages_to_scan <= 0) {
+                fprintf(stderr, "Pages to scan must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-ksm-interval") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            kc.interval = atol(argv[i]);
+            if (kc.interval <= 0) {
+                fprintf(stderr, "Scan interval must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-damon") == 0) {
+            damon = 1;
+
+        } else if (strcmp(argv[i], "-damon-sample") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            dc.sample_interval = atol(argv[i]);
+            if (dc.sample_interval <= 0) {
+                fprintf(stderr, "Sampling interval must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-damon-aggr") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            dc.aggr_samples = atoi(argv[i]);
+            if (dc.aggr_samples <= 0) {
+                fprintf(stderr, "Samples per aggregation must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-damon-regions") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            if (sscanf(argv[i], "%d,%d", &dc.min_regions, &dc.max_regions) != 2 ||
+                dc.min_regions < 1 || dc.max_regions < 2 * dc.min_regions) {
+                fprintf(stderr, "Regions must be min,max with max >= 2 * min >= 2\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-damon-pageout") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            damon = 1;
+            dc.cold_aggrs = atoi(argv[i]);
+            if (dc.cold_aggrs <= 0) {
+                fprintf(stderr, "Pageout age must be > 0 intervals\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-reclaim-slo") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            reclaim = 1;
+            rcc.slo = atof(argv[i]);
+            if (rcc.slo <= 0.0 || rcc.slo >= 1.0) {
+                fprintf(stderr, "Refault SLO must be between 0 and 1\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-reclaim-period") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            rcc.period = atol(argv[i]);
+            if (rcc.period <= 0) {
+                fprintf(stderr, "Controller period must be > 0\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-dirty") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            dirty = 1;
+            cfg.write_policy = WP_WRITE_BACK;
+            if (sscanf(argv[i], "%lf,%lf", &wbc.background_ratio, &wbc.ratio) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            // Shares of memory, as fractions or percentages
+            if (wbc.ratio > 1.0) {
+                wbc.background_ratio /= 100.0;
+                wbc.ratio /= 100.0;
+            }
+            if (wbc.background_ratio <= 0.0 || wbc.ratio > 1.0 ||
+                wbc.background_ratio >= wbc.ratio) {
+                fprintf(stderr, "Dirty thresholds must be 0 < background < limit <= 1\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-dirty-expire") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            wbc.expire = atol(argv[i]);
+            if (wbc.expire <= 0) {
+                fprintf(stderr, "Dirty expiry must be > 0 accesses\n");
+                return 1;
+            }
+
+        } else if (strcmp(argv[i], "-dirty-lat") == 0) {
+            if (i + 1 >= argc) { usage(argv[0]); return 1; }
+            i++;
+            wbc.write_lat = atof(argv[i]);
+            if (wbc.write_lat <= 0.0) {
+                fprintf(stderr, "Page write latency must be > 0 cycles\n");
+                return 1;
+            }
 
         } else {
-            // Must be the trace file
+            // Must be a trace file
             trace_path = argv[i];
+            traces[ntraces++] = argv[i];
         }
     }
 
@@ -137,275 +712,305 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    FILE *fp = fopen(trace_path, "r");
-    if (!fp) {
-        perror("Error opening trace file");
+    if (out_path) return preprocess_trace(traces, ntraces, out_path, rle, filter_entries);
+
+    // Queries pick the policy and sizes; the rest of the command line is
+    // their default configuration
+    if (serve_path) {
+        if (mp || partition || opt_mrc || mrc_window > 0 || alg_list || far_sweep_on ||
+            zc.fault_rate > 0.0 || zc.amat > 0.0 || filter_entries > 0 || ksm || damon ||
+            reclaim || dirty || ssd || far || swc.slots > 0) {
+            fprintf(stderr, "-serve takes only the basic simulator options\n");
+            return 1;
+        }
+        cfg.quiet = 1;
+        int rc = serve_run(serve_path, &cfg, traces, ntraces, rle, serve_workers);
+        return rc != 0;
+    }
+
+    // The SSD or the remote node holds the swap space; size it to four
+    // times memory by default
+    if (ssd && far) {
+        fprintf(stderr, "-ssd and -far are alternative swap devices\n");
         return 1;
     }
-    printf("Reading trace file: %s\n", trace_path);
-
-    // ---- Stats ----
-    int reads = 0, writes = 0;
-    int page_faults = 0;
-    int tlb_hits = 0, tlb_misses = 0;
-    long long write_backs = 0;   // evictions of dirty pages
-
-    const double TLB_LAT  = 1.0;
-    const double MEM_LAT  = 100.0;
-    const double DISK_LAT = 10000000.0;
-
-    // ---- Memory frames & metadata ----
-    int *frames = (int *)malloc((size_t)num_frames * sizeof(int));
-    unsigned long *frame_last_used =
-        (unsigned long *)calloc((size_t)num_frames, sizeof(unsigned long));
-    int *ref_bits = (int *)calloc((size_t)num_frames, sizeof(int));
-    int *dirty    = (int *)calloc((size_t)num_frames, sizeof(int));
-
-    if (!frames || !frame_last_used || !ref_bits || !dirty) {
-        perror("Error allocating frame metadata");
-        fclose(fp);
-        free(frames);
-        free(frame_last_used);
-        free(ref_bits);
-        free(dirty);
+    if ((ssd || far) && swc.slots == 0) swc.slots = 4 * cfg.num_frames;
+    if (ssd) sc.ssd = &ssc;
+    if (far) sc.far = &fc;
+
+    // Readahead lands in the swap cache, so swapping needs one
+    if (swc.slots > 0 && cfg.swap_cache == 0) cfg.swap_cache = 256;
+    if (swc.slots > 0) sc.swap = &swc;
+
+    // The compact frame table is its own page table
+    if (cfg.compact && cfg.pt_mode != PT_FLAT) {
+        fprintf(stderr, "-compact cannot be combined with -pt inverted or cuckoo\n");
         return 1;
     }
 
-    for (int i = 0; i < num_frames; i++) {
-        frames[i] = -1;
-        frame_last_used[i] = 0;
-        ref_bits[i] = 0;
-        dirty[i] = 0;
+    // Stable frames use a reserved ASID; the filter drops content updates
+    if (ksm && (mp || cfg.compact || filter_entries > 0)) {
+        fprintf(stderr, "-ksm cannot be combined with -mp, -compact or -filter\n");
+        return 1;
     }
 
-    // FIFO state
-    int fifo_index = 0;
+    if (damon && mp) {
+        fprintf(stderr, "-damon cannot be combined with -mp\n");
+        return 1;
+    }
+    // The controller reads absolute last-use ticks from the wide frame table
+    if (reclaim && (mp || cfg.compact)) {
+        fprintf(stderr, "-reclaim-slo cannot be combined with -mp or -compact\n");
+        return 1;
+    }
 
-    // CLOCK state
-    int clock_hand = 0;
+    // The scheduler and the sweep build their own simulators
+    if (dirty && (mp || far_sweep_on)) {
+        fprintf(stderr, "-dirty cannot be combined with -mp or -far-sweep\n");
+        return 1;
+    }
+    // A run record loses where its writes fell, and the flusher and the
+    // throttle see every write
+    if (dirty && rle) {
+        fprintf(stderr, "-dirty cannot be combined with -rle\n");
+        return 1;
+    }
 
-    // Tick counter (for LRU timing)
-    unsigned long tick = 0;
+    if (alg_list && (mp || partition || opt_mrc || mrc_window > 0 || far_sweep_on ||
+                     zc.fault_rate > 0.0 || zc.amat > 0.0)) {
+        fprintf(stderr, "A list of policies only works for a plain run\n");
+        return 1;
+    }
 
-    // ---- Optional TLB ----
-    TLBEntry *tlb = NULL;
-    if (tlb_size > 0) {
-        tlb = (TLBEntry *)calloc((size_t)tlb_size, sizeof(TLBEntry));
-        if (!tlb) {
-            perror("Error allocating TLB");
-            fclose(fp);
-            free(frames);
-            free(frame_last_used);
-            free(ref_bits);
-            free(dirty);
+    // Runs of the same trace at different sizes, several at a time
+    if (zc.fault_rate > 0.0 || zc.amat > 0.0) {
+        if (mp || partition || opt_mrc || mrc_window > 0 || far_sweep_on ||
+            filter_entries > 0 || ksm || damon || reclaim || dirty) {
+            fprintf(stderr, "Sizing targets cannot be combined with -mp, -partition, "
+                            "-a opt-mrc, -mrc-window, -far-sweep, -filter, -ksm, "
+                            "-damon, -reclaim-slo or -dirty\n");
             return 1;
         }
+        zc.swap = sc.swap;
+        zc.ssd = sc.ssd;
+        zc.far = sc.far;
+        cfg.quiet = 1;
+        int rc = sizing_run(&cfg, &zc, traces, ntraces, rle);
+        printf("Simulation finished.\n");
+        return rc != 0;
     }
 
-    // ---- Simulation loop ----
-    char op;
-    unsigned int addr;
-
-    while (fscanf(fp, " %c %x", &op, &addr) == 2) {
-        tick++;
-
-        if (op == 'R') reads++;
-        else if (op == 'W') writes++;
-        else continue; // ignore unknown ops
-
-        unsigned int vpn = addr / PAGE_SIZE;
-
-        // 1) TLB lookup (if enabled)
-        int frame_index_from_tlb = -1;
-        if (tlb_size > 0) {
-            if (tlb_lookup(tlb, tlb_size, vpn, tick, &frame_index_from_tlb)) {
-                tlb_hits++;
-                printf("Operation: %c | Address: 0x%x | VPN: %u -> TLB HIT (frame %d)\n",
-                       op, addr, vpn, frame_index_from_tlb);
-
-                if (frame_index_from_tlb >= 0 && frame_index_from_tlb < num_frames) {
-                    if (alg == ALG_LRU) {
-                        frame_last_used[frame_index_from_tlb] = tick;
-                    }
-                    if (alg == ALG_CLOCK) {
-                        ref_bits[frame_index_from_tlb] = 1;
-                    }
-                    if (op == 'W' && write_policy == WP_WRITE_BACK) {
-                        dirty[frame_index_from_tlb] = 1;
-                    }
+    // One process per trace; the SLOs are fault rates in trace order
+    if (partition) {
+        if (mp || opt_mrc || mrc_window > 0 || far_sweep_on || filter_entries > 0) {
+            fprintf(stderr, "-partition cannot be combined with -mp, -a opt-mrc, "
+                            "-mrc-window, -far-sweep or -filter\n");
+            return 1;
+        }
+        double *slo = NULL;
+        if (part_slo) {
+            slo = (double *)calloc((size_t)ntraces, sizeof(double));
+            if (!slo) {
+                perror("Error allocating SLOs");
+                return 1;
+            }
+            const char *p = part_slo;
+            for (int k = 0; k < ntraces && *p; k++) {
+                char *end;
+                slo[k] = strtod(p, &end);
+                // Fractions or percentages
+                if (slo[k] >= 1.0) slo[k] /= 100.0;
+                if (slo[k] < 0.0 || slo[k] >= 1.0 || (*end && *end != ',')) {
+                    fprintf(stderr, "SLOs are fault rates, one per trace\n");
+                    free(slo);
+                    return 1;
                 }
-
-                print_frames(frames, num_frames);
-                continue;
-            } else {
-                tlb_misses++;
-                printf(" -> TLB MISS\n");
+                p = *end ? end + 1 : end;
             }
         }
+        int rc = partition_run(&cfg, traces, ntraces, rle, slo);
+        free(slo);
+        printf("Simulation finished.\n");
+        return rc != 0;
+    }
 
-        // 2) Check frames for HIT/MISS
-        int hit = 0;
-        int hit_frame_index = -1;
-        for (int i = 0; i < num_frames; i++) {
-            if (frames[i] == (int)vpn) {
-                hit = 1;
-                hit_frame_index = i;
-                break;
-            }
+    // The curves replay the trace themselves, once, for every size at once
+    if (opt_mrc || mrc_window > 0) {
+        if (mp || far_sweep_on || filter_entries > 0 || (opt_mrc && mrc_window > 0)) {
+            fprintf(stderr, "-a opt-mrc and -mrc-window cannot be combined with each "
+                            "other, -mp, -far-sweep or -filter\n");
+            return 1;
         }
+        TraceReader tr;
+        if (open_traces(&tr, traces, ntraces, rle) != 0) {
+            perror("Error opening trace file");
+            return 1;
+        }
+        int rc = opt_mrc ? mrc_run(&tr, frames_set ? cfg.num_frames : 0, mrc_threads, mrc_csv)
+                         : cstack_run(&tr, mrc_window, mrc_step, mrc_csv);
+        trace_close(&tr);
+        printf("Simulation finished.\n");
+        return rc != 0;
+    }
 
-        if (hit) {
-            printf("Operation: %c | Address: 0x%x | VPN: %u -> HIT\n",
-                   op, addr, vpn);
-
-            if (alg == ALG_LRU) {
-                frame_last_used[hit_frame_index] = tick;
-            }
-            if (alg == ALG_CLOCK) {
-                ref_bits[hit_frame_index] = 1;
-            }
-            if (op == 'W' && write_policy == WP_WRITE_BACK) {
-                dirty[hit_frame_index] = 1;
-            }
-
-            // Put it in TLB (common behavior)
-            if (tlb_size > 0) {
-                tlb_insert(tlb, tlb_size, vpn, hit_frame_index, tick);
-            }
+    if (far_sweep_on) {
+        if (mp || ksm || cfg.compact || filter_entries > 0) {
+            fprintf(stderr, "-far-sweep cannot be combined with -mp, -ksm, "
+                            "-compact or -filter\n");
+            return 1;
+        }
+        int rc = far_sweep(&cfg, &swc, &fc, traces, ntraces, rle);
+        printf("Simulation finished.\n");
+        return rc;
+    }
 
-        } else {
-            printf("Operation: %c | Address: 0x%x | VPN: %u -> PAGE FAULT\n",
-                   op, addr, vpn);
-            page_faults++;
-
-            // Choose victim frame
-            int victim = -1;
-
-            // If there is an empty frame, use it first
-            for (int i = 0; i < num_frames; i++) {
-                if (frames[i] == -1) {
-                    victim = i;
-                    break;
-                }
-            }
+    if (mp) {
+        // ASIDs live above bit 48 of the page key, beyond the compact layout
+        if (cfg.compact || filter_entries > 0) {
+            fprintf(stderr, "-mp cannot be combined with -compact or -filter\n");
+            return 1;
+        }
+        cfg.quiet = 1;
+        int rc = sched_sweep(&cfg, &sc, traces, ntraces);
+        printf("Simulation finished.\n");
+        return rc != 0;
+    }
 
-            if (victim == -1) {
-                if (alg == ALG_FIFO) {
-                    victim = fifo_index;
-                    fifo_index = (fifo_index + 1) % num_frames;
-
-                } else if (alg == ALG_LRU) {
-                    victim = 0;
-                    for (int i = 1; i < num_frames; i++) {
-                        if (frame_last_used[i] < frame_last_used[victim]) {
-                            victim = i;
-                        }
-                    }
-
-                } else if (alg == ALG_CLOCK) {
-                    while (1) {
-                        if (ref_bits[clock_hand] == 0) {
-                            victim = clock_hand;
-                            clock_hand = (clock_hand + 1) % num_frames;
-                            break;
-                        }
-                        ref_bits[clock_hand] = 0;
-                        clock_hand = (clock_hand + 1) % num_frames;
-                    }
-                }
-            }
+    // Several policies share one pass over the trace
+    SimConfig *cfgs = NULL;
+    int npolicies = 0;
+    if (alg_list) {
+        if (ksm || damon || reclaim || dirty) {
+            fprintf(stderr, "A list of policies cannot be combined with -ksm, -damon, "
+                            "-reclaim-slo or -dirty\n");
+            return 1;
+        }
+        cfg.quiet = 1;
+        npolicies = parse_algorithm_list(&cfg, alg_list, &cfgs);
+        if (npolicies < 0) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
 
-            // If we evict something, handle TLB + write-back
-            if (frames[victim] != -1) {
-                if (tlb_size > 0) {
-                    tlb_invalidate_vpn(tlb, tlb_size,
-                                       (unsigned int)frames[victim]);
-                }
-                if (write_policy == WP_WRITE_BACK && dirty[victim]) {
-                    write_backs++;
-                    dirty[victim] = 0;
-                }
-            }
+    TraceReader tr;
+    if (open_traces(&tr, traces, ntraces, rle) != 0) {
+        perror("Error opening trace file");
+        free(cfgs);
+        return 1;
+    }
+    if (filter_entries > 0 && trace_set_filter(&tr, filter_entries) != 0) {
+        perror("Error allocating trace filter");
+        free(cfgs);
+        trace_close(&tr);
+        return 1;
+    }
+    if (filter_entries > 0 && (cfg.alg != ALG_LRU || cfg.num_frames < filter_entries)) {
+        fprintf(stderr, "Warning: the trace filter is only exact for LRU "
+                        "with at least %d frames\n", filter_entries);
+    }
+    if (ntraces == 1) printf("Reading trace file: %s\n", trace_path);
+    else printf("Merging %d trace files by timestamp\n", ntraces);
+
+    if (cfgs) {
+        int rc = lockstep_run(cfgs, npolicies, &tr, sc.swap, sc.ssd, sc.far);
+        trace_close(&tr);
+        free(cfgs);
+        printf("Simulation finished.\n");
+        return rc != 0;
+    }
 
-            frames[victim] = (int)vpn;
+    // Per-source accesses and faults
+    long long *src_acc = NULL, *src_faults = NULL;
+    if (ntraces > 1) {
+        src_acc = (long long *)calloc((size_t)ntraces, sizeof(long long));
+        src_faults = (long long *)calloc((size_t)ntraces, sizeof(long long));
+        if (!src_acc || !src_faults) {
+            perror("Error allocating per-source stats");
+            free(src_acc);
+            free(src_faults);
+            trace_close(&tr);
+            return 1;
+        }
+    }
 
-            if (alg == ALG_LRU) {
-                frame_last_used[victim] = tick;
-            }
-            if (alg == ALG_CLOCK) {
-                ref_bits[victim] = 1;
-            }
-            if (op == 'W' && write_policy == WP_WRITE_BACK) {
-                dirty[victim] = 1;
-            }
+    Simulator sim;
+    if (sim_init(&sim, &cfg) != 0) {
+        free(src_acc);
+        free(src_faults);
+        trace_close(&tr);
+        return 1;
+    }
+    if ((ksm && sim_enable_ksm(&sim, &kc) != 0) ||
+        (damon && sim_enable_damon(&sim, &dc) != 0) ||
+        (reclaim && sim_enable_reclaim(&sim, &rcc) != 0) ||
+        (dirty && sim_enable_writeback(&sim, &wbc) != 0) ||
+        (swc.slots > 0 && sim_enable_swap(&sim, &swc) != 0) ||
+        (ssd && sim_enable_ssd(&sim, &ssc) != 0) ||
+        (far && sim_enable_far(&sim, &fc) != 0)) {
+        free(src_acc);
+        free(src_faults);
+        sim_free(&sim);
+        trace_close(&tr);
+        return 1;
+    }
 
-            // Insert new mapping into TLB
-            if (tlb_size > 0) {
-                tlb_insert(tlb, tlb_size, vpn, victim, tick);
-            }
+    // ---- Simulation loop ----
+    TraceRecord rec;
+    int failed = 0;
+    while (!failed && trace_next(&tr, &rec)) {
+        int r = sim_replay_record(&sim, &rec);
+        if (r < 0) {
+            failed = 1;
+            break;
+        }
+        if (src_acc && (rec.op == 'R' || rec.op == 'W')) {
+            src_acc[rec.src] += (long long)rec.count;
+            if (r >= ACC_FAULT) src_faults[rec.src]++;
         }
-
-        print_frames(frames, num_frames);
     }
 
-    fclose(fp);
+    trace_close(&tr);
+    if (failed) {
+        free(src_acc);
+        free(src_faults);
+        sim_free(&sim);
+        return 1;
+    }
 
     // ---- Final stats ----
-    printf("\n--- Stats ---\n");
-    printf("Algorithm: %s\n",
-           (alg == ALG_FIFO) ? "FIFO" :
-           (alg == ALG_LRU)  ? "LRU"  : "CLOCK");
-
-    printf("Write policy: %s\n",
-           (write_policy == WP_WRITE_THROUGH)
-               ? "Write-Through"
-               : "Write-Back");
-
-    printf("Frames: %d\n", num_frames);
-    printf("Reads: %d\n", reads);
-    printf("Writes: %d\n", writes);
-
-    int total_accesses = reads + writes;
-    printf("Total accesses: %d\n", total_accesses);
-    printf("Total page faults: %d\n", page_faults);
-
-    if (total_accesses > 0) {
-        double fault_rate = (double)page_faults / (double)total_accesses;
-        double hit_rate   = 1.0 - fault_rate;
-        printf("Memory hit rate: %.2f%%\n", hit_rate * 100.0);
-        printf("Page fault rate: %.2f%%\n", fault_rate * 100.0);
-    }
-
-    if (tlb_size > 0) {
-        int tlb_total = tlb_hits + tlb_misses;
-        printf("TLB entries: %d\n", tlb_size);
-        printf("TLB hits: %d\n", tlb_hits);
-        printf("TLB misses: %d\n", tlb_misses);
-
-        if (tlb_total > 0) {
-            double tlb_hit_rate = (double)tlb_hits / (double)tlb_total;
-            double page_fault_rate =
-                (total_accesses > 0)
-                    ? (double)page_faults / (double)total_accesses
-                    : 0.0;
-
-            double base = tlb_hit_rate * TLB_LAT +
-                          (1.0 - tlb_hit_rate) * MEM_LAT;
-            double amat = base + page_fault_rate * DISK_LAT;
-
-            printf("TLB hit rate: %.2f%%\n", tlb_hit_rate * 100.0);
-            printf("Approx. AMAT: %.2f cycles\n", amat);
+    if (filter_entries > 0) sim.stats.trace_accesses = tr.accesses;
+    sim_print_stats(&sim);
+    if (rle) {
+        printf("Trace records: %lld (%.2f accesses/record)\n", tr.records,
+               tr.records > 0 ? (double)tr.accesses / (double)tr.records : 0.0);
+    }
+    if (filter_entries > 0) {
+        printf("Filtered accesses: %lld (%d-entry LRU filter; %lld records re-emitted, "
+               "%lld passed through)\n", tr.filtered, filter_entries, tr.reemitted, tr.passed);
+    }
+    if (src_acc) {
+        printf("\n--- Per-source ---\n");
+        for (int i = 0; i < ntraces; i++) {
+            printf("[%d] %s: %lld accesses, %lld faults\n", i, traces[i],
+                   src_acc[i], src_faults[i]);
         }
     }
-
-    printf("Write-backs (dirty evictions): %lld\n", write_backs);
     printf("Simulation finished.\n");
 
-    free(frames);
-    free(frame_last_used);
-    free(ref_bits);
-    free(dirty);
-    free(tlb);
-
+    free(src_acc);
+    free(src_faults);
+    sim_free(&sim);
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char *argv[]) {
+    char **traces = (char **)malloc((size_t)argc * sizeof(char *));
+    if (!traces) {
+        perror("Error allocating trace list");
+        return 1;
+    }
+    int rc = run(argc, argv, traces);
+    free(traces);
+    return rc;
+}
@@ -0,0 +1,88 @@
+#include <stdlib.h>
+
+#include "merge.h"
+
+// True if input a's head must come out before input b's. Keys sit in one
+// dense array so a replay touches a few cache lines, not k records.
+static inline int merge_before(const TraceMerge *m, int a, int b) {
+    unsigned long long ka = m->key[a], kb = m->key[b];
+    return (ka < kb) | ((ka == kb) & (a < b));
+}
+
+static void merge_fill(TraceMerge *m, int s) {
+    if (trace_next(&m->in[s], &m->head[s])) {
+        m->head[s].src = s;
+        // A real timestamp of ~0 would read as exhausted; clamp it
+        m->key[s] = (m->head[s].ts == MERGE_DONE) ? MERGE_DONE - 1 : m->head[s].ts;
+    } else {
+        m->key[s] = MERGE_DONE;
+    }
+}
+
+int merge_open(TraceMerge *m, char **paths, int k) {
+    TraceMerge zero = {0};
+    *m = zero;
+    m->k = k;
+    m->in   = (TraceReader *)calloc((size_t)k, sizeof(TraceReader));
+    m->head = (TraceRecord *)calloc((size_t)k, sizeof(TraceRecord));
+    m->key  = (unsigned long long *)calloc((size_t)k, sizeof(unsigned long long));
+    m->tree = (int *)calloc((size_t)k, sizeof(int));
+    int *win = (int *)malloc(2 * (size_t)k * sizeof(int));
+    if (!m->in || !m->head || !m->key || !m->tree || !win) {
+        free(win);
+        merge_close(m);
+        return -1;
+    }
+
+    for (int s = 0; s < k; s++) {
+        if (trace_open(&m->in[s], paths[s], 0) != 0) {
+            free(win);
+            merge_close(m);
+            return -1;
+        }
+        setvbuf(m->in[s].fp, NULL, _IOFBF, MERGE_BUF_SIZE);
+        merge_fill(m, s);
+    }
+
+    // Leaves sit at k..2k-1 of an implicit heap; play every match once
+    for (int s = 0; s < k; s++) win[k + s] = s;
+    for (int n = k - 1; n >= 1; n--) {
+        int a = win[2 * n], b = win[2 * n + 1];
+        if (merge_before(m, a, b)) { win[n] = a; m->tree[n] = b; }
+        else                       { win[n] = b; m->tree[n] = a; }
+    }
+    m->tree[0] = (k > 1) ? win[1] : 0;
+    free(win);
+    return 0;
+}
+
+void merge_close(TraceMerge *m) {
+    if (m->in) {
+        for (int s = 0; s < m->k; s++) trace_close(&m->in[s]);
+    }
+    free(m->in);
+    free(m->head);
+    free(m->key);
+    free(m->tree);
+
+    TraceMerge zero = {0};
+    *m = zero;
+}
+
+int merge_next(TraceMerge *m, TraceRecord *rec) {
+    int s = m->tree[0];
+    if (m->key[s] == MERGE_DONE) return 0;
+    *rec = m->head[s];
+    merge_fill(m, s);
+
+    // Replay the winner's path from its leaf to the root. Match outcomes
+    // are random when inputs interleave finely, so select without branching.
+    for (int n = (s + m->k) / 2; n > 0; n /= 2) {
+        int t = m->tree[n];
+        int mask = -merge_before(m, t, s);
+        m->tree[n] = (s & mask) | (t & ~mask);
+        s = (t & mask) | (s & ~mask);
+    }
+    m->tree[0] = s;
+    return 1;
+}
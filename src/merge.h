@@ -0,0 +1,30 @@
+#ifndef MERGE_H
+#define MERGE_H
+
+#include "trace.h"
+
+// K-way merge of per-thread / per-CPU trace files by timestamp. Each input
+// is read through its own buffered TraceReader; a loser tree keeps the
+// earliest pending record of every input, so producing the next record
+// costs one replay of log2(k) matches. Ties go to the lower input index,
+// and lines without a timestamp inherit the previous one of their file.
+
+#define MERGE_BUF_SIZE (64 * 1024)
+#define MERGE_DONE     (~0ULL)
+
+typedef struct TraceMerge {
+    int k;
+    TraceReader *in;
+    TraceRecord *head;      // next record of each input
+    unsigned long long *key;    // timestamp of each head, MERGE_DONE if exhausted
+    int *tree;              // tree[0] = winner, tree[1..k-1] = losers
+} TraceMerge;
+
+int  merge_open(TraceMerge *m, char **paths, int k);
+void merge_close(TraceMerge *m);
+
+// Returns 1 and fills rec (tagged with its input in rec->src), or 0 once
+// every input is exhausted.
+int  merge_next(TraceMerge *m, TraceRecord *rec);
+
+#endif
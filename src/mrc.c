@@ -0,0 +1,601 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cuckoo.h"
+#include "mrc.h"
+#include "sim.h"
+
+#define MRC_NEVER LONG_MAX  // next use of a page that is not used again
+#define MRC_ROWS  20
+
+// ---- Loaded trace ----
+
+static int reserve(MrcTrace *t, long cap) {
+    if (cap <= t->cap) return 0;
+    unsigned long *k = (unsigned long *)realloc(t->key, (size_t)cap * sizeof(unsigned long));
+    if (k) t->key = k;
+    unsigned long *c = (unsigned long *)realloc(t->count, (size_t)cap * sizeof(unsigned long));
+    if (c) t->count = c;
+    if (!k || !c) return -1;
+    t->cap = cap;
+    return 0;
+}
+
+int mrc_load(MrcTrace *t, TraceReader *tr) {
+    MrcTrace zero = {0};
+    *t = zero;
+
+    CuckooMap seen;
+    if (cuckoo_init(&seen, 1024) != 0) return -1;
+
+    int rc = 0;
+    TraceRecord rec;
+    while (rc == 0) {
+        if (t->n == MRC_MAX_RECORDS) {
+            rc = 1;
+            break;
+        }
+        if (!trace_next(tr, &rec)) break;
+        if (rec.op != 'R' && rec.op != 'W') continue;
+        if (t->n == t->cap) {
+            long cap = t->cap ? t->cap * 2 : 65536;
+            if (cap > MRC_MAX_RECORDS) cap = MRC_MAX_RECORDS;
+            if (reserve(t, cap) != 0) {
+                rc = -1;
+                break;
+            }
+        }
+        unsigned long key = rec.addr / PAGE_SIZE;
+        t->key[t->n] = key;
+        t->count[t->n] = rec.count;
+        t->n++;
+        t->accesses += (long long)rec.count;
+        if (cuckoo_find(&seen, key) < 0) rc = cuckoo_insert(&seen, key, 0);
+    }
+    t->footprint = (long)seen.count;
+    cuckoo_free(&seen);
+    return rc;
+}
+
+void mrc_trace_free(MrcTrace *t) {
+    free(t->key);
+    free(t->count);
+
+    MrcTrace zero = {0};
+    *t = zero;
+}
+
+int mrc_curve_init(MrcCurve *c, int max_size, long long accesses) {
+    c->max_size = max_size;
+    c->accesses = accesses;
+    c->hits = (long long *)calloc((size_t)max_size + 1, sizeof(long long));
+    return c->hits ? 0 : -1;
+}
+
+void mrc_curve_free(MrcCurve *c) {
+    free(c->hits);
+    c->hits = NULL;
+}
+
+// Accesses at depth 1 that follow the first access of each record
+static void count_runs(const MrcTrace *t, MrcCurve *c) {
+    for (long i = 0; i < t->n; i++) c->hits[1] += (long long)(t->count[i] - 1);
+}
+
+// ---- LRU ----
+
+static void bit_add(int *bit, long n, long i, int v) {
+    for (i++; i <= n; i += i & -i) bit[i] += v;
+}
+
+// Fenwick tree of n positions from 0/1 marks, in linear time
+static int *bit_build(const unsigned char *mark, long n) {
+    int *bit = (int *)calloc((size_t)n + 1, sizeof(int));
+    if (!bit) return NULL;
+    for (long i = 1; i <= n; i++) {
+        bit[i] += mark[i - 1];
+        long j = i + (i & -i);
+        if (j <= n) bit[j] += bit[i];
+    }
+    return bit;
+}
+
+static long bit_sum(const int *bit, long i) {     // marks at positions < i
+    long s = 0;
+    for (; i > 0; i -= i & -i) s += bit[i];
+    return s;
+}
+
+int mrc_lru(const MrcTrace *t, MrcCurve *c) {
+    int *bit = (int *)calloc((size_t)t->n + 1, sizeof(int));
+    CuckooMap last;
+    if (!bit || cuckoo_init(&last, 1024) != 0) {
+        free(bit);
+        return -1;
+    }
+
+    count_runs(t, c);
+    for (long i = 0; i < t->n; i++) {
+        int p = cuckoo_find(&last, t->key[i]);
+        if (p >= 0) {
+            long d = bit_sum(bit, i) - bit_sum(bit, p + 1) + 1;
+            if (d <= c->max_size) c->hits[d]++;
+            bit_add(bit, t->n, p, -1);
+            cuckoo_erase(&last, t->key[i]);
+        }
+        bit_add(bit, t->n, i, 1);
+        if (cuckoo_insert(&last, t->key[i], (int)i) != 0) {
+            free(bit);
+            cuckoo_free(&last);
+            return -1;
+        }
+    }
+    free(bit);
+    cuckoo_free(&last);
+    return 0;
+}
+
+// ---- Parallel LRU ----
+//
+// PARDA-style: the trace is cut into one chunk per thread. Each thread runs
+// the serial algorithm on its chunk; references to pages last used in an
+// earlier chunk come out as first accesses, in order. The first accesses
+// of a stretch of chunks are exactly its distinct pages, so an access whose
+// page was last used in chunk c has as its depth the depth the page would
+// have in chunk c's final stack after the distinct pages of every later
+// chunk up to it were pushed on, in first-access order. Those lists are
+// chained right to left (cheap: one lookup per page) and then every chunk
+// resolves its list on its own thread. Depths are the same integers the
+// serial pass finds, so the curves are identical.
+
+typedef struct {
+    const MrcTrace *t;
+    long start, end;            // records [start, end)
+    CuckooMap last;             // page -> latest position in the chunk
+    unsigned long *first;       // pages in first-access order
+    long nfirst;
+    const unsigned long *later; // distinct pages after the chunk, in order
+    long nlater;
+    long long *hits;
+    int max_size;
+    int rc;
+} LruChunk;
+
+// Depth of every access whose page was last used earlier in the chunk
+static void *chunk_local(void *arg) {
+    LruChunk *ch = (LruChunk *)arg;
+    long n = ch->end - ch->start;
+    int *bit = (int *)calloc((size_t)n + 1, sizeof(int));
+    ch->first = (unsigned long *)malloc(((size_t)n + 1) * sizeof(unsigned long));
+    if (!bit || !ch->first) {
+        free(bit);
+        ch->rc = -1;
+        return NULL;
+    }
+    for (long i = 0; i < n; i++) {
+        unsigned long key = ch->t->key[ch->start + i];
+        int p = cuckoo_find(&ch->last, key);
+        if (p >= 0) {
+            long d = bit_sum(bit, i) - bit_sum(bit, p + 1) + 1;
+            if (d <= ch->max_size) ch->hits[d]++;
+            bit_add(bit, n, p, -1);
+            cuckoo_erase(&ch->last, key);
+        } else {
+            ch->first[ch->nfirst++] = key;
+        }
+        bit_add(bit, n, i, 1);
+        if (cuckoo_insert(&ch->last, key, (int)i) != 0) {
+            ch->rc = -1;
+            break;
+        }
+    }
+    free(bit);
+    return NULL;
+}
+
+// Depth of every later first access whose page was last used in the chunk
+static void *chunk_resolve(void *arg) {
+    LruChunk *ch = (LruChunk *)arg;
+    long n = ch->end - ch->start, m = n + ch->nlater;
+    unsigned char *mark = (unsigned char *)calloc((size_t)m, 1);
+    if (!mark) {
+        ch->rc = -1;
+        return NULL;
+    }
+    for (long i = 0; i < n; i++)
+        mark[i] = cuckoo_find(&ch->last, ch->t->key[ch->start + i]) == (int)i;
+    int *bit = bit_build(mark, m);
+    free(mark);
+    if (!bit) {
+        ch->rc = -1;
+        return NULL;
+    }
+    for (long j = 0; j < ch->nlater; j++) {
+        long q = n + j;
+        int p = cuckoo_find(&ch->last, ch->later[j]);
+        if (p >= 0) {
+            long d = bit_sum(bit, q) - bit_sum(bit, p + 1) + 1;
+            if (d <= ch->max_size) ch->hits[d]++;
+            bit_add(bit, m, p, -1);
+        }
+        bit_add(bit, m, q, 1);
+    }
+    free(bit);
+    return NULL;
+}
+
+// Runs fn on every chunk, one thread each
+static int run_chunks(LruChunk *ch, int nchunks, void *(*fn)(void *)) {
+    pthread_t *tid = (pthread_t *)malloc((size_t)nchunks * sizeof(pthread_t));
+    if (!tid) return -1;
+    int started = 0, rc = 0;
+    for (; started < nchunks; started++)
+        if (pthread_create(&tid[started], NULL, fn, &ch[started]) != 0) break;
+    if (started < nchunks) rc = -1;
+    for (int i = 0; i < started; i++) pthread_join(tid[i], NULL);
+    free(tid);
+    for (int i = 0; i < nchunks; i++)
+        if (ch[i].rc != 0) rc = -1;
+    return rc;
+}
+
+int mrc_lru_parallel(const MrcTrace *t, MrcCurve *c, int threads) {
+    if (threads > t->n / MRC_MIN_CHUNK) threads = (int)(t->n / MRC_MIN_CHUNK);
+    if (threads <= 1) return mrc_lru(t, c);
+
+    LruChunk *ch = (LruChunk *)calloc((size_t)threads, sizeof(LruChunk));
+    unsigned long **later = (unsigned long **)calloc((size_t)threads, sizeof(unsigned long *));
+    if (!ch || !later) {
+        free(ch);
+        free(later);
+        return -1;
+    }
+    int rc = 0, ready = 0;
+    for (; ready < threads; ready++) {
+        LruChunk *k = &ch[ready];
+        k->t = t;
+        k->start = t->n * ready / threads;
+        k->end = t->n * (ready + 1) / threads;
+        k->max_size = c->max_size;
+        k->hits = (long long *)calloc((size_t)c->max_size + 1, sizeof(long long));
+        if (!k->hits || cuckoo_init(&k->last, 1024) != 0) {
+            free(k->hits);
+            rc = -1;
+            break;
+        }
+    }
+    if (rc == 0) rc = run_chunks(ch, threads, chunk_local);
+
+    // later of chunk i: its successor's first accesses, then the pages of
+    // the successor's own later list the successor never touched
+    for (int i = threads - 2; rc == 0 && i >= 0; i--) {
+        LruChunk *next = &ch[i + 1];
+        later[i] = (unsigned long *)malloc(((size_t)next->nfirst + (size_t)next->nlater + 1) *
+                                           sizeof(unsigned long));
+        if (!later[i]) {
+            rc = -1;
+            break;
+        }
+        long m = 0;
+        for (long j = 0; j < next->nfirst; j++) later[i][m++] = next->first[j];
+        for (long j = 0; j < next->nlater; j++)
+            if (cuckoo_find(&next->last, next->later[j]) < 0) later[i][m++] = next->later[j];
+        ch[i].later = later[i];
+        ch[i].nlater = m;
+    }
+    if (rc == 0) rc = run_chunks(ch, threads - 1, chunk_resolve);
+
+    count_runs(t, c);
+    for (int i = 0; i < ready; i++) {
+        if (rc == 0)
+            for (int d = 1; d <= c->max_size; d++) c->hits[d] += ch[i].hits[d];
+        free(ch[i].hits);
+        free(ch[i].first);
+        free(later[i]);
+        cuckoo_free(&ch[i].last);
+    }
+    free(ch);
+    free(later);
+    return rc;
+}
+
+// ---- Streamed LRU ----
+//
+// Each phase runs the pass above over the current stack, least recent
+// first, followed by the phase's records. Replaying the stack leaves every
+// page at its depth and, with each page once, adds no hits; afterwards the
+// stack is the phase's distinct pages in order of last use. A phase reads
+// at least twice as many records as the stack holds, so replaying it costs
+// at most half again the work. Positions stay within one phase, which
+// bounds the footprint at a third of MRC_MAX_RECORDS.
+
+// Rewrites t as its distinct pages in order of last use; their count, or -1
+static long stack_order(MrcTrace *t) {
+    CuckooMap seen;
+    if (cuckoo_init(&seen, 1024) != 0) return -1;
+    long m = t->n;
+    for (long i = t->n - 1; i >= 0; i--) {
+        if (cuckoo_find(&seen, t->key[i]) >= 0) continue;
+        if (cuckoo_insert(&seen, t->key[i], 0) != 0) {
+            cuckoo_free(&seen);
+            return -1;
+        }
+        t->key[--m] = t->key[i];
+    }
+    cuckoo_free(&seen);
+    long k = t->n - m;
+    for (long i = 0; i < k; i++) {
+        t->key[i] = t->key[m + i];
+        t->count[i] = 1;
+    }
+    t->n = k;
+    return k;
+}
+
+int mrc_lru_stream(TraceReader *tr, MrcTrace *t, int max_size, int threads, MrcCurve *c,
+                   long *footprint) {
+    int grow = max_size <= 0;
+    long long accesses = t->accesses;
+    long stack = 0;
+    int rc = mrc_curve_init(c, grow ? 1 : max_size, 0), more = 1;
+    while (rc == 0 && more) {
+        if (stack > MRC_MAX_RECORDS / 3) {
+            fprintf(stderr, "Footprint too large for the streamed curve (%ld pages)\n", stack);
+            rc = -1;
+            break;
+        }
+        long len = stack + (2 * stack > MRC_PHASE ? 2 * stack : MRC_PHASE);
+        if (len < t->n) len = t->n;
+        if (reserve(t, len) != 0) {
+            rc = -1;
+            break;
+        }
+        TraceRecord rec;
+        while (t->n < len && (more = trace_next(tr, &rec))) {
+            if (rec.op != 'R' && rec.op != 'W') continue;
+            t->key[t->n] = rec.addr / PAGE_SIZE;
+            t->count[t->n] = rec.count;
+            t->n++;
+            accesses += (long long)rec.count;
+        }
+        if (t->n == stack) break;
+
+        // Depths are at most the pages in the phase
+        if (grow && c->max_size < t->n) {
+            long long *h = (long long *)realloc(c->hits, ((size_t)t->n + 1) * sizeof(long long));
+            if (!h) {
+                rc = -1;
+                break;
+            }
+            for (long d = c->max_size + 1; d <= t->n; d++) h[d] = 0;
+            c->hits = h;
+            c->max_size = (int)t->n;
+        }
+        rc = mrc_lru_parallel(t, c, threads);
+        if (rc == 0) stack = stack_order(t);
+        if (stack < 0) rc = -1;
+    }
+    if (grow) c->max_size = stack > 0 ? (int)stack : 1;
+    c->accesses = accesses;
+    *footprint = stack;
+    mrc_trace_free(t);
+    return rc;
+}
+
+// ---- OPT ----
+
+// next[i]: index of the next record of the same page, or MRC_NEVER
+static long *next_use(const MrcTrace *t) {
+    long *next = (long *)malloc((size_t)t->n * sizeof(long));
+    CuckooMap seen;
+    if (!next || cuckoo_init(&seen, 1024) != 0) {
+        free(next);
+        return NULL;
+    }
+    for (long i = t->n - 1; i >= 0; i--) {
+        int j = cuckoo_find(&seen, t->key[i]);
+        next[i] = j >= 0 ? j : MRC_NEVER;
+        if (j >= 0) cuckoo_erase(&seen, t->key[i]);
+        if (cuckoo_insert(&seen, t->key[i], (int)i) != 0) {
+            free(next);
+            cuckoo_free(&seen);
+            return NULL;
+        }
+    }
+    cuckoo_free(&seen);
+    return next;
+}
+
+int mrc_opt(const MrcTrace *t, MrcCurve *c) {
+    long *next = next_use(t);
+    int k = c->max_size;
+    unsigned long *skey = (unsigned long *)malloc((size_t)k * sizeof(unsigned long));
+    long *snext = (long *)malloc((size_t)k * sizeof(long));
+    if (!next || !skey || !snext) {
+        free(next);
+        free(skey);
+        free(snext);
+        return -1;
+    }
+
+    count_runs(t, c);
+    int size = 0;
+    for (long i = 0; i < t->n; i++) {
+        unsigned long key = t->key[i];
+        if (size > 0 && skey[0] == key) {
+            snext[0] = next[i];
+            c->hits[1]++;
+            continue;
+        }
+
+        // The accessed page goes on top and the old top starts down
+        unsigned long ckey = key;
+        long cnext = next[i];
+        int p = 0;
+        for (; p < size; p++) {
+            if (skey[p] == key) break;
+            if (p == 0 || snext[p] > cnext) {
+                unsigned long tk = skey[p];
+                long tn = snext[p];
+                skey[p] = ckey;
+                snext[p] = cnext;
+                ckey = tk;
+                cnext = tn;
+            }
+        }
+        if (p < size) {
+            c->hits[p + 1]++;
+        } else if (size == k) {
+            continue;           // the page falls off the cut stack
+        } else {
+            size++;
+        }
+        skey[p] = ckey;
+        snext[p] = cnext;
+    }
+
+    free(next);
+    free(skey);
+    free(snext);
+    return 0;
+}
+
+// ---- Report ----
+
+// Wall time: the LRU pass may run on several CPUs
+static double seconds(struct timespec a, struct timespec b) {
+    return (double)(b.tv_sec - a.tv_sec) + 1e-9 * (double)(b.tv_nsec - a.tv_nsec);
+}
+
+static double rate(long long faults, long long accesses) {
+    return accesses > 0 ? 100.0 * (double)faults / (double)accesses : 0.0;
+}
+
+int mrc_run(TraceReader *tr, int max_frames, int threads, const char *csv_path) {
+    MrcTrace t;
+    struct timespec t0, t1, t2, t3;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int loaded = mrc_load(&t, tr);
+    if (loaded < 0) {
+        perror("Error loading trace");
+        mrc_trace_free(&t);
+        return -1;
+    }
+
+    // Past MRC_MAX_RECORDS, the LRU curve streams on from what was loaded
+    // and there is no OPT curve
+    MrcCurve lru = {0}, opt = {0};
+    int max = max_frames, stream = loaded == 1;
+    long records = t.n, footprint = t.footprint;
+    long long accesses = t.accesses;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (stream) {
+        if (mrc_lru_stream(tr, &t, max, threads, &lru, &footprint) != 0) {
+            perror("Error computing LRU curve");
+            mrc_curve_free(&lru);
+            return -1;
+        }
+        accesses = lru.accesses;
+        if (max <= 0) max = lru.max_size < MRC_DEFAULT_MAX ? lru.max_size : MRC_DEFAULT_MAX;
+    } else {
+        if (max <= 0) max = t.footprint < MRC_DEFAULT_MAX ? (int)t.footprint : MRC_DEFAULT_MAX;
+        if (max < 1) max = 1;
+        if (mrc_curve_init(&lru, max, t.accesses) != 0 ||
+            mrc_lru_parallel(&t, &lru, threads) != 0) {
+            perror("Error computing LRU curve");
+            mrc_curve_free(&lru);
+            mrc_trace_free(&t);
+            return -1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    if (!stream && (mrc_curve_init(&opt, max, t.accesses) != 0 || mrc_opt(&t, &opt) != 0)) {
+        perror("Error computing OPT curve");
+        mrc_curve_free(&lru);
+        mrc_curve_free(&opt);
+        mrc_trace_free(&t);
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+
+    // Cumulative faults at every size
+    long long *lf = (long long *)malloc(((size_t)max + 1) * sizeof(long long));
+    long long *of = (long long *)malloc(((size_t)max + 1) * sizeof(long long));
+    if (!lf || !of) {
+        perror("Error allocating curves");
+        free(lf);
+        free(of);
+        mrc_curve_free(&lru);
+        mrc_curve_free(&opt);
+        mrc_trace_free(&t);
+        return -1;
+    }
+    lf[0] = of[0] = accesses;
+    for (int s = 1; s <= max; s++) {
+        lf[s] = lf[s - 1] - lru.hits[s];
+        of[s] = stream ? 0 : of[s - 1] - opt.hits[s];
+    }
+
+    printf("\n--- Miss ratio curves ---\n");
+    if (stream)
+        printf("Accesses: %lld, footprint %ld pages\n", accesses, footprint);
+    else
+        printf("Accesses: %lld in %ld records, footprint %ld pages\n", accesses, records,
+               footprint);
+    printf("Sizes: 1 to %d frames%s\n", max,
+           max < footprint ? " (the footprint is larger; raise it with -f)" : "");
+    if (stream) {
+        printf("OPT: skipped; the trace has over %ld records, more than it can hold\n",
+               (long)MRC_MAX_RECORDS);
+        printf("Time: load %.2f s, LRU %.2f s (%d thread%s, streamed)\n", seconds(t0, t1),
+               seconds(t1, t2), threads, threads == 1 ? "" : "s");
+        printf("%10s %14s %9s\n", "frames", "LRU faults", "rate");
+    } else {
+        printf("Time: load %.2f s, LRU %.2f s (%d thread%s), OPT %.2f s\n", seconds(t0, t1),
+               seconds(t1, t2), threads, threads == 1 ? "" : "s", seconds(t2, t3));
+        printf("%10s %14s %9s %14s %9s %10s\n", "frames", "LRU faults", "rate",
+               "OPT faults", "rate", "headroom");
+    }
+    int prev = 0;
+    for (int r = 1; r <= MRC_ROWS; r++) {
+        // Rows grow cubically, so small sizes get more of them
+        int s = (int)(0.5 + (double)max * ((double)r / MRC_ROWS) *
+                            ((double)r / MRC_ROWS) * ((double)r / MRC_ROWS));
+        if (s <= prev) s = prev + 1;
+        if (s > max) break;
+        prev = s;
+        if (stream)
+            printf("%10d %14lld %8.2f%%\n", s, lf[s], rate(lf[s], accesses));
+        else
+            printf("%10d %14lld %8.2f%% %14lld %8.2f%% %9.1f%%\n", s, lf[s],
+                   rate(lf[s], accesses), of[s], rate(of[s], accesses),
+                   lf[s] > 0 ? 100.0 * (double)(lf[s] - of[s]) / (double)lf[s] : 0.0);
+    }
+    if (!stream) printf("(headroom: share of LRU's faults that OPT avoids)\n");
+
+    int rc = 0;
+    if (csv_path) {
+        FILE *out = fopen(csv_path, "w");
+        if (!out) {
+            perror("Error opening curve output");
+            rc = -1;
+        } else {
+            fprintf(out, stream ? "frames,lru_faults\n" : "frames,lru_faults,opt_faults\n");
+            for (int s = 1; s <= max; s++) {
+                if (stream) fprintf(out, "%d,%lld\n", s, lf[s]);
+                else fprintf(out, "%d,%lld,%lld\n", s, lf[s], of[s]);
+            }
+            fclose(out);
+            printf("Wrote %d sizes to %s\n", max, csv_path);
+        }
+    }
+
+    free(lf);
+    free(of);
+    mrc_curve_free(&lru);
+    mrc_curve_free(&opt);
+    mrc_trace_free(&t);
+    return rc;
+}
@@ -0,0 +1,79 @@
+#ifndef MRC_H
+#define MRC_H
+
+#include <limits.h>
+#include <stdio.h>
+
+#include "trace.h"
+
+// Miss ratio curves: faults for every memory size from one pass over the
+// trace. LRU and OPT are both stack algorithms: the pages a memory of n
+// frames holds are always the top n entries of one stack, so an access at
+// stack depth d hits in every memory of at least d frames, and a histogram
+// of depths gives the whole curve.
+//
+// The LRU stack is ordered by last use. Its depths are counted with a
+// Fenwick tree over trace positions that marks each page's latest access:
+// the depth of an access is one more than the marks since the page's
+// previous access.
+//
+// The OPT stack (Mattson et al.) is ordered by priority, and a page's
+// priority is its next use, looked up in a next-use index built backwards
+// over the loaded trace. The accessed page goes on top. The page it
+// displaces moves down, and at every level the page used later of the one
+// moving down and the one already there keeps moving, until the gap the
+// accessed page left is filled. The stack is cut at the largest size of
+// interest; nothing below it can affect smaller memories.
+//
+// The LRU pass also runs on several threads over chunks of the trace, with
+// the same result (see mrc.c). OPT priorities look into the future, so the
+// OPT pass stays serial.
+//
+// A loaded trace takes 16 bytes a record, and positions in it are ints, so
+// mrc_load stops at MRC_MAX_RECORDS and returns 1 with what it has read.
+// The LRU curve needs no future: mrc_lru_stream reads the trace in phases
+// and keeps only the current stack between them, so its memory follows the
+// footprint, not the trace length.
+
+typedef struct {
+    unsigned long *key;     // page of each record
+    unsigned long *count;   // accesses in the record; all but the first hit
+    long n, cap;
+    long long accesses;
+    long footprint;         // distinct pages
+} MrcTrace;
+
+typedef struct {
+    int max_size;
+    long long accesses;
+    long long *hits;        // hits[d]: accesses at stack depth d, 1..max_size
+} MrcCurve;
+
+#define MRC_MAX_RECORDS INT_MAX
+int  mrc_load(MrcTrace *t, TraceReader *tr);
+void mrc_trace_free(MrcTrace *t);
+
+int  mrc_curve_init(MrcCurve *c, int max_size, long long accesses);
+void mrc_curve_free(MrcCurve *c);
+
+int  mrc_lru(const MrcTrace *t, MrcCurve *c);
+int  mrc_opt(const MrcTrace *t, MrcCurve *c);
+
+#define MRC_MIN_CHUNK 4096      // records per thread, at least
+int  mrc_lru_parallel(const MrcTrace *t, MrcCurve *c, int threads);
+
+// LRU curve of the records in t (none, or what mrc_load kept) followed by
+// the rest of tr, up to max_size frames (0: the footprint). Sets c, which
+// the caller frees, and the footprint; t is used as the phase buffer and
+// freed.
+#define MRC_PHASE (1L << 22)    // records a phase reads, at least
+int  mrc_lru_stream(TraceReader *tr, MrcTrace *t, int max_size, int threads, MrcCurve *c,
+                    long *footprint);
+
+// -a opt-mrc: LRU and OPT curves up to max_frames (0: the footprint, up
+// to MRC_DEFAULT_MAX), a summary table, and every size to csv if given.
+// The LRU curve is computed on `threads` threads.
+#define MRC_DEFAULT_MAX 16384
+int  mrc_run(TraceReader *tr, int max_frames, int threads, const char *csv_path);
+
+#endif
@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hll.h"
+#include "mrc.h"
+#include "partition.h"
+
+typedef struct {
+    const char *trace;
+    MrcTrace t;
+    long long *faults;      // LRU faults with 0..total frames
+    int *hull;              // frame counts at the lower convex hull's vertices
+    int nhull;
+    int seg;                // hull segment the allocation is on
+    int frames;             // allocation
+    long long simulated;    // faults of the partitioned replay
+} PartProc;
+
+// ---- Curves ----
+
+static int load_curve(PartProc *p, int total, int collapse) {
+    TraceReader tr;
+    if (trace_open(&tr, p->trace, collapse) != 0) {
+        perror("Error opening trace file");
+        return -1;
+    }
+    int rc = mrc_load(&p->t, &tr);
+    trace_close(&tr);
+    if (rc == 1)
+        fprintf(stderr, "%s: over %ld records, more than a partition can hold\n", p->trace,
+                (long)MRC_MAX_RECORDS);
+    if (rc != 0) return -1;
+
+    MrcCurve c;
+    if (mrc_curve_init(&c, total, p->t.accesses) != 0) return -1;
+    if (mrc_lru(&p->t, &c) != 0) {
+        mrc_curve_free(&c);
+        return -1;
+    }
+    p->faults = (long long *)malloc(((size_t)total + 1) * sizeof(long long));
+    if (!p->faults) {
+        mrc_curve_free(&c);
+        return -1;
+    }
+    p->faults[0] = p->t.accesses;
+    for (int s = 1; s <= total; s++) p->faults[s] = p->faults[s - 1] - c.hits[s];
+    mrc_curve_free(&c);
+    return 0;
+}
+
+// Lower convex hull of (frames, faults), by monotone chain
+static int build_hull(PartProc *p, int total) {
+    p->hull = (int *)malloc(((size_t)total + 1) * sizeof(int));
+    if (!p->hull) return -1;
+    int n = 0;
+    for (int s = 0; s <= total; s++) {
+        while (n >= 2) {
+            int a = p->hull[n - 2], b = p->hull[n - 1];
+            double cross = (double)(b - a) * (double)(p->faults[s] - p->faults[a]) -
+                           (double)(p->faults[b] - p->faults[a]) * (double)(s - a);
+            if (cross > 0.0) break;
+            n--;
+        }
+        p->hull[n++] = s;
+    }
+    p->nhull = n;
+    return 0;
+}
+
+// Segment k runs from hull vertex k to k + 1
+static int segment_of(const PartProc *p, int s) {
+    int lo = 0, hi = p->nhull - 1;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (p->hull[mid] <= s) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static double hull_faults(const PartProc *p, int s) {
+    if (p->nhull == 1) return (double)p->faults[p->hull[0]];
+    int k = segment_of(p, s);
+    int a = p->hull[k], b = p->hull[k + 1];
+    double fa = (double)p->faults[a], fb = (double)p->faults[b];
+    return fa + (fb - fa) * (double)(s - a) / (double)(b - a);
+}
+
+// Faults saved per frame on the allocation's current segment
+static double gain(const PartProc *p) {
+    if (p->seg + 1 >= p->nhull) return 0.0;
+    int a = p->hull[p->seg], b = p->hull[p->seg + 1];
+    return (double)(p->faults[a] - p->faults[b]) / (double)(b - a);
+}
+
+// ---- Allocation ----
+
+// Fewest frames whose hull fault rate meets the SLO
+static int slo_frames(const PartProc *p, double slo, int total) {
+    double target = slo * (double)p->t.accesses;
+    for (int s = 0; s <= total; s++)
+        if (hull_faults(p, s) <= target) return s;
+    return -1;
+}
+
+// Greedy on the hulls' marginal utility; returns the frames left over
+static int allocate(PartProc *p, int n, int spare) {
+    for (int i = 0; i < n; i++) p[i].seg = segment_of(&p[i], p[i].frames);
+    while (spare > 0) {
+        int best = -1;
+        for (int i = 0; i < n; i++)
+            if (gain(&p[i]) > 0.0 && (best < 0 || gain(&p[i]) > gain(&p[best]))) best = i;
+        if (best < 0) break;
+        PartProc *b = &p[best];
+        int step = b->hull[b->seg + 1] - b->frames;
+        if (step > spare) step = spare;
+        b->frames += step;
+        spare -= step;
+        if (b->frames == b->hull[b->seg + 1]) b->seg++;
+    }
+    return spare;
+}
+
+// ---- Verification ----
+
+// Replays the pages whose hash falls in [lo, hi) on `frames` LRU frames
+static long long replay(const SimConfig *base, const MrcTrace *t, int frames,
+                        double lo, double hi) {
+    long long faults = 0;
+    if (frames == 0) {
+        for (long i = 0; i < t->n; i++) {
+            double u = (double)(hll_hash(t->key[i]) >> 11) * 0x1p-53;
+            if (u >= lo && u < hi) faults += (long long)t->count[i];
+        }
+        return faults;
+    }
+
+    SimConfig cfg = *base;
+    cfg.alg = ALG_LRU;
+    cfg.num_frames = frames;
+    cfg.quiet = 1;
+    Simulator sim;
+    if (sim_init(&sim, &cfg) != 0) return -1;
+    for (long i = 0; i < t->n; i++) {
+        double u = (double)(hll_hash(t->key[i]) >> 11) * 0x1p-53;
+        if (u < lo || u >= hi) continue;
+        unsigned long addr = t->key[i] * PAGE_SIZE;
+        int r = t->count[i] == 1 ? sim_access(&sim, 'R', addr)
+                                 : sim_access_run(&sim, 'R', addr, t->count[i], 0);
+        if (r < 0) {
+            sim_free(&sim);
+            return -1;
+        }
+    }
+    faults = sim.stats.page_faults;
+    sim_free(&sim);
+    return faults;
+}
+
+// Between hull vertices a and b, a share rho of the pages gets rho * a
+// frames and the rest (1 - rho) * b, where s = rho * a + (1 - rho) * b
+static long long verify(const SimConfig *cfg, const PartProc *p) {
+    int k = p->seg;
+    if (p->frames == p->hull[k] || k + 1 >= p->nhull)
+        return replay(cfg, &p->t, p->frames, 0.0, 1.0);
+    int a = p->hull[k], b = p->hull[k + 1];
+    double rho = (double)(b - p->frames) / (double)(b - a);
+    int fa = (int)(rho * a + 0.5);
+    long long lo = replay(cfg, &p->t, fa, 0.0, rho);
+    long long hi = replay(cfg, &p->t, p->frames - fa, rho, 1.0);
+    return lo < 0 || hi < 0 ? -1 : lo + hi;
+}
+
+// ---- Report ----
+
+static double pct(double faults, long long accesses) {
+    return accesses > 0 ? 100.0 * faults / (double)accesses : 0.0;
+}
+
+int partition_run(const SimConfig *cfg, char **traces, int ntraces, int collapse,
+                  const double *slo) {
+    int total = cfg->num_frames;
+    PartProc *p = (PartProc *)calloc((size_t)ntraces, sizeof(PartProc));
+    if (!p) {
+        perror("Error allocating partitions");
+        return -1;
+    }
+
+    int rc = 0;
+    for (int i = 0; i < ntraces && rc == 0; i++) {
+        p[i].trace = traces[i];
+        if (load_curve(&p[i], total, collapse) != 0 || build_hull(&p[i], total) != 0) {
+            perror("Error computing miss ratio curve");
+            rc = -1;
+        }
+    }
+
+    // SLOs first, then the rest for the fewest faults
+    int spare = total;
+    for (int i = 0; i < ntraces && rc == 0; i++) {
+        if (!slo || slo[i] <= 0.0) continue;
+        int need = slo_frames(&p[i], slo[i], total);
+        if (need < 0 || need > spare) continue;     // reported as unmet
+        p[i].frames = need;
+        spare -= need;
+    }
+    if (rc == 0) spare = allocate(p, ntraces, spare);
+    for (int i = 0; i < ntraces && rc == 0; i++) {
+        p[i].simulated = verify(cfg, &p[i]);
+        if (p[i].simulated < 0) {
+            perror("Error simulating partition");
+            rc = -1;
+        }
+    }
+
+    if (rc == 0) {
+        printf("\n--- Frame partitioning ---\n");
+        printf("Processes: %d, frames: %d, %d left unused\n", ntraces, total, spare);
+        printf("%4s %-20s %12s %9s %7s %8s %12s %8s %12s %8s %12s\n", "proc", "trace",
+               "accesses", "pages", "slo", "frames", "predicted", "rate", "simulated",
+               "rate", "equal split");
+        double pred = 0.0;
+        long long sim = 0, equal = 0, accesses = 0;
+        int unmet = 0;
+        for (int i = 0; i < ntraces; i++) {
+            // An equal split gives the first total % n processes a frame more
+            int eq = total / ntraces + (i < total % ntraces);
+            double h = hull_faults(&p[i], p[i].frames);
+            char target[16] = "-";
+            if (slo && slo[i] > 0.0) {
+                int miss = h > slo[i] * (double)p[i].t.accesses;
+                snprintf(target, sizeof target, "%.2f%%%s", 100.0 * slo[i], miss ? "*" : "");
+                unmet += miss;
+            }
+            printf("%4d %-20.20s %12lld %9ld %7s %8d %12.0f %7.2f%% %12lld %7.2f%% %12lld\n", i,
+                   p[i].trace, p[i].t.accesses, p[i].t.footprint, target, p[i].frames, h,
+                   pct(h, p[i].t.accesses), p[i].simulated,
+                   pct((double)p[i].simulated, p[i].t.accesses), p[i].faults[eq]);
+            pred += h;
+            sim += p[i].simulated;
+            equal += p[i].faults[eq];
+            accesses += p[i].t.accesses;
+        }
+        if (unmet) printf("* SLO out of reach with the frames available\n");
+        printf("Total faults: predicted %.0f, simulated %lld (%.2f%% of accesses), "
+               "equal split %lld\n", pred, sim, pct((double)sim, accesses), equal);
+        if (equal > 0)
+            printf("The split saves %.1f%% of the equal split's faults\n",
+                   100.0 * (double)(equal - sim) / (double)equal);
+    }
+
+    for (int i = 0; i < ntraces; i++) {
+        mrc_trace_free(&p[i].t);
+        free(p[i].faults);
+        free(p[i].hull);
+    }
+    free(p);
+    return rc;
+}
@@ -0,0 +1,24 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "sim.h"
+
+// Frame partitioning across processes (-partition): splits cfg->num_frames
+// between the processes of the given per-process traces so that total
+// faults are smallest, after first giving each process with a fault-rate
+// SLO the frames it needs to meet it.
+//
+// Each process's LRU miss ratio curve is computed exactly and replaced by
+// its lower convex hull. On convex curves, handing out frames greedily to
+// whichever process saves the most faults per frame is optimal. A size
+// between two hull vertices is made real as in Talus: the process's pages
+// are split by hash into two shadow partitions sized so that each behaves
+// like the process at one of the vertices, and faults interpolate between
+// them. The split is then checked by simulating every partition under LRU.
+
+// slo[i]: fault-rate target of process i (faults per access), 0 for none;
+// slo may be NULL
+int partition_run(const SimConfig *cfg, char **traces, int ntraces, int collapse,
+                  const double *slo);
+
+#endif
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pcprof.h"
+
+int pcprof_init(PcProfile *p) {
+    PcProfile zero = {0};
+    *p = zero;
+    return cuckoo_init(&p->index, 256);
+}
+
+void pcprof_free(PcProfile *p) {
+    cuckoo_free(&p->index);
+    free(p->pc);
+    free(p->accesses);
+    free(p->faults);
+    free(p->major);
+
+    PcProfile zero = {0};
+    *p = zero;
+}
+
+static int grow(PcProfile *p) {
+    int cap = p->cap ? p->cap * 2 : 256;
+    unsigned long *pc = (unsigned long *)realloc(p->pc, (size_t)cap * sizeof(unsigned long));
+    if (!pc) return -1;
+    p->pc = pc;
+    long long **arrays[] = { &p->accesses, &p->faults, &p->major };
+    for (int i = 0; i < 3; i++) {
+        long long *a = (long long *)realloc(*arrays[i], (size_t)cap * sizeof(long long));
+        if (!a) return -1;
+        *arrays[i] = a;
+    }
+    p->cap = cap;
+    return 0;
+}
+
+int pcprof_count(PcProfile *p, unsigned long pc, unsigned long accesses,
+                 int fault, int major) {
+    int i = cuckoo_find(&p->index, pc);
+    if (i < 0) {
+        if (p->n == p->cap && grow(p) != 0) return -1;
+        i = p->n++;
+        p->pc[i] = pc;
+        p->accesses[i] = p->faults[i] = p->major[i] = 0;
+        if (cuckoo_insert(&p->index, pc, i) != 0) return -1;
+    }
+    p->accesses[i] += (long long)accesses;
+    p->faults[i] += fault;
+    p->major[i] += major;
+    return 0;
+}
+
+// Slots of the instructions with the most faults, most first
+static int top_faulting(const PcProfile *p, int *top, int k) {
+    int m = 0;
+    for (int i = 0; i < p->n; i++) {
+        if (p->faults[i] == 0) continue;
+        int j = m < k ? m++ : k;
+        if (j == k) {
+            if (p->faults[i] <= p->faults[top[k - 1]]) continue;
+            j = k - 1;
+        }
+        while (j > 0 && p->faults[top[j - 1]] < p->faults[i]) {
+            top[j] = top[j - 1];
+            j--;
+        }
+        top[j] = i;
+    }
+    return m;
+}
+
+void pcprof_print(const PcProfile *p, long long total_faults) {
+    int top[PCPROF_TOP];
+    int m = top_faulting(p, top, PCPROF_TOP);
+    long long covered = 0;
+    for (int r = 0; r < m; r++) covered += p->faults[top[r]];
+
+    printf("\n--- Faulting instructions ---\n");
+    printf("Instructions: %d, the top %d cause %.1f%% of page faults\n", p->n, m,
+           total_faults > 0 ? 100.0 * (double)covered / (double)total_faults : 0.0);
+    if (m == 0) return;
+    printf("%4s %18s %10s %7s %10s %12s %11s\n", "rank", "pc", "faults", "share",
+           "major", "accesses", "fault rate");
+    for (int r = 0; r < m; r++) {
+        int i = top[r];
+        printf("%4d %#18lx %10lld %6.1f%% %10lld %12lld %10.2f%%\n", r + 1, p->pc[i],
+               p->faults[i],
+               total_faults > 0 ? 100.0 * (double)p->faults[i] / (double)total_faults : 0.0,
+               p->major[i], p->accesses[i],
+               100.0 * (double)p->faults[i] / (double)p->accesses[i]);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef PCPROF_H
+#define PCPROF_H
+
+#include "cuckoo.h"
+
+// Fault attribution by instruction, for traces that carry PCs: accesses
+// and faults per PC, reported as the instructions causing the most faults.
+
+#define PCPROF_TOP 10
+
+typedef struct PcProfile {
+    CuckooMap index;            // pc -> slot
+    unsigned long *pc;
+    long long *accesses, *faults, *major;
+    int n, cap;
+} PcProfile;
+
+int  pcprof_init(PcProfile *p);
+void pcprof_free(PcProfile *p);
+
+// `accesses` accesses by pc, the first of which took a fault if fault is
+// set (major: read from the backing store)
+int  pcprof_count(PcProfile *p, unsigned long pc, unsigned long accesses,
+                  int fault, int major);
+
+void pcprof_print(const PcProfile *p, long long total_faults);
+
+#endif
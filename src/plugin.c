@@ -0,0 +1,110 @@
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plugin.h"
+
+int plugin_load(Plugin *p, const char *spec, int num_frames) {
+    memset(p, 0, sizeof(*p));
+
+    // Arguments follow the first ".so:"
+    const char *args = "";
+    size_t len = strlen(spec);
+    const char *sep = strstr(spec, ".so:");
+    if (sep) {
+        len = (size_t)(sep - spec) + 3;
+        args = sep + 4;
+    }
+    if (len >= sizeof(p->path)) {
+        fprintf(stderr, "Plugin path too long: %s\n", spec);
+        return -1;
+    }
+    memcpy(p->path, spec, len);
+    p->path[len] = '\0';
+
+    // A bare file name would be searched for on the library path
+    char file[sizeof(p->path) + 2];
+    snprintf(file, sizeof(file), "%s%s", strchr(p->path, '/') ? "" : "./", p->path);
+    p->handle = dlopen(file, RTLD_NOW | RTLD_LOCAL);
+    if (!p->handle) {
+        fprintf(stderr, "Error loading policy plugin: %s\n", dlerror());
+        return -1;
+    }
+
+    OssimPolicyEntry entry;
+    *(void **)&entry = dlsym(p->handle, OSSIM_POLICY_SYMBOL);
+    p->ops = entry ? entry() : NULL;
+    if (!p->ops) {
+        fprintf(stderr, "%s does not export %s()\n", p->path, OSSIM_POLICY_SYMBOL);
+        plugin_free(p);
+        return -1;
+    }
+    if (p->ops->abi != OSSIM_POLICY_ABI || !p->ops->choose_victim || !p->ops->create) {
+        fprintf(stderr, "%s: unsupported policy ABI %d (expected %d) or missing "
+                        "create/choose_victim\n", p->path, p->ops->abi, OSSIM_POLICY_ABI);
+        plugin_free(p);
+        return -1;
+    }
+
+    p->state = p->ops->create(num_frames, args);
+    if (!p->state) {
+        fprintf(stderr, "%s: policy %s could not start with arguments \"%s\"\n",
+                p->path, p->ops->name ? p->ops->name : "?", args);
+        plugin_free(p);
+        return -1;
+    }
+    return 0;
+}
+
+void plugin_free(Plugin *p) {
+    if (p->state && p->ops->destroy) p->ops->destroy(p->state);
+    if (p->handle) dlclose(p->handle);
+    p->handle = NULL;
+    p->ops = NULL;
+    p->state = NULL;
+}
+
+void plugin_flush(Plugin *p) {
+    int n = p->nbatch;
+    if (n == 0) return;
+    p->nbatch = 0;
+    p->events += n;
+
+    const OssimPolicy *ops = p->ops;
+    if (ops->on_batch) {
+        ops->on_batch(p->state, p->batch, n);
+        p->calls++;
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        const PolicyEvent *e = &p->batch[i];
+        void (*hook)(void *, const PolicyEvent *) =
+            e->type == POLICY_HIT   ? ops->on_hit :
+            e->type == POLICY_FAULT ? ops->on_fault : ops->on_evict;
+        if (hook) {
+            hook(p->state, e);
+            p->calls++;
+        }
+    }
+}
+
+int plugin_choose_victim(Plugin *p, unsigned long tick, int num_frames) {
+    plugin_flush(p);
+    int f = p->ops->choose_victim(p->state, tick);
+    p->victims++;
+    if (f < 0 || f >= num_frames) {
+        fprintf(stderr, "Policy plugin %s chose frame %d of %d\n", p->path, f, num_frames);
+        exit(1);
+    }
+    return f;
+}
+
+void plugin_print_stats(const Plugin *p) {
+    long long events = p->events + p->nbatch;
+    printf("\n--- Policy plugin ---\n");
+    printf("Plugin: %s (%s)\n", p->ops->name ? p->ops->name : "unnamed", p->path);
+    printf("Events: %lld in %lld calls (%.1f per call), %lld victim choices\n",
+           events, p->calls, p->calls > 0 ? (double)p->events / (double)p->calls : 0.0,
+           p->victims);
+}
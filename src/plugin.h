@@ -0,0 +1,49 @@
+#ifndef PLUGIN_H
+#define PLUGIN_H
+
+#include "policy.h"
+
+// Simulator side of a replacement policy plugin (see policy.h). Events
+// collect in a fixed buffer that is handed to the plugin when it fills or
+// before the plugin is asked for a victim.
+
+#define PLUGIN_BATCH 256
+
+typedef struct Plugin {
+    void *handle;               // from dlopen
+    const OssimPolicy *ops;
+    void *state;
+    char path[256];
+
+    PolicyEvent batch[PLUGIN_BATCH];
+    int nbatch;
+
+    long long events, calls, victims;
+} Plugin;
+
+// spec is "path.so" or "path.so:args". Reports its own errors.
+int  plugin_load(Plugin *p, const char *spec, int num_frames);
+void plugin_free(Plugin *p);
+
+// Hands the queued events to the plugin
+void plugin_flush(Plugin *p);
+
+static inline void plugin_event(Plugin *p, int type, char op, int frame,
+                                unsigned long key, unsigned long tick,
+                                unsigned long count) {
+    PolicyEvent *e = &p->batch[p->nbatch++];
+    e->type = (unsigned char)type;
+    e->op = op;
+    e->frame = frame;
+    e->key = key;
+    e->tick = tick;
+    e->count = count;
+    if (p->nbatch == PLUGIN_BATCH) plugin_flush(p);
+}
+
+// Frame the plugin evicts; exits if it names a frame that does not exist
+int  plugin_choose_victim(Plugin *p, unsigned long tick, int num_frames);
+
+void plugin_print_stats(const Plugin *p);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+// Replacement policy plugin ABI. A plugin is a shared object loaded with
+// `-a plugin:path.so[:args]` that exports
+//
+//     const OssimPolicy *ossim_policy(void);
+//
+// This header is all a plugin needs; it does not link against the
+// simulator. Frames are numbered 0 .. num_frames-1 and pages are the
+// simulator's page keys (page number, with the ASID above bit 48).
+//
+// Only choose_victim is called synchronously. Hits, faults and evictions
+// are queued and handed over in batches, always before the next
+// choose_victim call, so the policy sees every earlier event before it
+// decides. A plugin implements either on_batch or the per-event hooks; with
+// OSSIM_POLICY_BATCH the per-event hooks are static inline functions that
+// the compiler folds into one loop, so no access costs an indirect call.
+
+#define OSSIM_POLICY_ABI 1
+
+typedef enum { POLICY_HIT, POLICY_FAULT, POLICY_EVICT } PolicyEventType;
+
+typedef struct {
+    unsigned char type;     // PolicyEventType
+    char op;                // 'R' or 'W'; 0 for evictions
+    int frame;
+    unsigned long key;
+    unsigned long tick;     // access count at the (last) access
+    unsigned long count;    // accesses covered: runs of hits come as one event
+} PolicyEvent;
+
+typedef struct {
+    int abi;                // OSSIM_POLICY_ABI
+    const char *name;       // shown in reports; NULL shows the path
+
+    // State for one simulator; args is the text after the path, or ""
+    void *(*create)(int num_frames, const char *args);
+    void  (*destroy)(void *state);
+
+    // Returns an occupied frame to evict. Required.
+    int   (*choose_victim)(void *state, unsigned long tick);
+
+    // Batched events, oldest first. If NULL the per-event hooks are used.
+    void  (*on_batch)(void *state, const PolicyEvent *ev, int n);
+
+    // Per-event hooks; any may be NULL
+    void  (*on_hit)(void *state, const PolicyEvent *ev);
+    void  (*on_fault)(void *state, const PolicyEvent *ev);
+    void  (*on_evict)(void *state, const PolicyEvent *ev);
+} OssimPolicy;
+
+typedef const OssimPolicy *(*OssimPolicyEntry)(void);
+#define OSSIM_POLICY_SYMBOL "ossim_policy"
+
+// Defines `static void name(void *, const PolicyEvent *, int)` dispatching
+// to three static inline handlers taking (state, event)
+#define OSSIM_POLICY_BATCH(name, hit, fault, evict)                       \
+    static void name(void *state, const PolicyEvent *ev, int n) {         \
+        for (int i = 0; i < n; i++) {                                     \
+            switch (ev[i].type) {                                         \
+            case POLICY_HIT:   hit(state, &ev[i]); break;                 \
+            case POLICY_FAULT: fault(state, &ev[i]); break;               \
+            case POLICY_EVICT: evict(state, &ev[i]); break;               \
+            }                                                             \
+        }                                                                 \
+    }
+
+#endif
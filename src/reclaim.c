@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "reclaim.h"
+#include "sim.h"
+
+// Predicted refault rates must leave this much room under the SLO
+#define RECLAIM_HEADROOM 0.8
+#define RECLAIM_ROWS     20
+
+void reclaim_config_defaults(ReclaimConfig *rc) {
+    rc->slo = 0.001;
+    rc->period = 10000;
+}
+
+int reclaim_init(Reclaim *rc, const ReclaimConfig *cfg) {
+    Reclaim zero = {0};
+    *rc = zero;
+    rc->cfg = *cfg;
+    rc->threshold = ~0UL;   // nothing is reclaimed before the first step
+    rc->next_step = (unsigned long)cfg->period;
+    if (cuckoo_init(&rc->out, 1024) != 0) return -1;
+    return 0;
+}
+
+void reclaim_free(Reclaim *rc) {
+    cuckoo_free(&rc->out);
+    free(rc->out_last);
+    free(rc->out_free);
+    free(rc->periods);
+
+    Reclaim zero = {0};
+    *rc = zero;
+}
+
+// Bucket 0 holds idle time 0, bucket b >= 1 holds [2^(b-1), 2^b)
+static int age_bucket(unsigned long age) {
+    int b = 0;
+    while (age) {
+        b++;
+        age >>= 1;
+    }
+    return b;
+}
+
+void reclaim_access(Reclaim *rc, unsigned long age) {
+    rc->hist[age_bucket(age)] += 1.0;
+    rc->accesses++;
+}
+
+unsigned long reclaim_fault(Reclaim *rc, unsigned long key, unsigned long tick) {
+    int i = cuckoo_find(&rc->out, key);
+    if (i < 0) return 0;
+    cuckoo_erase(&rc->out, key);
+    rc->out_free[rc->nout_free++] = i;
+    rc->refaults++;
+    return tick - rc->out_last[i];
+}
+
+// Remembers when a reclaimed page was last used
+static int remember(Reclaim *rc, unsigned long key, unsigned long last) {
+    if (rc->nout_free == 0) {
+        int cap = rc->out_cap ? rc->out_cap * 2 : 1024;
+        unsigned long *l = (unsigned long *)realloc(rc->out_last, (size_t)cap * sizeof(unsigned long));
+        if (!l) return -1;
+        rc->out_last = l;
+        int *f = (int *)realloc(rc->out_free, (size_t)cap * sizeof(int));
+        if (!f) return -1;
+        rc->out_free = f;
+        for (int i = cap - 1; i >= rc->out_cap; i--) rc->out_free[rc->nout_free++] = i;
+        rc->out_cap = cap;
+    }
+    int i = rc->out_free[--rc->nout_free];
+    rc->out_last[i] = last;
+    cuckoo_insert(&rc->out, key, i);
+    return 0;
+}
+
+// ---- Controller ----
+
+// Smallest power-of-two threshold whose predicted refault rate fits the SLO
+static unsigned long choose_threshold(const Reclaim *rc, unsigned long tick) {
+    double total = 0.0;
+    for (int b = 0; b < RECLAIM_BUCKETS; b++) total += rc->hist[b];
+    if (total <= 0.0) return rc->threshold;
+
+    // Threshold 2^k turns accesses from bucket k + 1 upwards into refaults
+    double above = total - rc->hist[0];
+    for (int k = 0; k < RECLAIM_BUCKETS - 1 && (1UL << k) <= tick / 4; k++) {
+        if (above <= rc->cfg.slo * RECLAIM_HEADROOM * total) return 1UL << k;
+        above -= rc->hist[k + 1];
+    }
+    return ~0UL;
+}
+
+static void record_period(Simulator *sim, Reclaim *rc) {
+    if (rc->nperiods == rc->periods_cap) {
+        int cap = rc->periods_cap ? rc->periods_cap * 2 : 256;
+        ReclaimPeriod *p = (ReclaimPeriod *)realloc(rc->periods, (size_t)cap * sizeof(ReclaimPeriod));
+        if (!p) return;
+        rc->periods = p;
+        rc->periods_cap = cap;
+    }
+    ReclaimPeriod *p = &rc->periods[rc->nperiods++];
+    p->threshold = rc->threshold;
+    p->accesses = rc->accesses;
+    p->refaults = rc->refaults;
+    p->reclaimed = rc->reclaimed;
+    p->out = (long)rc->out.count;
+    p->resident = sim->frames_used - sim->nfree;
+}
+
+static void step(Simulator *sim, Reclaim *rc) {
+    record_period(sim, rc);
+    int violated = (double)rc->refaults > rc->cfg.slo * (double)rc->accesses;
+
+    unsigned long t = choose_threshold(rc, sim->tick);
+    if (violated && rc->threshold != ~0UL && t < rc->threshold * 2) {
+        t = rc->threshold * 2;
+    }
+    rc->threshold = t;
+    for (int b = 0; b < RECLAIM_BUCKETS; b++) rc->hist[b] *= 0.5;
+    rc->accesses = rc->refaults = rc->reclaimed = 0;
+
+    for (int f = 0; f < sim->frames_used; f++) {
+        long key = ft_vpn(&sim->ft, f);
+        if (key == FRAME_EMPTY || ksm_is_stable_key((unsigned long)key)) continue;
+        unsigned long last = ft_last_used(&sim->ft, f);
+        if (sim->tick - last < rc->threshold) continue;
+        if (remember(rc, (unsigned long)key, last) != 0) break;
+        sim_reclaim_frame(sim, f);
+        rc->reclaimed++;
+    }
+}
+
+void reclaim_tick(Simulator *sim) {
+    Reclaim *rc = sim->reclaim;
+    while (sim->tick >= rc->next_step) {
+        rc->next_step += (unsigned long)rc->cfg.period;
+        step(sim, rc);
+    }
+}
+
+// ---- Report ----
+
+void reclaim_print_stats(const Reclaim *rc) {
+    long long acc = 0, ref = 0, rec = 0, violations = 0;
+    double out_sum = 0.0, mem_sum = 0.0;
+    for (int i = 0; i < rc->nperiods; i++) {
+        const ReclaimPeriod *p = &rc->periods[i];
+        acc += p->accesses;
+        ref += p->refaults;
+        rec += p->reclaimed;
+        out_sum += (double)p->out;
+        mem_sum += (double)(p->out + p->resident);
+        violations += (double)p->refaults > rc->cfg.slo * (double)p->accesses;
+    }
+
+    printf("\n--- Proactive reclaim ---\n");
+    printf("SLO: %.3f%% refaults/access, controller step every %ld accesses\n",
+           rc->cfg.slo * 100.0, rc->cfg.period);
+    if (rc->threshold == ~0UL) printf("Cold-age threshold: none (not reclaiming)\n");
+    else printf("Cold-age threshold: %lu accesses\n", rc->threshold);
+    printf("Reclaimed: %lld pages, %lld refaulted (%.3f%% of accesses)\n", rec, ref,
+           acc > 0 ? 100.0 * (double)ref / (double)acc : 0.0);
+    printf("Periods violating the SLO: %lld of %d\n", violations, rc->nperiods);
+    printf("Memory saved: %.1f pages on average (%.1f%% of the job's pages)\n",
+           rc->nperiods > 0 ? out_sum / rc->nperiods : 0.0,
+           mem_sum > 0.0 ? 100.0 * out_sum / mem_sum : 0.0);
+
+    if (rc->nperiods == 0) return;
+    int per_row = (rc->nperiods + RECLAIM_ROWS - 1) / RECLAIM_ROWS;
+    printf("%13s %14s %12s %13s %11s\n", "periods", "threshold", "pages saved",
+           "refault rate", "violations");
+    for (int s = 0; s < rc->nperiods; s += per_row) {
+        int e = s + per_row < rc->nperiods ? s + per_row : rc->nperiods;
+        long long a = 0, r = 0, v = 0;
+        double out = 0.0;
+        unsigned long thr = 0;
+        for (int i = s; i < e; i++) {
+            const ReclaimPeriod *p = &rc->periods[i];
+            a += p->accesses;
+            r += p->refaults;
+            v += (double)p->refaults > rc->cfg.slo * (double)p->accesses;
+            out += (double)p->out;
+            thr = p->threshold;
+        }
+        char tbuf[24];
+        if (thr == ~0UL) snprintf(tbuf, sizeof(tbuf), "none");
+        else snprintf(tbuf, sizeof(tbuf), "%lu", thr);
+        printf("%6d-%-6d %14s %12.1f %12.3f%% %11lld\n", s + 1, e, tbuf,
+               out / (e - s), a > 0 ? 100.0 * (double)r / (double)a : 0.0, v);
+    }
+}
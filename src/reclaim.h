@@ -0,0 +1,71 @@
+#ifndef RECLAIM_H
+#define RECLAIM_H
+
+#include "cuckoo.h"
+
+// Proactive reclaim controller in the style of software-defined far memory.
+// Every period, resident pages idle for at least the cold-age threshold are
+// reclaimed. An access to a reclaimed page is a refault (a promotion), and
+// the SLO bounds refaults per access over each period.
+//
+// The threshold is tuned online. Every access records the idle time the
+// page had, using the frames' last-use ticks, in a log2 histogram that
+// decays by half each period. Any access whose idle time was at least T
+// would have been a refault under threshold T, so the histogram predicts
+// the refault rate of every candidate threshold. The controller picks the
+// smallest one whose prediction stays within the SLO (with some headroom),
+// and at least doubles it after a period that violated the SLO. Thresholds
+// longer than a quarter of the history so far are not trusted yet, and
+// first touches are not accesses to an idle page, so they are not counted.
+
+struct Simulator;
+
+#define RECLAIM_BUCKETS 64
+
+typedef struct {
+    double slo;             // target refaults per access
+    long period;            // accesses between controller steps
+} ReclaimConfig;
+
+typedef struct {
+    unsigned long threshold;
+    long long accesses, refaults, reclaimed;
+    long out;               // reclaimed pages not yet refaulted, at the end
+    long resident;          // pages in memory, at the end
+} ReclaimPeriod;
+
+typedef struct Reclaim {
+    ReclaimConfig cfg;
+    unsigned long threshold;    // cold age in accesses
+    unsigned long next_step;
+    double hist[RECLAIM_BUCKETS];   // decayed accesses by log2 idle time
+
+    // Reclaimed pages: page key -> index of their last use tick
+    CuckooMap out;
+    unsigned long *out_last;
+    int *out_free;
+    int nout_free, out_cap;
+
+    long long accesses, refaults, reclaimed;    // current period
+    ReclaimPeriod *periods;
+    int nperiods, periods_cap;
+} Reclaim;
+
+void reclaim_config_defaults(ReclaimConfig *rc);
+
+int  reclaim_init(Reclaim *rc, const ReclaimConfig *cfg);
+void reclaim_free(Reclaim *rc);
+
+// An access to a page that had been idle for `age` accesses
+void reclaim_access(Reclaim *rc, unsigned long age);
+
+// A fault on key. If the controller reclaimed the page, counts a refault
+// and returns how long the page had been idle; returns 0 otherwise.
+unsigned long reclaim_fault(Reclaim *rc, unsigned long key, unsigned long tick);
+
+// Runs a controller step when one is due
+void reclaim_tick(struct Simulator *sim);
+
+void reclaim_print_stats(const Reclaim *rc);
+
+#endif
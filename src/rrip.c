@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rrip.h"
+
+#define LANE_ONES  0x1111111111111111ULL
+#define LANE_LOW3  0x7777777777777777ULL
+#define LANE_HIGH  0x8888888888888888ULL
+
+#define PSEL_MAX   ((1u << RRIP_PSEL_BITS) - 1)
+#define BRRIP_LONG 32       // BRRIP inserts at max - 1 once in this many
+#define SHADOW_MIN 64       // fewer slots than this make a noisy duel
+
+// ---- Packed RRPVs ----
+
+static int rrpv_init(RrpvArray *a, int n, unsigned int max) {
+    RrpvArray zero = {0};
+    *a = zero;
+    a->n = n;
+    a->max = max;
+    a->nwords = (n + RRIP_LANES - 1) / RRIP_LANES;
+    int tail = n % RRIP_LANES;
+    a->last_mask = tail ? (1ULL << (4 * tail)) - 1 : ~0ULL;
+
+    a->words = (unsigned long long *)malloc((size_t)a->nwords * sizeof(unsigned long long));
+    if (!a->words) return -1;
+    for (int i = 0; i < a->nwords; i++) a->words[i] = LANE_ONES * max;
+    a->words[a->nwords - 1] &= a->last_mask;
+    return 0;
+}
+
+// High bit of every 4-bit lane of w that equals the matching lane of pat
+static inline unsigned long long lanes_equal(unsigned long long w, unsigned long long pat) {
+    unsigned long long t = w ^ pat;
+    return ~(((t & LANE_LOW3) + LANE_LOW3) | t) & LANE_HIGH;
+}
+
+// First lane at value v at or after the hand, wrapping around, or -1
+static int rrpv_find(RrpvArray *a, unsigned int v) {
+    unsigned long long pat = LANE_ONES * v;
+    int start = a->hand / RRIP_LANES;
+    int lane = a->hand % RRIP_LANES;
+
+    // The starting word is visited twice: lanes from the hand on, then
+    // (after wrapping) the lanes before it
+    for (int k = 0; k <= a->nwords; k++) {
+        int i = (start + k) % a->nwords;
+        unsigned long long eq = lanes_equal(a->words[i], pat);
+        if (i == a->nwords - 1) eq &= a->last_mask;
+        if (k == 0) eq &= ~0ULL << (4 * lane);
+        else if (k == a->nwords) eq &= (1ULL << (4 * lane)) - 1;
+        a->words_scanned++;
+        if (eq) return i * RRIP_LANES + __builtin_ctzll(eq) / 4;
+    }
+    return -1;
+}
+
+static int rrpv_victim(RrpvArray *a) {
+    a->victims++;
+    for (;;) {
+        int i = rrpv_find(a, a->max);
+        if (i >= 0) {
+            a->hand = (i + 1) % a->n;
+            return i;
+        }
+
+        // Nothing at the maximum, so every RRPV is below it: no lane carries
+        a->aging_rounds++;
+        for (int w = 0; w < a->nwords; w++) a->words[w] += LANE_ONES;
+        a->words[a->nwords - 1] &= a->last_mask;
+    }
+}
+
+// Insertion RRPV of a new page
+static unsigned int insert_value(RrpvArray *a, int brrip) {
+    if (brrip && ++a->brip_count % BRRIP_LONG != 0) return a->max;
+    return a->max - 1;
+}
+
+// ---- Shadow directories ----
+
+static int shadow_init(RripShadow *s, int slots, unsigned int max) {
+    RripShadow zero = {0};
+    *s = zero;
+    s->keys = (unsigned long *)malloc((size_t)slots * sizeof(unsigned long));
+    if (!s->keys || rrpv_init(&s->rrpv, slots, max) != 0 ||
+        cuckoo_init(&s->map, (size_t)slots) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void shadow_free(RripShadow *s) {
+    free(s->keys);
+    free(s->rrpv.words);
+    cuckoo_free(&s->map);
+}
+
+// Returns 1 on a miss
+static int shadow_access(RripShadow *s, unsigned long key, int brrip) {
+    s->accesses++;
+    int i = cuckoo_find(&s->map, key);
+    if (i >= 0) {
+        rrpv_set(&s->rrpv, i, 0);
+        return 0;
+    }
+
+    s->misses++;
+    if (s->used < s->rrpv.n) {
+        i = s->used++;
+    } else {
+        i = rrpv_victim(&s->rrpv);
+        cuckoo_erase(&s->map, s->keys[i]);
+    }
+    s->keys[i] = key;
+    cuckoo_insert(&s->map, key, i);
+    rrpv_set(&s->rrpv, i, insert_value(&s->rrpv, brrip));
+    return 1;
+}
+
+void rrip_sample(Rrip *r, unsigned long key) {
+    if (shadow_access(&r->shadow[0], key, 0) && r->psel < PSEL_MAX) r->psel++;
+    if (shadow_access(&r->shadow[1], key, 1) && r->psel > 0) r->psel--;
+}
+
+// ---- Policy ----
+
+int rrip_init(Rrip *r, RripMode mode, int bits, int num_frames) {
+    Rrip zero = {0};
+    *r = zero;
+    r->mode = mode;
+    r->bits = bits;
+    r->psel = PSEL_MAX / 2;
+    unsigned int max = (1u << bits) - 1;
+    if (rrpv_init(&r->rrpv, num_frames, max) != 0) return -1;
+    if (mode != RRIP_DRRIP) return 0;
+
+    // Sample enough of the pages to give each shadow a useful size
+    long groups = ((long)SHADOW_MIN * RRIP_GROUPS + num_frames - 1) / num_frames;
+    r->sample_groups = groups < 1 ? 1 : groups > RRIP_GROUPS ? RRIP_GROUPS : (int)groups;
+    long slots = ((long)num_frames * r->sample_groups + RRIP_GROUPS - 1) / RRIP_GROUPS;
+    for (int s = 0; s < 2; s++) {
+        if (shadow_init(&r->shadow[s], (int)slots, max) != 0) {
+            rrip_free(r);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void rrip_free(Rrip *r) {
+    free(r->rrpv.words);
+    r->rrpv.words = NULL;
+    if (r->mode == RRIP_DRRIP) {
+        shadow_free(&r->shadow[0]);
+        shadow_free(&r->shadow[1]);
+    }
+    RripShadow zero = {0};
+    r->shadow[0] = r->shadow[1] = zero;
+}
+
+int rrip_choose_victim(Rrip *r) {
+    return rrpv_victim(&r->rrpv);
+}
+
+void rrip_insert(Rrip *r, int f, unsigned long key) {
+    if (r->mode == RRIP_DRRIP && rrip_sampled(r, key)) rrip_sample(r, key);
+    int brrip = r->mode == RRIP_BRRIP ||
+                (r->mode == RRIP_DRRIP && r->psel > PSEL_MAX / 2);
+    if (brrip) r->inserts_brrip++;
+    else r->inserts_srrip++;
+    rrpv_set(&r->rrpv, f, insert_value(&r->rrpv, brrip));
+}
+
+void rrip_print_stats(const Rrip *r) {
+    static const char *names[] = { "SRRIP", "BRRIP", "DRRIP" };
+    const RrpvArray *a = &r->rrpv;
+    double v = a->victims > 0 ? (double)a->victims : 1.0;
+
+    printf("\n--- RRIP ---\n");
+    printf("Policy: %s, %d-bit RRPVs, %d words of %d frames (%zu bytes)\n",
+           names[r->mode], r->bits, a->nwords, RRIP_LANES,
+           (size_t)a->nwords * sizeof(unsigned long long));
+    printf("Victims: %lld, %.2f aging rounds and %.1f words searched per victim\n",
+           a->victims, (double)a->aging_rounds / v, (double)a->words_scanned / v);
+    printf("Insertions: %lld at max - 1 (SRRIP), %lld mostly at max (BRRIP)\n",
+           r->inserts_srrip, r->inserts_brrip);
+    if (r->mode != RRIP_DRRIP) return;
+
+    const RripShadow *s = r->shadow;
+    printf("Dueling: %d of %d page groups sampled into %d shadow slots, "
+           "PSEL %u of %u (using %s)\n", r->sample_groups, RRIP_GROUPS, s[0].rrpv.n,
+           r->psel, PSEL_MAX, r->psel > PSEL_MAX / 2 ? "BRRIP" : "SRRIP");
+    for (int i = 0; i < 2; i++) {
+        printf("  %s shadow: %lld accesses, %.2f%% misses\n", names[i], s[i].accesses,
+               s[i].accesses > 0 ? 100.0 * (double)s[i].misses / (double)s[i].accesses : 0.0);
+    }
+}
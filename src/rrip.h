@@ -0,0 +1,97 @@
+#ifndef RRIP_H
+#define RRIP_H
+
+#include "cuckoo.h"
+
+// Re-reference interval prediction (Jaleel et al.). Every frame has an
+// RRPV of 2 or 3 bits: 0 means the page is expected back soon, the maximum
+// that it is not. A hit sets the RRPV to 0. The victim is a frame at the
+// maximum; if there is none, every RRPV is raised until one gets there.
+//
+//   SRRIP inserts new pages at max - 1, so a page that is never touched
+//         again goes before the pages that were, which makes scans harmless.
+//   BRRIP inserts at max, and at max - 1 only once in 32 insertions, which
+//         holds on to part of a working set larger than memory.
+//   DRRIP chooses between the two by set dueling. In a fully associative
+//         memory there are no sets to dedicate, and leader pages sharing
+//         frames with the rest would only measure how they fare against
+//         the followers, so the duel runs in two shadow directories
+//         instead: one SRRIP and one BRRIP, each holding the keys of a
+//         hash-sampled subset of pages in proportionally fewer slots. A
+//         miss in either moves a saturating counter, and all pages are
+//         inserted the way of the shadow that is missing less.
+//
+// RRPVs are packed 4 bits to a frame, 16 frames to a 64-bit word, and the
+// searches work on whole words at once (SWAR): one pass per word finds the
+// frames at a given value, and aging adds to all 16 lanes with one add.
+
+typedef enum { RRIP_SRRIP, RRIP_BRRIP, RRIP_DRRIP } RripMode;
+
+#define RRIP_LANES      16
+#define RRIP_GROUPS     64      // hash groups pages are sampled by
+#define RRIP_PSEL_BITS  10
+
+typedef struct {
+    unsigned long long *words;  // 4-bit lanes
+    int n, nwords;
+    unsigned long long last_mask;   // lanes of the last word in use
+    unsigned int max;
+    int hand;                   // searches start here, for round-robin ties
+    unsigned int brip_count;    // BRRIP insertions so far
+    long long victims, aging_rounds, words_scanned;
+} RrpvArray;
+
+typedef struct {
+    RrpvArray rrpv;
+    unsigned long *keys;        // sampled page in each slot
+    CuckooMap map;              // sampled page -> slot
+    int used;
+    long long accesses, misses;
+} RripShadow;
+
+typedef struct {
+    RripMode mode;
+    int bits;                   // RRPV width, 2 or 3
+    RrpvArray rrpv;             // one lane per frame
+
+    // DRRIP
+    int sample_groups;          // pages in groups below this are sampled
+    RripShadow shadow[2];       // SRRIP, BRRIP
+    unsigned int psel;          // high: the SRRIP shadow is missing more
+
+    long long inserts_srrip, inserts_brrip;
+} Rrip;
+
+int  rrip_init(Rrip *r, RripMode mode, int bits, int num_frames);
+void rrip_free(Rrip *r);
+
+static inline void rrpv_set(RrpvArray *a, int i, unsigned int v) {
+    unsigned long long *w = &a->words[i / RRIP_LANES];
+    int shift = 4 * (i % RRIP_LANES);
+    *w = (*w & ~(0xfULL << shift)) | ((unsigned long long)v << shift);
+}
+
+static inline int rrip_sampled(const Rrip *r, unsigned long key) {
+    return (int)((key * 0x9e3779b97f4a7c15UL) >> 58) < r->sample_groups;
+}
+
+// Runs an access to a sampled page through both shadows
+void rrip_sample(Rrip *r, unsigned long key);
+
+// A hit on page `key` in frame f
+static inline void rrip_hit(Rrip *r, int f, unsigned long key) {
+    rrpv_set(&r->rrpv, f, 0);
+    if (r->mode == RRIP_DRRIP && rrip_sampled(r, key)) rrip_sample(r, key);
+}
+
+// Page `key` was faulted into frame f
+void rrip_insert(Rrip *r, int f, unsigned long key);
+
+// Moves frame f to the distant RRPV, first in line for eviction
+static inline void rrip_demote(Rrip *r, int f) { rrpv_set(&r->rrpv, f, r->rrpv.max); }
+
+int  rrip_choose_victim(Rrip *r);
+
+void rrip_print_stats(const Rrip *r);
+
+#endif
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sched.h"
+#include "trace.h"
+
+typedef enum { PROC_READY, PROC_BLOCKED, PROC_DONE } ProcState;
+
+typedef struct {
+    TraceReader tr;
+    unsigned short asid;
+    ProcState state;
+    TraceRecord pending;    // rest of a run interrupted by a fault
+    int has_pending;
+    double wake_time;       // when the blocking fault completes
+    double vruntime;        // CPU time received, for CFS
+} Process;
+
+typedef struct {
+    double now;             // simulated time in cycles
+    double busy;            // cycles the CPU spent running processes
+    double *disk_free;      // per disk: when it finishes its queued I/O
+    int disks;
+    long long accesses;
+    long long switches;
+} Machine;
+
+void sched_config_defaults(SchedConfig *sc) {
+    sc->policy = SCHED_RR;
+    sc->quantum = 1000;
+    sc->switch_lat = 1000.0;
+    sc->max_procs = 1;
+    sc->disks = 1;
+    sc->swap = NULL;
+    sc->ssd = NULL;
+    sc->far = NULL;
+}
+
+// CPU time of an access; major faults are waited for instead
+static double access_cost(const SimConfig *cfg, int result) {
+    switch (result) {
+    case ACC_TLB_HIT:     return cfg->tlb_lat;
+    case ACC_ZERO_FAULT:  return cfg->zero_lat;
+    case ACC_MINOR_FAULT: return cfg->minor_lat;
+    default:              return cfg->mem_lat;
+    }
+}
+
+// Resumes p for up to `quantum` accesses. Returns -1 on a simulation error.
+static int proc_run(Simulator *sim, Machine *m, Process *p, long quantum) {
+    const SimConfig *cfg = &sim->cfg;
+    long budget = quantum;
+    sim->asid = p->asid;
+
+    while (budget > 0) {
+        TraceRecord rec;
+        if (p->has_pending) {
+            rec = p->pending;
+            p->has_pending = 0;
+        } else if (!trace_next(&p->tr, &rec)) {
+            p->state = PROC_DONE;
+            return 0;
+        }
+
+        if (rec.op == 'D') {
+            sim_mark_dirty(sim, rec.addr);
+            continue;
+        }
+        if (rec.op != 'R' && rec.op != 'W') {
+            for (unsigned long n = 0; n < rec.count; n++) sim_skip(sim);
+            continue;
+        }
+
+        // The device model sees the machine's clock; a full write queue
+        // holds up the process doing reclaim
+        double stalled = sim->stats.write_stall;
+        sim->now = m->now;
+        sim->pc = rec.pc;
+        int r = sim_access(sim, rec.op, rec.addr);
+        if (r < 0) return -1;
+        m->accesses++;
+        budget--;
+
+        double cost = access_cost(cfg, r);
+        m->now += sim->stats.write_stall - stalled;
+        m->now += cost;
+        m->busy += cost;
+        p->vruntime += cost;
+
+        unsigned long rest = rec.count - 1;
+        unsigned long rest_writes = rec.writes - (rec.op == 'W' ? 1 : 0);
+
+        if (r == ACC_FAULT) {
+            if (sim_has_device(sim)) {
+                // The device model already queued the read
+                p->wake_time = sim->fault_done;
+            } else {
+                // Block until the first free disk has read the page
+                int d = 0;
+                for (int i = 1; i < m->disks; i++) {
+                    if (m->disk_free[i] < m->disk_free[d]) d = i;
+                }
+                double start = (m->disk_free[d] > m->now) ? m->disk_free[d] : m->now;
+                m->disk_free[d] = start + cfg->disk_lat;
+                p->wake_time = m->disk_free[d];
+            }
+            p->state = PROC_BLOCKED;
+
+            if (rest > 0) {
+                // The rest keeps the record's PC, timestamp and content
+                p->pending = rec;
+                p->pending.op = (rest_writes > 0) ? 'W' : 'R';
+                p->pending.count = rest;
+                p->pending.writes = rest_writes;
+                p->has_pending = 1;
+            }
+            return 0;
+        }
+
+        if (rest > 0) {
+            // Same page, just touched: the rest of the run hits
+            r = sim_access_run(sim, rest_writes > 0 ? 'W' : 'R', rec.addr,
+                               rest, rest_writes);
+            if (r < 0) return -1;
+            cost = (double)rest * access_cost(cfg, r);
+            m->accesses += (long long)rest;
+            budget -= (long)rest;
+            m->now += cost;
+            m->busy += cost;
+            p->vruntime += cost;
+        }
+    }
+    return 0;
+}
+
+static int pick_next(const Process *procs, int n, int last, SchedPolicy policy) {
+    int best = -1;
+    for (int k = 1; k <= n; k++) {
+        int i = (last + k) % n;
+        if (procs[i].state != PROC_READY) continue;
+        if (policy == SCHED_RR) return i;
+        if (best < 0 || procs[i].vruntime < procs[best].vruntime) best = i;
+    }
+    return best;
+}
+
+// Simulates nprocs processes to completion and prints one result row
+static int run_mix(const SimConfig *cfg, const SchedConfig *sc,
+                   char **traces, int ntraces, int nprocs, double *throughput) {
+    Simulator sim;
+    if (sim_init(&sim, cfg) != 0) return -1;
+    if ((sc->swap && sim_enable_swap(&sim, sc->swap) != 0) ||
+        (sc->ssd && sim_enable_ssd(&sim, sc->ssd) != 0) ||
+        (sc->far && sim_enable_far(&sim, sc->far) != 0)) {
+        sim_free(&sim);
+        return -1;
+    }
+
+    Machine m = {0};
+    Process *procs = (Process *)calloc((size_t)nprocs, sizeof(Process));
+    m.disk_free = (double *)calloc((size_t)sc->disks, sizeof(double));
+    m.disks = sc->disks;
+    if (!procs || !m.disk_free) {
+        perror("Error allocating processes");
+        free(procs);
+        free(m.disk_free);
+        sim_free(&sim);
+        return -1;
+    }
+
+    int err = 0;
+    for (int i = 0; i < nprocs; i++) {
+        const char *path = traces[i % ntraces];
+        if (trace_open(&procs[i].tr, path, 1) != 0) {
+            perror(path);
+            err = 1;
+            nprocs = i;
+            break;
+        }
+        procs[i].asid = (unsigned short)(i + 1);
+        procs[i].state = PROC_READY;
+    }
+
+    int last = nprocs - 1;
+    int running = nprocs;
+
+    while (!err && running > 0) {
+        // Wake processes whose fault has been served
+        for (int i = 0; i < nprocs; i++) {
+            if (procs[i].state == PROC_BLOCKED && procs[i].wake_time <= m.now) {
+                procs[i].state = PROC_READY;
+            }
+        }
+
+        int next = pick_next(procs, nprocs, last, sc->policy);
+        if (next < 0) {
+            // Everyone is waiting for the disk: the CPU idles
+            double wake = -1.0;
+            for (int i = 0; i < nprocs; i++) {
+                if (procs[i].state == PROC_BLOCKED &&
+                    (wake < 0.0 || procs[i].wake_time < wake)) {
+                    wake = procs[i].wake_time;
+                }
+            }
+            m.now = wake;
+            continue;
+        }
+
+        if (next != last) {
+            m.now += sc->switch_lat;
+            m.switches++;
+        }
+        last = next;
+
+        if (proc_run(&sim, &m, &procs[next], sc->quantum) != 0) err = 1;
+        if (procs[next].state == PROC_DONE) running--;
+    }
+
+    if (!err) {
+        double util = (m.now > 0.0) ? m.busy / m.now : 0.0;
+        *throughput = (m.now > 0.0) ? (double)m.accesses / m.now * 1e6 : 0.0;
+        double fault_rate = (m.accesses > 0)
+                                ? (double)sim.stats.major_faults / (double)m.accesses
+                                : 0.0;
+        printf("%5d %12lld %12lld %9.2f%% %9.2f%% %14.2f %10lld\n",
+               nprocs, m.accesses, sim.stats.major_faults, fault_rate * 100.0,
+               util * 100.0, *throughput, m.switches);
+    }
+
+    for (int i = 0; i < nprocs; i++) trace_close(&procs[i].tr);
+    free(procs);
+    free(m.disk_free);
+    sim_free(&sim);
+    return err ? -1 : 0;
+}
+
+int sched_sweep(const SimConfig *cfg, const SchedConfig *sc,
+                char **traces, int ntraces) {
+    printf("\n--- Multiprogramming (%s, quantum %ld accesses, %d frames, "
+           "%d disk%s) ---\n", sc->policy == SCHED_RR ? "round-robin" : "CFS",
+           sc->quantum, cfg->num_frames, sc->disks, sc->disks == 1 ? "" : "s");
+    printf("%5s %12s %12s %10s %10s %14s %10s\n", "procs", "accesses",
+           "major flt", "fault rate", "CPU util", "acc/Mcycle", "switches");
+
+    int knee = 0;
+    double best = -1.0;
+    for (int n = 1; n <= sc->max_procs; n++) {
+        double throughput = 0.0;
+        if (run_mix(cfg, sc, traces, ntraces, n, &throughput) != 0) return -1;
+        if (throughput > best) {
+            best = throughput;
+            knee = n;
+        }
+    }
+
+    printf("Peak throughput: %.2f accesses/Mcycle at %d process%s\n",
+           best, knee, knee == 1 ? "" : "es");
+    if (knee < sc->max_procs) {
+        printf("Thrashing knee: throughput falls beyond %d processes\n", knee);
+    }
+    return 0;
+}
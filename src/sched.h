@@ -0,0 +1,36 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "sim.h"
+
+// Multiprogramming mode. Each process replays its own trace in its own
+// address space and runs as a stackless coroutine: it executes accesses
+// until its time slice ends, its trace ends, or it takes a page fault,
+// in which case it blocks until a disk has served it. Faults are queued
+// FCFS on the first disk to become free, unless an SSD or far-memory model
+// times them.
+// Memory is shared, so adding processes eventually makes them steal each
+// other's frames and CPU utilization collapses.
+
+typedef enum { SCHED_RR, SCHED_CFS } SchedPolicy;
+
+typedef struct {
+    SchedPolicy policy;
+    long quantum;           // accesses per time slice
+    double switch_lat;      // cycles per context switch
+    int max_procs;          // sweep 1..max_procs processes
+    int disks;              // I/Os the backing store serves in parallel
+    const SwapConfig *swap; // optional swap space model
+    const SsdConfig *ssd;   // optional swap device model, needs swap
+    const FarConfig *far;   // or swap in far memory
+} SchedConfig;
+
+void sched_config_defaults(SchedConfig *sc);
+
+// Runs the sweep over the given per-process traces (reused round-robin if
+// there are fewer traces than processes) and prints one row per degree
+// of multiprogramming. Returns 0 on success.
+int  sched_sweep(const SimConfig *cfg, const SchedConfig *sc,
+                 char **traces, int ntraces);
+
+#endif
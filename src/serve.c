@@ -0,0 +1,666 @@
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cuckoo.h"
+#include "mrc.h"
+#include "serve.h"
+#include "trace.h"
+
+#define SERVE_QUEUE 64          // accepted connections waiting for a worker
+#define SERVE_REPLY 2048
+
+typedef struct {
+    const char *name;           // path as given on the command line
+    TraceRecord *rec;
+    long n;
+    long long accesses;
+    long footprint;
+    pthread_mutex_t lock;       // guards the curve
+    long long *mrc;             // LRU faults at 0..footprint frames, once computed
+} ServeTrace;
+
+typedef struct {
+    char *key, *reply;
+} CacheEntry;
+
+typedef struct {
+    ServeTrace *traces;
+    int ntraces;
+    SimConfig base;
+    int lfd;
+    int stop;
+
+    // Accepted connections, handed to workers
+    int queue[SERVE_QUEUE];
+    int qhead, qlen;
+    int *active;                // connection each worker is serving, -1 if idle
+    int workers;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+
+    CacheEntry cache[SERVE_CACHE];
+    int cache_next;             // FIFO replacement
+    long long queries, cache_hits, mrc_answers;
+    pthread_mutex_t cache_lock;
+} Server;
+
+// ---- Traces ----
+
+static int load_trace(ServeTrace *t, const char *path, int collapse) {
+    // Names go into replies verbatim and queries cannot escape them
+    for (const char *c = path; *c; c++) {
+        if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20) {
+            fprintf(stderr, "%s: trace names cannot hold quotes, backslashes or "
+                            "control characters\n", path);
+            return -1;
+        }
+    }
+    TraceReader tr;
+    if (trace_open(&tr, path, collapse) != 0) {
+        perror(path);
+        return -1;
+    }
+    CuckooMap pages;
+    if (cuckoo_init(&pages, 1024) != 0) {
+        trace_close(&tr);
+        return -1;
+    }
+    t->name = path;
+    long cap = 0;
+    int rc = 0;
+    TraceRecord rec;
+    while (rc == 0 && trace_next(&tr, &rec)) {
+        if (t->n == cap) {
+            cap = cap ? cap * 2 : 65536;
+            TraceRecord *grown = (TraceRecord *)realloc(t->rec, (size_t)cap * sizeof(TraceRecord));
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            t->rec = grown;
+        }
+        t->rec[t->n++] = rec;
+        if (rec.op != 'R' && rec.op != 'W') continue;
+        t->accesses += (long long)rec.count;
+        unsigned long key = rec.addr / PAGE_SIZE;
+        if (cuckoo_find(&pages, key) < 0) rc = cuckoo_insert(&pages, key, 0);
+    }
+    t->footprint = (long)pages.count;
+    cuckoo_free(&pages);
+    trace_close(&tr);
+    pthread_mutex_init(&t->lock, NULL);
+    return rc;
+}
+
+static ServeTrace *find_trace(Server *s, const char *name) {
+    for (int i = 0; i < s->ntraces; i++)
+        if (strcmp(s->traces[i].name, name) == 0) return &s->traces[i];
+    // A lone trace answers to any name
+    return s->ntraces == 1 && !*name ? &s->traces[0] : NULL;
+}
+
+// The LRU curve up to the footprint, computed by the first query needing it
+static const long long *trace_mrc(ServeTrace *t) {
+    pthread_mutex_lock(&t->lock);
+    if (!t->mrc) {
+        MrcTrace m = {0};
+        MrcCurve c = {0};
+        int max = t->footprint > 0 ? (int)t->footprint : 1;
+        if (t->n <= MRC_MAX_RECORDS) {
+            m.key = (unsigned long *)malloc(((size_t)t->n + 1) * sizeof(unsigned long));
+            m.count = (unsigned long *)malloc(((size_t)t->n + 1) * sizeof(unsigned long));
+        }
+        if (m.key && m.count) {
+            for (long i = 0; i < t->n; i++) {
+                if (t->rec[i].op != 'R' && t->rec[i].op != 'W') continue;
+                m.key[m.n] = t->rec[i].addr / PAGE_SIZE;
+                m.count[m.n] = t->rec[i].count;
+                m.n++;
+            }
+            m.accesses = t->accesses;
+            m.footprint = t->footprint;
+        }
+        long long *faults = NULL;
+        if (m.key && m.count && mrc_curve_init(&c, max, t->accesses) == 0 &&
+            mrc_lru(&m, &c) == 0)
+            faults = (long long *)malloc(((size_t)max + 1) * sizeof(long long));
+        if (faults) {
+            faults[0] = t->accesses;
+            for (int k = 1; k <= max; k++) faults[k] = faults[k - 1] - c.hits[k];
+        }
+        t->mrc = faults;
+        mrc_curve_free(&c);
+        mrc_trace_free(&m);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return t->mrc;
+}
+
+// ---- JSON ----
+
+// Start of the value of "key" in the object js points into, or NULL.
+// Keys of nested objects are skipped; escapes in strings are not supported.
+static const char *json_value(const char *js, const char *key) {
+    size_t len = strlen(key);
+    int depth = 0;
+    for (const char *p = js; *p; p++) {
+        if (*p == '{' || *p == '[') {
+            depth++;
+        } else if (*p == '}' || *p == ']') {
+            if (--depth <= 0) return NULL;
+        } else if (*p == '"') {
+            const char *end = strchr(p + 1, '"');
+            if (!end) return NULL;
+            if (depth == 1 && (size_t)(end - p - 1) == len && strncmp(p + 1, key, len) == 0) {
+                const char *q = end + 1;
+                while (isspace((unsigned char)*q)) q++;
+                if (*q == ':') {
+                    q++;
+                    while (isspace((unsigned char)*q)) q++;
+                    return q;
+                }
+            }
+            p = end;
+        }
+    }
+    return NULL;
+}
+
+static int json_string(const char *js, const char *key, char *buf, size_t len) {
+    const char *v = json_value(js, key);
+    if (!v || *v != '"') return -1;
+    size_t n = 0;
+    for (v++; *v && *v != '"' && n + 1 < len; v++) buf[n++] = *v;
+    buf[n] = '\0';
+    return *v == '"' ? 0 : -1;
+}
+
+static int json_number(const char *js, const char *key, double *out) {
+    const char *v = json_value(js, key);
+    if (!v) return -1;
+    char *end;
+    double d = strtod(v, &end);
+    if (end == v) return -1;
+    *out = d;
+    return 0;
+}
+
+// An integer field within [lo, hi] into out; -1 if it is anything else
+static int json_int(const char *js, const char *key, int lo, int hi, int *out) {
+    double v;
+    if (json_number(js, key, &v) != 0) return 0;
+    if (!(v >= lo && v <= hi) || v != (double)(long)v) return -1;
+    *out = (int)v;
+    return 0;
+}
+
+// ---- Queries ----
+
+// Stops accepting and ends every connection once the queries its client
+// already sent are answered, so no worker waits on a client to hang up
+static void stop_serving(Server *s) {
+    pthread_mutex_lock(&s->lock);
+    s->stop = 1;
+    pthread_cond_broadcast(&s->ready);
+    if (s->lfd >= 0) shutdown(s->lfd, SHUT_RDWR);      // wakes the accept loop
+    for (int i = 0; i < s->workers; i++)
+        if (s->active[i] >= 0) shutdown(s->active[i], SHUT_RD);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static double ms_since(struct timespec t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return 1e3 * (double)(t1.tv_sec - t0.tv_sec) + 1e-6 * (double)(t1.tv_nsec - t0.tv_nsec);
+}
+
+static void error_reply(char *reply, const char *msg) {
+    snprintf(reply, SERVE_REPLY, "{\"ok\":false,\"error\":\"%s\"}", msg);
+}
+
+// The query's configuration on top of the command line's: 0, -1 if it is
+// invalid, -2 if it names a plugin other than the command line's
+static int query_config(const char *q, const SimConfig *base, SimConfig *cfg, char *policy,
+                        size_t len) {
+    *cfg = *base;
+    cfg->quiet = 1;
+    if (json_string(q, "policy", policy, len) == 0) {
+        if (sim_config_algorithm(cfg, policy) != 0) return -1;
+        // Loading a plugin runs its code, so a client may not pick one
+        if (cfg->alg == ALG_PLUGIN) {
+            if (base->alg != ALG_PLUGIN || strcmp(cfg->plugin, base->plugin) != 0) return -2;
+            cfg->plugin = base->plugin;
+        }
+    } else {
+        policy[0] = '\0';
+    }
+    if (json_int(q, "frames", 1, INT_MAX, &cfg->num_frames) != 0 ||
+        json_int(q, "tlb", 0, INT_MAX, &cfg->tlb_size) != 0 ||
+        json_int(q, "swapcache", 0, INT_MAX, &cfg->swap_cache) != 0 ||
+        json_int(q, "rrpv_bits", 2, 3, &cfg->rrpv_bits) != 0)
+        return -1;
+
+    char word[16];
+    if (json_string(q, "pt", word, sizeof word) == 0) {
+        if      (strcmp(word, "flat") == 0)     cfg->pt_mode = PT_FLAT;
+        else if (strcmp(word, "inverted") == 0) cfg->pt_mode = PT_INVERTED;
+        else if (strcmp(word, "cuckoo") == 0)   cfg->pt_mode = PT_CUCKOO;
+        else return -1;
+    }
+    if (json_string(q, "write", word, sizeof word) == 0) {
+        if      (strcmp(word, "wt") == 0) cfg->write_policy = WP_WRITE_THROUGH;
+        else if (strcmp(word, "wb") == 0) cfg->write_policy = WP_WRITE_BACK;
+        else return -1;
+    }
+
+    const char *lat = json_value(q, "latency");
+    if (lat && *lat == '{') {
+        json_number(lat, "tlb", &cfg->tlb_lat);
+        json_number(lat, "mem", &cfg->mem_lat);
+        json_number(lat, "zero", &cfg->zero_lat);
+        json_number(lat, "minor", &cfg->minor_lat);
+        json_number(lat, "disk", &cfg->disk_lat);
+    }
+    return 0;
+}
+
+static void sim_reply(const ServeTrace *t, const SimConfig *cfg, const char *name,
+                      long long faults, long long zero, long long major, long long write_backs,
+                      double amat, const char *source, double ms, char *reply) {
+    snprintf(reply, SERVE_REPLY,
+             "{\"ok\":true,\"trace\":\"%s\",\"policy\":\"%s\",\"frames\":%d,\"tlb\":%d,"
+             "\"accesses\":%lld,\"faults\":%lld,\"fault_rate\":%.6f,\"zero_faults\":%lld,"
+             "\"major_faults\":%lld,\"write_backs\":%lld,\"amat\":%.2f,"
+             "\"source\":\"%s\",\"ms\":%.3f}",
+             t->name, name, cfg->num_frames, cfg->tlb_size, t->accesses, faults,
+             t->accesses > 0 ? (double)faults / (double)t->accesses : 0.0, zero, major,
+             write_backs, amat, source, ms);
+}
+
+// Replays the decoded trace on a fresh simulator
+static int simulate(const ServeTrace *t, const SimConfig *cfg, char *reply, struct timespec t0) {
+    Simulator sim;
+    if (sim_init(&sim, cfg) != 0) return -1;
+    int rc = 0;
+    for (long i = 0; i < t->n && rc == 0; i++) {
+        if (sim_replay_record(&sim, &t->rec[i]) < 0) rc = -1;
+    }
+    if (rc == 0) {
+        const SimStats *st = &sim.stats;
+        sim_reply(t, cfg, sim_alg_name(&sim), st->page_faults, st->zero_faults,
+                  st->major_faults, st->write_backs, sim_amat(&sim), "simulation",
+                  ms_since(t0), reply);
+    }
+    sim_free(&sim);
+    return rc;
+}
+
+// LRU without a TLB or swap cache is priced from the curve: first touches
+// are demand-zero faults and the rest major; write-through never writes back
+static int from_mrc(Server *s, ServeTrace *t, const SimConfig *cfg, char *reply,
+                    struct timespec t0) {
+    if (cfg->alg != ALG_LRU || cfg->tlb_size > 0 || cfg->swap_cache > 0 ||
+        cfg->write_policy != WP_WRITE_THROUGH)
+        return 0;
+    const long long *mrc = trace_mrc(t);
+    if (!mrc) return 0;
+    long long faults = mrc[cfg->num_frames], zero = t->footprint;
+    double amat = cfg->mem_lat;
+    if (t->accesses > 0)
+        amat += ((double)zero * cfg->zero_lat + (double)(faults - zero) * cfg->disk_lat) /
+                (double)t->accesses;
+    sim_reply(t, cfg, "LRU", faults, zero, faults - zero, 0, amat, "mrc", ms_since(t0), reply);
+    pthread_mutex_lock(&s->cache_lock);
+    s->mrc_answers++;
+    pthread_mutex_unlock(&s->cache_lock);
+    return 1;
+}
+
+static int cache_get(Server *s, const char *key, char *reply) {
+    int found = 0;
+    pthread_mutex_lock(&s->cache_lock);
+    for (int i = 0; i < SERVE_CACHE && !found; i++) {
+        if (s->cache[i].key && strcmp(s->cache[i].key, key) == 0) {
+            // Flagged by swapping the closing brace for one more field
+            snprintf(reply, SERVE_REPLY, "%.*s,\"cached\":true}",
+                     (int)strlen(s->cache[i].reply) - 1, s->cache[i].reply);
+            s->cache_hits++;
+            found = 1;
+        }
+    }
+    pthread_mutex_unlock(&s->cache_lock);
+    return found;
+}
+
+static void cache_put(Server *s, const char *key, const char *reply) {
+    char *k = strdup(key), *r = strdup(reply);
+    if (!k || !r) {
+        free(k);
+        free(r);
+        return;
+    }
+    pthread_mutex_lock(&s->cache_lock);
+    CacheEntry *e = &s->cache[s->cache_next];
+    s->cache_next = (s->cache_next + 1) % SERVE_CACHE;
+    free(e->key);
+    free(e->reply);
+    e->key = k;
+    e->reply = r;
+    pthread_mutex_unlock(&s->cache_lock);
+}
+
+static void query_sim(Server *s, const char *q, char *reply) {
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    char name[SERVE_LINE / 4] = "", policy[SERVE_LINE / 4];
+    json_string(q, "trace", name, sizeof name);
+    ServeTrace *t = find_trace(s, name);
+    if (!t) {
+        error_reply(reply, "unknown trace");
+        return;
+    }
+    SimConfig cfg;
+    int bad = query_config(q, &s->base, &cfg, policy, sizeof policy);
+    if (bad != 0) {
+        error_reply(reply, bad == -2 ? "only the command line's plugin can be queried"
+                                     : "bad configuration");
+        return;
+    }
+    // Frames beyond the footprint are never used, so don't allocate them
+    if (cfg.num_frames > t->footprint) cfg.num_frames = t->footprint > 0 ? (int)t->footprint : 1;
+
+    // Everything the result depends on
+    char key[SERVE_LINE];
+    snprintf(key, sizeof key, "%s|%d|%s|%d|%d|%d|%d|%d|%d|%g|%g|%g|%g|%g", t->name, cfg.alg,
+             cfg.alg == ALG_PLUGIN ? cfg.plugin : "", cfg.num_frames, cfg.tlb_size,
+             cfg.swap_cache, cfg.rrpv_bits, cfg.pt_mode, cfg.write_policy, cfg.tlb_lat,
+             cfg.mem_lat, cfg.zero_lat, cfg.minor_lat, cfg.disk_lat);
+    if (cache_get(s, key, reply)) return;
+    if (from_mrc(s, t, &cfg, reply, t0)) return;
+    if (simulate(t, &cfg, reply, t0) != 0) {
+        error_reply(reply, "simulation failed");
+        return;
+    }
+    cache_put(s, key, reply);
+}
+
+static void query_mrc(Server *s, const char *q, char *reply) {
+    char name[SERVE_LINE / 4] = "";
+    json_string(q, "trace", name, sizeof name);
+    ServeTrace *t = find_trace(s, name);
+    if (!t) {
+        error_reply(reply, "unknown trace");
+        return;
+    }
+    const long long *mrc = trace_mrc(t);
+    if (!mrc) {
+        error_reply(reply, "cannot compute the miss ratio curve");
+        return;
+    }
+    int n = snprintf(reply, SERVE_REPLY,
+                     "{\"ok\":true,\"trace\":\"%s\",\"accesses\":%lld,\"footprint\":%ld,"
+                     "\"faults\":[", t->name, t->accesses, t->footprint);
+    const char *v = json_value(q, "sizes");
+    int count = 0;
+    if (v && *v == '[') {
+        v++;
+        for (;;) {
+            char *end;
+            long size = strtol(v, &end, 10);
+            if (end == v) break;
+            if (size < 0) size = 0;
+            if (size > t->footprint) size = t->footprint;
+            if (n < SERVE_REPLY - 64)
+                n += snprintf(reply + n, (size_t)(SERVE_REPLY - n), "%s[%ld,%lld]",
+                              count++ ? "," : "", size, mrc[size]);
+            v = end;
+            while (isspace((unsigned char)*v) || *v == ',') v++;
+        }
+    }
+    snprintf(reply + n, (size_t)(SERVE_REPLY - n), "]}");
+}
+
+static void query_traces(Server *s, char *reply) {
+    int n = snprintf(reply, SERVE_REPLY, "{\"ok\":true,\"traces\":[");
+    for (int i = 0; i < s->ntraces && n < SERVE_REPLY - 128; i++) {
+        const ServeTrace *t = &s->traces[i];
+        n += snprintf(reply + n, (size_t)(SERVE_REPLY - n),
+                      "%s{\"name\":\"%s\",\"records\":%ld,\"accesses\":%lld,\"footprint\":%ld}",
+                      i ? "," : "", t->name, t->n, t->accesses, t->footprint);
+    }
+    pthread_mutex_lock(&s->cache_lock);
+    snprintf(reply + n, (size_t)(SERVE_REPLY - n),
+             "],\"queries\":%lld,\"cache_hits\":%lld,\"mrc_answers\":%lld}", s->queries,
+                 s->cache_hits, s->mrc_answers);
+    pthread_mutex_unlock(&s->cache_lock);
+}
+
+static void handle_query(Server *s, const char *q, char *reply) {
+    pthread_mutex_lock(&s->cache_lock);
+    s->queries++;
+    pthread_mutex_unlock(&s->cache_lock);
+
+    char op[16] = "sim";
+    while (isspace((unsigned char)*q)) q++;
+    if (*q != '{') {
+        error_reply(reply, "not a JSON object");
+        return;
+    }
+    json_string(q, "op", op, sizeof op);
+    if (strcmp(op, "sim") == 0) {
+        query_sim(s, q, reply);
+    } else if (strcmp(op, "mrc") == 0) {
+        query_mrc(s, q, reply);
+    } else if (strcmp(op, "traces") == 0) {
+        query_traces(s, reply);
+    } else if (strcmp(op, "shutdown") == 0) {
+        stop_serving(s);
+        snprintf(reply, SERVE_REPLY, "{\"ok\":true}");
+    } else {
+        error_reply(reply, "unknown op");
+    }
+}
+
+// ---- Connections ----
+
+static int send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t k = send(fd, buf, len, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return -1;
+        buf += k;
+        len -= (size_t)k;
+    }
+    return 0;
+}
+
+// Answers the client's queries, a line each, until it hangs up
+static void serve_client(Server *s, int fd) {
+    char line[SERVE_LINE], reply[SERVE_REPLY + 1];
+    size_t len = 0;
+    for (;;) {
+        char *nl = memchr(line, '\n', len);
+        if (!nl) {
+            if (len == sizeof line) {       // too long: drop it
+                len = 0;
+                error_reply(reply, "query too long");
+                strcat(reply, "\n");
+                if (send_all(fd, reply, strlen(reply)) != 0) break;
+            }
+            ssize_t k = recv(fd, line + len, sizeof line - len, 0);
+            if (k < 0 && errno == EINTR) continue;
+            if (k <= 0) break;
+            len += (size_t)k;
+            continue;
+        }
+        *nl = '\0';
+        handle_query(s, line, reply);
+        strcat(reply, "\n");
+        size_t used = (size_t)(nl + 1 - line);
+        memmove(line, nl + 1, len - used);
+        len -= used;
+        if (send_all(fd, reply, strlen(reply)) != 0) break;
+    }
+}
+
+static void *worker_run(void *arg) {
+    Server *s = (Server *)arg;
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        while (s->qlen == 0 && !s->stop) pthread_cond_wait(&s->ready, &s->lock);
+        if (s->qlen == 0) {
+            pthread_mutex_unlock(&s->lock);
+            break;
+        }
+        int fd = s->queue[s->qhead];
+        s->qhead = (s->qhead + 1) % SERVE_QUEUE;
+        s->qlen--;
+        int slot = 0;
+        while (s->active[slot] >= 0) slot++;
+        s->active[slot] = fd;
+        if (s->stop) shutdown(fd, SHUT_RD);     // queued before the shutdown
+        pthread_mutex_unlock(&s->lock);
+        serve_client(s, fd);
+        pthread_mutex_lock(&s->lock);
+        s->active[slot] = -1;
+        pthread_mutex_unlock(&s->lock);
+        close(fd);
+    }
+    return NULL;
+}
+
+int serve_run(const char *path, const SimConfig *base, char **traces, int ntraces,
+              int collapse, int workers) {
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(sa.sun_path, path);
+
+    Server *s = (Server *)calloc(1, sizeof(Server));
+    pthread_t *tid = (pthread_t *)malloc((size_t)workers * sizeof(pthread_t));
+    if (s) {
+        s->traces = (ServeTrace *)calloc((size_t)ntraces, sizeof(ServeTrace));
+        s->active = (int *)malloc((size_t)workers * sizeof(int));
+    }
+    if (!s || !tid || !s->traces || !s->active) {
+        perror("Error allocating server");
+        if (s) {
+            free(s->traces);
+            free(s->active);
+        }
+        free(s);
+        free(tid);
+        return -1;
+    }
+    s->base = *base;
+    s->lfd = -1;
+    s->workers = workers;
+    for (int i = 0; i < workers; i++) s->active[i] = -1;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_mutex_init(&s->cache_lock, NULL);
+    pthread_cond_init(&s->ready, NULL);
+
+    int rc = 0, loaded = 0;
+    for (; loaded < ntraces && rc == 0; loaded++) {
+        rc = load_trace(&s->traces[loaded], traces[loaded], collapse);
+        if (rc == 0)
+            printf("Loaded %s: %ld records, %lld accesses, %ld pages\n", traces[loaded],
+                   s->traces[loaded].n, s->traces[loaded].accesses,
+                   s->traces[loaded].footprint);
+    }
+    s->ntraces = loaded;
+
+    if (rc == 0) {
+        s->lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (s->lfd < 0) {
+            perror("socket");
+            rc = -1;
+        }
+    }
+    if (rc == 0) {
+        unlink(path);
+        if (bind(s->lfd, (struct sockaddr *)&sa, sizeof(sa)) != 0 || listen(s->lfd, 16) != 0) {
+            perror(path);
+            rc = -1;
+        }
+    }
+
+    int started = 0;
+    for (; rc == 0 && started < workers; started++)
+        if (pthread_create(&tid[started], NULL, worker_run, s) != 0) break;
+    if (rc == 0 && started == 0) rc = -1;
+    if (rc == 0) {
+        printf("Serving %d trace%s on %s with %d workers\n", s->ntraces,
+               s->ntraces == 1 ? "" : "s", path, started);
+        fflush(stdout);
+    }
+
+    while (rc == 0) {
+        int fd = accept(s->lfd, NULL, NULL);
+        pthread_mutex_lock(&s->lock);
+        int stop = s->stop;
+        pthread_mutex_unlock(&s->lock);
+        if (stop) {
+            if (fd >= 0) close(fd);
+            break;
+        }
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            rc = -1;
+            break;
+        }
+        pthread_mutex_lock(&s->lock);
+        if (s->qlen == SERVE_QUEUE) {
+            pthread_mutex_unlock(&s->lock);
+            close(fd);                      // every worker busy: turn it away
+            continue;
+        }
+        s->queue[(s->qhead + s->qlen) % SERVE_QUEUE] = fd;
+        s->qlen++;
+        pthread_cond_signal(&s->ready);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    // Workers answer what their clients and the queued ones already sent
+    stop_serving(s);
+    for (int i = 0; i < started; i++) pthread_join(tid[i], NULL);
+    if (s->lfd >= 0) {
+        close(s->lfd);
+        unlink(path);
+    }
+    if (started > 0)
+        printf("Served %lld queries (%lld from the cache, %lld from curves)\n", s->queries,
+               s->cache_hits, s->mrc_answers);
+
+    for (int i = 0; i < SERVE_CACHE; i++) {
+        free(s->cache[i].key);
+        free(s->cache[i].reply);
+    }
+    for (int i = 0; i < ntraces; i++) {
+        free(s->traces[i].rec);
+        free(s->traces[i].mrc);
+        if (i < loaded) pthread_mutex_destroy(&s->traces[i].lock);
+    }
+    pthread_mutex_destroy(&s->lock);
+    pthread_mutex_destroy(&s->cache_lock);
+    pthread_cond_destroy(&s->ready);
+    free(s->traces);
+    free(s->active);
+    free(s);
+    free(tid);
+    return rc;
+}
@@ -0,0 +1,30 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include "sim.h"
+
+// What-if daemon (-serve <socket> trace...): decodes the traces into memory
+// once, then answers queries over a Unix socket until told to shut down.
+// A query is one line of JSON and gets one line back:
+//
+//   {"op":"sim","trace":"a.trace","policy":"lru","frames":1000,"tlb":64,
+//    "pt":"flat","write":"wt","swapcache":0,"latency":{"mem":100,"disk":1e7}}
+//   {"op":"mrc","trace":"a.trace","sizes":[100,1000,10000]}
+//   {"op":"traces"}   {"op":"shutdown"}
+//
+// Fields left out keep the values from the command line. A query may name
+// a plugin policy only if it is the one given with -a. Connections are
+// served by a pool of worker threads. Each trace's LRU miss ratio curve
+// is computed on first use and answers LRU queries it covers (no TLB or
+// swap cache, write-through) without a simulation. Other replies are kept
+// in a cache keyed by the whole configuration. A shutdown answers what
+// every open connection has already sent, then closes them all.
+
+#define SERVE_WORKERS 4
+#define SERVE_CACHE   1024      // replies kept
+#define SERVE_LINE    4096      // longest query
+
+int serve_run(const char *path, const SimConfig *base, char **traces, int ntraces,
+              int collapse, int workers);
+
+#endif
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ship.h"
+
+#define SHIP_ENTRIES    (1 << SHIP_SIG_BITS)
+#define SHIP_CTR_INIT   1       // weakly reused: pages start out as in SRRIP
+
+int ship_init(Ship *s, int num_frames) {
+    Ship zero = {0};
+    *s = zero;
+    s->shct = (unsigned char *)malloc(SHIP_ENTRIES);
+    s->sig = (unsigned short *)calloc((size_t)num_frames, sizeof(unsigned short));
+    s->flags = (unsigned char *)calloc((size_t)num_frames, 1);
+    if (!s->shct || !s->sig || !s->flags) {
+        ship_free(s);
+        return -1;
+    }
+    memset(s->shct, SHIP_CTR_INIT, SHIP_ENTRIES);
+    return 0;
+}
+
+void ship_free(Ship *s) {
+    free(s->shct);
+    free(s->sig);
+    free(s->flags);
+
+    Ship zero = {0};
+    *s = zero;
+}
+
+static unsigned short signature(unsigned long pc) {
+    return (unsigned short)((pc * 0x9e3779b97f4a7c15UL) >> (64 - SHIP_SIG_BITS));
+}
+
+int ship_insert(Ship *s, int f, unsigned long pc) {
+    unsigned short sig = signature(pc);
+    int dead = s->shct[sig] == 0;
+    s->sig[f] = sig;
+    s->flags[f] = dead ? SHIP_DEAD : 0;
+    s->inserts++;
+    s->predicted_dead += dead;
+    return dead;
+}
+
+void ship_evict(Ship *s, int f) {
+    if (s->flags[f] & SHIP_REUSED) return;
+    if (s->shct[s->sig[f]] > 0) s->shct[s->sig[f]]--;
+    if (s->flags[f] & SHIP_DEAD) s->dead_correct++;
+    else s->missed_dead++;
+    s->flags[f] = SHIP_REUSED;      // nothing left to learn from this frame
+}
+
+void ship_print_stats(const Ship *s) {
+    int zero = 0, full = 0;
+    for (int i = 0; i < SHIP_ENTRIES; i++) {
+        zero += s->shct[i] == 0;
+        full += s->shct[i] == SHIP_CTR_MAX;
+    }
+    long long dead_total = s->dead_correct + s->missed_dead;
+
+    printf("\n--- SHiP ---\n");
+    printf("Signature table: %d 3-bit counters, %d predicting dead, %d saturated\n",
+           SHIP_ENTRIES, zero, full);
+    printf("Insertions: %lld, %lld predicted dead on arrival (%.1f%%)\n", s->inserts,
+           s->predicted_dead,
+           s->inserts > 0 ? 100.0 * (double)s->predicted_dead / (double)s->inserts : 0.0);
+    printf("Dead-on-arrival predictions: %lld right, %lld wrong (page was reused)\n",
+           s->dead_correct, s->dead_reused);
+    printf("Pages evicted without reuse: %lld, %.1f%% of them predicted\n", dead_total,
+           dead_total > 0 ? 100.0 * (double)s->dead_correct / (double)dead_total : 0.0);
+}
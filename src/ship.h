@@ -0,0 +1,49 @@
+#ifndef SHIP_H
+#define SHIP_H
+
+// Signature-based hit prediction (SHiP, Wu et al.) on top of SRRIP. Each
+// frame remembers the signature (a hash of the PC) of the instruction that
+// faulted its page in, and whether the page has been re-referenced since.
+// A table of 3-bit saturating counters, one per signature, counts up when
+// a page is re-referenced and down when one is evicted untouched. A new
+// page whose signature's counter is 0 is predicted dead on arrival and is
+// inserted at the distant RRPV, to be the next to go; others are inserted
+// as in SRRIP.
+
+#define SHIP_SIG_BITS   14
+#define SHIP_CTR_MAX    7
+
+typedef struct {
+    unsigned char *shct;        // counter per signature
+    unsigned short *sig;        // per frame: signature of the inserting PC
+    unsigned char *flags;       // per frame: SHIP_REUSED, SHIP_DEAD
+
+    long long inserts, predicted_dead;
+    long long dead_correct;     // predicted dead, evicted without reuse
+    long long dead_reused;      // predicted dead, but touched again
+    long long missed_dead;      // predicted reuse, evicted without it
+} Ship;
+
+#define SHIP_REUSED 1u
+#define SHIP_DEAD   2u
+
+int  ship_init(Ship *s, int num_frames);
+void ship_free(Ship *s);
+
+// A page loaded by instruction pc goes into frame f. Returns 1 if it is
+// predicted dead on arrival.
+int  ship_insert(Ship *s, int f, unsigned long pc);
+
+static inline void ship_hit(Ship *s, int f) {
+    if (s->flags[f] & SHIP_REUSED) return;
+    s->flags[f] |= SHIP_REUSED;
+    if (s->flags[f] & SHIP_DEAD) s->dead_reused++;
+    if (s->shct[s->sig[f]] < SHIP_CTR_MAX) s->shct[s->sig[f]]++;
+}
+
+// The page in frame f is evicted
+void ship_evict(Ship *s, int f);
+
+void ship_print_stats(const Ship *s);
+
+#endif
@@ -0,0 +1,882 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+void sim_config_defaults(SimConfig *cfg) {
+    cfg->alg = ALG_FIFO;
+    cfg->write_policy = WP_WRITE_THROUGH;
+    cfg->pt_mode = PT_FLAT;
+    cfg->num_frames = DEFAULT_NUM_FRAMES;
+    cfg->tlb_size = 0;
+    cfg->compact = 0;
+    cfg->quiet = 0;
+    cfg->swap_cache = 0;
+    cfg->rrpv_bits = 2;
+    cfg->tlb_lat   = 1.0;
+    cfg->mem_lat   = 100.0;
+    cfg->zero_lat  = 2000.0;
+    cfg->minor_lat = 500.0;
+    cfg->disk_lat  = 10000000.0;
+}
+
+int sim_config_algorithm(SimConfig *cfg, const char *name) {
+    if      (strcmp(name, "fifo")  == 0) cfg->alg = ALG_FIFO;
+    else if (strcmp(name, "lru")   == 0) cfg->alg = ALG_LRU;
+    else if (strcmp(name, "clock") == 0) cfg->alg = ALG_CLOCK;
+    else if (strcmp(name, "srrip") == 0) cfg->alg = ALG_SRRIP;
+    else if (strcmp(name, "brrip") == 0) cfg->alg = ALG_BRRIP;
+    else if (strcmp(name, "drrip") == 0) cfg->alg = ALG_DRRIP;
+    else if (strcmp(name, "ship")  == 0) cfg->alg = ALG_SHIP;
+    else if (strncmp(name, "plugin:", 7) == 0 && name[7]) {
+        cfg->alg = ALG_PLUGIN;
+        cfg->plugin = name + 7;
+    }
+    else return -1;
+    return 0;
+}
+
+int sim_init(Simulator *sim, const SimConfig *cfg) {
+    Simulator zero = {0};
+    *sim = zero;
+    sim->cfg = *cfg;
+
+    // The compact frame table carries its own vpn -> frame directory
+    if (sim->cfg.compact) sim->cfg.pt_mode = PT_COMPACT;
+
+    if (ft_init(&sim->ft, cfg->num_frames, cfg->compact, cfg->alg == ALG_LRU) != 0) {
+        perror("Error allocating frame metadata");
+        return -1;
+    }
+
+    if (sim->cfg.pt_mode == PT_INVERTED && ipt_init(&sim->ipt, cfg->num_frames) != 0) {
+        perror("Error allocating inverted page table");
+        sim_free(sim);
+        return -1;
+    }
+
+    if (sim->cfg.pt_mode == PT_CUCKOO &&
+        cuckoo_init(&sim->dir, (size_t)cfg->num_frames) != 0) {
+        perror("Error allocating frame directory");
+        sim_free(sim);
+        return -1;
+    }
+
+    if (cfg->tlb_size > 0 && tlb_init(&sim->tlb, cfg->tlb_size) != 0) {
+        perror("Error allocating TLB");
+        sim_free(sim);
+        return -1;
+    }
+
+    RripMode mode = cfg->alg == ALG_SHIP ? RRIP_SRRIP : (RripMode)(cfg->alg - ALG_SRRIP);
+    if (alg_is_rrip(cfg->alg) &&
+        rrip_init(&sim->rrip, mode, cfg->rrpv_bits, cfg->num_frames) != 0) {
+        perror("Error allocating RRPVs");
+        sim_free(sim);
+        return -1;
+    }
+    if (cfg->alg == ALG_SHIP && ship_init(&sim->ship, cfg->num_frames) != 0) {
+        perror("Error allocating SHiP predictor");
+        sim_free(sim);
+        return -1;
+    }
+
+    if (cfg->alg == ALG_PLUGIN) {
+        sim->plugin = (Plugin *)malloc(sizeof(Plugin));
+        if (!sim->plugin) {
+            perror("Error allocating policy plugin");
+            sim_free(sim);
+            return -1;
+        }
+        if (plugin_load(sim->plugin, cfg->plugin, cfg->num_frames) != 0) {
+            free(sim->plugin);
+            sim->plugin = NULL;
+            sim_free(sim);
+            return -1;
+        }
+    }
+
+    // Grows with the footprint; sizing it by the frames would cost more
+    // than a compact frame table for large memories
+    if (cuckoo_init(&sim->seen, 1024) != 0) {
+        perror("Error allocating page history");
+        sim_free(sim);
+        return -1;
+    }
+
+    if (cfg->swap_cache > 0) {
+        sim->sc_ring = (unsigned long *)malloc((size_t)cfg->swap_cache *
+                                               sizeof(unsigned long));
+        sim->sc_ra = (unsigned char *)calloc((size_t)cfg->swap_cache, 1);
+        if (!sim->sc_ring || !sim->sc_ra ||
+            cuckoo_init(&sim->sc_index, (size_t)cfg->swap_cache) != 0) {
+            perror("Error allocating swap cache");
+            sim_free(sim);
+            return -1;
+        }
+        for (int i = 0; i < cfg->swap_cache; i++) sim->sc_ring[i] = CUCKOO_EMPTY_KEY;
+    }
+    return 0;
+}
+
+void sim_free(Simulator *sim) {
+    ft_free(&sim->ft);
+    ipt_free(&sim->ipt);
+    cuckoo_free(&sim->dir);
+    tlb_free(&sim->tlb);
+    rrip_free(&sim->rrip);
+    ship_free(&sim->ship);
+    if (sim->pcprof) {
+        pcprof_free(sim->pcprof);
+        free(sim->pcprof);
+        sim->pcprof = NULL;
+    }
+    cuckoo_free(&sim->seen);
+    cuckoo_free(&sim->sc_index);
+    free(sim->sc_ring);
+    free(sim->sc_ra);
+    sim->sc_ring = NULL;
+    sim->sc_ra = NULL;
+    if (sim->swap) {
+        swap_free(sim->swap);
+        free(sim->swap);
+        sim->swap = NULL;
+    }
+    if (sim->ksm) {
+        ksm_free(sim->ksm);
+        free(sim->ksm);
+        sim->ksm = NULL;
+    }
+    if (sim->damon) {
+        damon_free(sim->damon);
+        free(sim->damon);
+        sim->damon = NULL;
+    }
+    if (sim->reclaim) {
+        reclaim_free(sim->reclaim);
+        free(sim->reclaim);
+        sim->reclaim = NULL;
+    }
+    if (sim->plugin) {
+        plugin_free(sim->plugin);
+        free(sim->plugin);
+        sim->plugin = NULL;
+    }
+    if (sim->wb) {
+        writeback_free(sim->wb);
+        free(sim->wb);
+        sim->wb = NULL;
+    }
+    free(sim->free_frames);
+    sim->free_frames = NULL;
+}
+
+// Frames handed back outside of replacement go on a free list
+static int need_free_list(Simulator *sim) {
+    if (!sim->free_frames) {
+        sim->free_frames = (int *)malloc((size_t)sim->cfg.num_frames * sizeof(int));
+    }
+    return sim->free_frames ? 0 : -1;
+}
+
+int sim_enable_ksm(Simulator *sim, const KsmConfig *kc) {
+    sim->ksm = (Ksm *)malloc(sizeof(Ksm));
+    if (!sim->ksm || need_free_list(sim) != 0 || ksm_init(sim->ksm, kc) != 0) {
+        perror("Error allocating same-page merging state");
+        free(sim->ksm);
+        sim->ksm = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int sim_enable_damon(Simulator *sim, const DamonConfig *dc) {
+    sim->damon = (Damon *)malloc(sizeof(Damon));
+    if (!sim->damon || need_free_list(sim) != 0 ||
+        damon_init(sim->damon, dc, sim->cfg.num_frames) != 0) {
+        perror("Error allocating access monitor");
+        free(sim->damon);
+        sim->damon = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int sim_enable_reclaim(Simulator *sim, const ReclaimConfig *rc) {
+    sim->reclaim = (Reclaim *)malloc(sizeof(Reclaim));
+    if (!sim->reclaim || need_free_list(sim) != 0 || reclaim_init(sim->reclaim, rc) != 0) {
+        perror("Error allocating reclaim controller");
+        free(sim->reclaim);
+        sim->reclaim = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int sim_enable_writeback(Simulator *sim, const WritebackConfig *wc) {
+    sim->wb = (Writeback *)malloc(sizeof(Writeback));
+    if (!sim->wb || writeback_init(sim->wb, wc, sim->cfg.num_frames) != 0) {
+        perror("Error allocating writeback state");
+        free(sim->wb);
+        sim->wb = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int sim_enable_swap(Simulator *sim, const SwapConfig *sc) {
+    sim->swap = (Swap *)malloc(sizeof(Swap));
+    if (!sim->swap || swap_init(sim->swap, sc) != 0) {
+        perror("Error allocating swap space");
+        free(sim->swap);
+        sim->swap = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int sim_enable_ssd(Simulator *sim, const SsdConfig *sc) {
+    if (swap_attach_ssd(sim->swap, sc) != 0) {
+        perror("Error allocating SSD model");
+        return -1;
+    }
+    return 0;
+}
+
+int sim_enable_far(Simulator *sim, const FarConfig *fc) {
+    // Connection errors are reported by the backend
+    return swap_attach_far(sim->swap, fc);
+}
+
+void sim_page_content(Simulator *sim, unsigned long addr, unsigned long long content) {
+    if (sim->ksm) ksm_set_content(sim, sim_page_key(sim, addr), content);
+}
+
+void sim_print_frames(const Simulator *sim) {
+    const FrameTable *ft = &sim->ft;
+    printf("Frames: [");
+    for (int i = 0; i < ft->num_frames; i++) {
+        long vpn = ft_vpn(ft, i);
+        if (vpn == FRAME_EMPTY) printf(" -");
+        else printf(" %ld", vpn);
+    }
+    printf(" ]\n");
+}
+
+static int find_frame(Simulator *sim, unsigned long vpn) {
+    switch (sim->cfg.pt_mode) {
+    case PT_INVERTED: return ipt_lookup(&sim->ipt, &sim->ft, vpn);
+    case PT_CUCKOO:   return cuckoo_find(&sim->dir, vpn);
+    case PT_COMPACT:  return ft_find(&sim->ft, vpn);
+    default:
+        for (int i = 0; i < sim->cfg.num_frames; i++) {
+            if (sim->ft.vpn[i] == (long)vpn) return i;
+        }
+        return -1;
+    }
+}
+
+// Dirty bits change here so writeback can keep count of dirty pages
+static void set_dirty(Simulator *sim, int f, int dirty) {
+    int was = ft_dirty(&sim->ft, f) != 0;
+    ft_set_dirty(&sim->ft, f, dirty);
+    if (!sim->wb || was == dirty) return;
+    if (dirty) writeback_dirtied(sim, f);
+    else writeback_cleaned(sim->wb);
+}
+
+// Queues an event for a policy plugin
+static inline void policy_event(Simulator *sim, int type, char op, int f,
+                                unsigned long key, unsigned long count) {
+    if (sim->plugin) plugin_event(sim->plugin, type, op, f, key, sim->tick, count);
+}
+
+// Replacement state that only re-references update; `count` accesses
+static void hit_frame(Simulator *sim, int f, unsigned long key, char op,
+                      unsigned long count) {
+    policy_event(sim, POLICY_HIT, op, f, key, count);
+    if (alg_is_rrip(sim->cfg.alg)) rrip_hit(&sim->rrip, f, key);
+    if (sim->cfg.alg == ALG_SHIP) ship_hit(&sim->ship, f);
+}
+
+// Policy bookkeeping shared by TLB hits, frame hits and newly loaded pages
+static void touch_frame(Simulator *sim, int f, char op) {
+    if (sim->reclaim) {
+        // Idle time for the controller; last use is kept for every policy.
+        // A page just loaded for the first time has no idle time.
+        unsigned long idle = sim->tick - ft_last_used(&sim->ft, f);
+        if (idle > 0) reclaim_access(sim->reclaim, idle);
+        ft_set_last_used(&sim->ft, f, sim->tick);
+    }
+    if (sim->cfg.alg == ALG_LRU) {
+        ft_set_last_used(&sim->ft, f, sim->tick);
+    }
+    if (sim->cfg.alg == ALG_CLOCK) {
+        ft_set_ref(&sim->ft, f, 1);
+    }
+    if (op == 'W' && sim->cfg.write_policy == WP_WRITE_BACK) {
+        set_dirty(sim, f, 1);
+    }
+    if (op == 'W' && sim->swap) {
+        swap_dirty(sim->swap, (unsigned long)ft_vpn(&sim->ft, f));
+    }
+    if (sim->damon) damon_access(sim->damon, f, (unsigned long)ft_vpn(&sim->ft, f));
+}
+
+int sim_frame_of(const Simulator *sim, unsigned long key) {
+    return find_frame((Simulator *)sim, key);
+}
+
+void sim_map_frame(Simulator *sim, int f, unsigned long key) {
+    ft_set_vpn(&sim->ft, f, (long)key);
+    policy_event(sim, POLICY_FAULT, 'R', f, key, 0);
+    if (sim->cfg.pt_mode == PT_INVERTED) {
+        ipt_map(&sim->ipt, f, key);
+    } else if (sim->cfg.pt_mode == PT_CUCKOO) {
+        cuckoo_insert(&sim->dir, key, f);
+    }
+}
+
+void sim_unmap_frame(Simulator *sim, int f) {
+    long key = ft_vpn(&sim->ft, f);
+    if (key == FRAME_EMPTY) return;
+    policy_event(sim, POLICY_EVICT, 0, f, (unsigned long)key, 0);
+    if (sim->cfg.alg == ALG_SHIP) ship_evict(&sim->ship, f);
+    if (sim->cfg.tlb_size > 0) {
+        tlb_invalidate_vpn(&sim->tlb, (unsigned long)key);
+    }
+    if (sim->cfg.pt_mode == PT_INVERTED) {
+        ipt_unmap(&sim->ipt, &sim->ft, f);
+    } else if (sim->cfg.pt_mode == PT_CUCKOO) {
+        cuckoo_erase(&sim->dir, (unsigned long)key);
+    }
+    ft_set_vpn(&sim->ft, f, FRAME_EMPTY);
+}
+
+void sim_release_frame(Simulator *sim, int f) {
+    sim_unmap_frame(sim, f);
+    ft_set_ref(&sim->ft, f, 0);
+    set_dirty(sim, f, 0);
+    sim->free_frames[sim->nfree++] = f;
+}
+
+static int choose_victim(Simulator *sim) {
+    FrameTable *ft = &sim->ft;
+    int n = sim->cfg.num_frames;
+
+    // If there is an empty frame, use it first
+    if (sim->nfree > 0) return sim->free_frames[--sim->nfree];
+    if (sim->frames_used < n) return sim->frames_used++;
+
+    int victim = 0;
+    if (sim->cfg.alg == ALG_FIFO) {
+        victim = sim->fifo_index;
+        sim->fifo_index = (sim->fifo_index + 1) % n;
+
+    } else if (sim->cfg.alg == ALG_LRU) {
+        unsigned long oldest = ft_last_used(ft, 0);
+        for (int i = 1; i < n; i++) {
+            unsigned long t = ft_last_used(ft, i);
+            if (t < oldest) {
+                victim = i;
+                oldest = t;
+            }
+        }
+
+    } else if (sim->cfg.alg == ALG_CLOCK) {
+        while (1) {
+            if (!ft_ref(ft, sim->clock_hand)) {
+                victim = sim->clock_hand;
+                sim->clock_hand = (sim->clock_hand + 1) % n;
+                break;
+            }
+            ft_set_ref(ft, sim->clock_hand, 0);
+            sim->clock_hand = (sim->clock_hand + 1) % n;
+        }
+
+    } else if (alg_is_rrip(sim->cfg.alg)) {
+        victim = rrip_choose_victim(&sim->rrip);
+
+    } else if (sim->cfg.alg == ALG_PLUGIN) {
+        victim = plugin_choose_victim(sim->plugin, sim->tick, n);
+    }
+    return victim;
+}
+
+int sim_in_swap_cache(const Simulator *sim, unsigned long key) {
+    return sim->sc_ring && cuckoo_find(&sim->sc_index, key) >= 0;
+}
+
+// Remembers an evicted or read-ahead page, pushing out the oldest when full
+void sim_swap_cache_add(Simulator *sim, unsigned long key, int readahead) {
+    if (!sim->sc_ring) return;
+    unsigned long *slot = &sim->sc_ring[sim->sc_head];
+    if (*slot != CUCKOO_EMPTY_KEY) cuckoo_erase(&sim->sc_index, *slot);
+    *slot = key;
+    sim->sc_ra[sim->sc_head] = (unsigned char)readahead;
+    cuckoo_insert(&sim->sc_index, key, sim->sc_head);
+    sim->sc_head = (sim->sc_head + 1) % sim->cfg.swap_cache;
+}
+
+// Classifies a fault on vpn before the page is brought in
+static AccessResult classify_fault(Simulator *sim, unsigned long vpn) {
+    if (sim->sc_ring) {
+        int slot = cuckoo_find(&sim->sc_index, vpn);
+        if (slot >= 0) {
+            if (sim->swap && sim->sc_ra[slot]) sim->swap->ra_hits++;
+            sim->sc_ring[slot] = CUCKOO_EMPTY_KEY;
+            cuckoo_erase(&sim->sc_index, vpn);
+            return ACC_MINOR_FAULT;
+        }
+    }
+    if (cuckoo_find(&sim->seen, vpn) < 0) {
+        cuckoo_insert(&sim->seen, vpn, 0);
+        if (sim->damon) damon_new_page(sim->damon, vpn);
+        return ACC_ZERO_FAULT;
+    }
+    return ACC_FAULT;
+}
+
+// Evicts whatever frame f holds: TLB, page table, write-back and swap-out.
+// The frame table entry itself is left for the caller to overwrite.
+static void evict(Simulator *sim, int f) {
+    long old_vpn = ft_vpn(&sim->ft, f);
+    if (old_vpn == FRAME_EMPTY) return;
+
+    if (sim->ksm) ksm_evicted(sim, (unsigned long)old_vpn);
+    policy_event(sim, POLICY_EVICT, 0, f, (unsigned long)old_vpn, 0);
+    if (sim->cfg.alg == ALG_SHIP) ship_evict(&sim->ship, f);
+    if (sim->cfg.tlb_size > 0) {
+        tlb_invalidate_vpn(&sim->tlb, (unsigned long)old_vpn);
+    }
+    if (sim->cfg.pt_mode == PT_INVERTED) {
+        ipt_unmap(&sim->ipt, &sim->ft, f);
+    } else if (sim->cfg.pt_mode == PT_CUCKOO) {
+        cuckoo_erase(&sim->dir, (unsigned long)old_vpn);
+    }
+    int dirty = sim->cfg.write_policy == WP_WRITE_BACK && ft_dirty(&sim->ft, f);
+    if (dirty) {
+        sim->stats.write_backs++;
+        set_dirty(sim, f, 0);
+    }
+    if (sim->wb) writeback_evict(sim, dirty);
+    if (sim->swap) swap_out(sim, (unsigned long)old_vpn);
+    if (!sim->ksm || !ksm_is_stable_key((unsigned long)old_vpn))
+        sim_swap_cache_add(sim, (unsigned long)old_vpn, 0);
+}
+
+void sim_reclaim_frame(Simulator *sim, int f) {
+    evict(sim, f);
+    ft_set_vpn(&sim->ft, f, FRAME_EMPTY);
+    ft_set_ref(&sim->ft, f, 0);
+    sim->free_frames[sim->nfree++] = f;
+    sim->stats.reclaimed++;
+}
+
+// Loads vpn into a frame, evicting if needed. Returns the frame.
+static int handle_fault(Simulator *sim, unsigned long vpn, char op, AccessResult kind) {
+    int victim = choose_victim(sim);
+
+    evict(sim, victim);
+
+    // Reclaim first, then read the page back in
+    if (sim->ksm) ksm_fault(sim, vpn, kind == ACC_FAULT);
+    else if (kind == ACC_FAULT && sim->swap) swap_in(sim, vpn);
+
+    ft_set_vpn(&sim->ft, victim, (long)vpn);
+    if (sim->cfg.pt_mode == PT_INVERTED) {
+        ipt_map(&sim->ipt, victim, vpn);
+    } else if (sim->cfg.pt_mode == PT_CUCKOO) {
+        cuckoo_insert(&sim->dir, vpn, victim);
+    }
+
+    // A refault reports how long the page was idle; anything else counts
+    // as a first touch
+    if (sim->reclaim) {
+        ft_set_last_used(&sim->ft, victim,
+                         sim->tick - reclaim_fault(sim->reclaim, vpn, sim->tick));
+    }
+    policy_event(sim, POLICY_FAULT, op, victim, vpn, 1);
+    touch_frame(sim, victim, op);
+    if (alg_is_rrip(sim->cfg.alg)) {
+        rrip_insert(&sim->rrip, victim, vpn);
+        if (sim->cfg.alg == ALG_SHIP && ship_insert(&sim->ship, victim, sim->pc)) {
+            rrip_demote(&sim->rrip, victim);
+        }
+    }
+    return victim;
+}
+
+// Moves the clock past one access. A major fault waits for its read, or
+// takes disk_lat when the device is not modelled.
+static void advance_clock(Simulator *sim, AccessResult result) {
+    const SimConfig *cfg = &sim->cfg;
+    switch (result) {
+    case ACC_TLB_HIT:     sim->now += cfg->tlb_lat; break;
+    case ACC_HIT:         sim->now += cfg->mem_lat; break;
+    case ACC_ZERO_FAULT:  sim->now += cfg->zero_lat; break;
+    case ACC_MINOR_FAULT: sim->now += cfg->minor_lat; break;
+    case ACC_FAULT:
+        if (!sim_has_device(sim)) {
+            sim->now += cfg->disk_lat;
+        } else if (sim->fault_done > sim->now) {
+            sim->stats.major_wait += sim->fault_done - sim->now;
+            sim->now = sim->fault_done;
+        }
+        break;
+    }
+}
+
+// Charges `accesses` accesses, the first with the given result, to the
+// instruction that made them
+static int count_pc(Simulator *sim, AccessResult result, unsigned long accesses) {
+    if (!sim->pcprof) {
+        sim->pcprof = (PcProfile *)malloc(sizeof(PcProfile));
+        if (!sim->pcprof || pcprof_init(sim->pcprof) != 0) {
+            perror("Error allocating fault attribution");
+            free(sim->pcprof);
+            sim->pcprof = NULL;
+            return -1;
+        }
+    }
+    if (pcprof_count(sim->pcprof, sim->pc, accesses, result >= ACC_FAULT,
+                     result == ACC_FAULT) != 0) {
+        perror("Error growing fault attribution");
+        return -1;
+    }
+    return 0;
+}
+
+// Bookkeeping shared by both exits of sim_access
+static int finish_access(Simulator *sim, AccessResult result) {
+    if (sim_clocked(sim)) advance_clock(sim, result);
+    if (sim->pc && count_pc(sim, result, 1) != 0) return -1;
+    return result;
+}
+
+int sim_access(Simulator *sim, char op, unsigned long addr) {
+    SimStats *st = &sim->stats;
+    int quiet = sim->cfg.quiet;
+
+    sim->tick++;
+    if (sim->ksm) ksm_tick(sim);
+    if (sim->damon) damon_tick(sim);
+    if (sim->reclaim) reclaim_tick(sim);
+    if (sim->wb) writeback_tick(sim);
+
+    unsigned long vpn = sim_page_key(sim, addr);
+    if (sim->cfg.compact && vpn > FT_COMPACT_MAX_VPN) {
+        fprintf(stderr, "Address 0x%lx is beyond the compact mode range\n", addr);
+        return -1;
+    }
+
+    if (op == 'R') st->reads++;
+    else st->writes++;
+
+    // 1) TLB lookup (if enabled)
+    if (sim->cfg.tlb_size > 0) {
+        int frame_index_from_tlb = -1;
+        int hit = tlb_lookup(&sim->tlb, vpn, &frame_index_from_tlb);
+        if (hit && sim->ksm && op == 'W' &&
+            (frame_index_from_tlb < 0 ||
+             ft_vpn(&sim->ft, frame_index_from_tlb) != (long)vpn)) {
+            // Merged pages are mapped read-only: the write must fault
+            tlb_invalidate_vpn(&sim->tlb, vpn);
+            hit = 0;
+        }
+        if (hit) {
+            st->tlb_hits++;
+            if (!quiet) {
+                printf("Operation: %c | Address: 0x%lx | VPN: %lu -> TLB HIT (frame %d)\n",
+                       op, addr, vpn, frame_index_from_tlb);
+            }
+
+            if (frame_index_from_tlb >= 0 && frame_index_from_tlb < sim->cfg.num_frames) {
+                hit_frame(sim, frame_index_from_tlb, vpn, op, 1);
+                touch_frame(sim, frame_index_from_tlb, op);
+            }
+
+            if (!quiet) sim_print_frames(sim);
+            return finish_access(sim, ACC_TLB_HIT);
+        }
+        st->tlb_misses++;
+        if (!quiet) printf(" -> TLB MISS\n");
+    }
+
+    // 2) Check frames for HIT/MISS
+    AccessResult result;
+    int frame = find_frame(sim, vpn);
+    int shared = (frame == -1 && sim->ksm) ? ksm_lookup(sim, vpn) : -1;
+    if (frame != -1) {
+        if (!quiet) {
+            printf("Operation: %c | Address: 0x%lx | VPN: %lu -> HIT\n",
+                   op, addr, vpn);
+        }
+        hit_frame(sim, frame, vpn, op, 1);
+        touch_frame(sim, frame, op);
+        result = ACC_HIT;
+    } else if (shared != -1 && op == 'R') {
+        if (!quiet) {
+            printf("Operation: %c | Address: 0x%lx | VPN: %lu -> HIT (merged)\n",
+                   op, addr, vpn);
+        }
+        if (shared >= 0) {
+            hit_frame(sim, shared, vpn, op, 1);
+            touch_frame(sim, shared, op);
+        }
+        frame = shared;
+        result = ACC_HIT;
+    } else if (shared != -1) {
+        if (!quiet) {
+            printf("Operation: %c | Address: 0x%lx | VPN: %lu -> COW BREAK\n",
+                   op, addr, vpn);
+        }
+        // The write copies the shared page into a frame of its own: a minor
+        // fault, since nothing is read from disk
+        ksm_cow_break(sim, vpn);
+        result = ACC_MINOR_FAULT;
+        st->page_faults++;
+        st->minor_faults++;
+        frame = handle_fault(sim, vpn, op, result);
+    } else {
+        result = classify_fault(sim, vpn);
+        if (!quiet) {
+            printf("Operation: %c | Address: 0x%lx | VPN: %lu -> %s\n", op, addr, vpn,
+                   result == ACC_ZERO_FAULT  ? "PAGE FAULT (demand-zero)" :
+                   result == ACC_MINOR_FAULT ? "PAGE FAULT (minor)" : "PAGE FAULT");
+        }
+        st->page_faults++;
+        if (result == ACC_ZERO_FAULT) st->zero_faults++;
+        else if (result == ACC_MINOR_FAULT) st->minor_faults++;
+        else st->major_faults++;
+        if (sim->damon && result != ACC_ZERO_FAULT) damon_fault(sim->damon, vpn);
+        frame = handle_fault(sim, vpn, op, result);
+    }
+
+    if (sim->ksm && op == 'W') ksm_note_write(sim, vpn);
+
+    // Put it in TLB (common behavior)
+    if (sim->cfg.tlb_size > 0) {
+        tlb_insert(&sim->tlb, vpn, frame);
+    }
+
+    if (!quiet) sim_print_frames(sim);
+    return finish_access(sim, result);
+}
+
+int sim_access_run(Simulator *sim, char op, unsigned long addr,
+                   unsigned long count, unsigned long writes) {
+    if (count == 0) return ACC_HIT;
+
+    int result = sim_access(sim, op, addr);
+    if (result < 0 || count == 1) return result;
+
+    // A write can break a merged page in mid-run, and the monitor, the
+    // reclaim controller, the flusher and DRRIP's set dueling all act on
+    // every access, so step through the run; the writes go first since
+    // their order within the run is unknown.
+    if (sim->ksm || sim->damon || sim->reclaim || sim->wb || sim->cfg.alg == ALG_DRRIP) {
+        unsigned long w = writes - (op == 'W' ? 1 : 0);
+        for (unsigned long i = 1; i < count; i++) {
+            if (sim_access(sim, w > 0 ? 'W' : 'R', addr) < 0) return -1;
+            if (w > 0) w--;
+        }
+        return result;
+    }
+
+    // The page is now resident (and in the TLB, if there is one), so every
+    // remaining access hits. Apply them as one step at the run's last tick.
+    unsigned long rest = count - 1;
+    unsigned long rest_writes = writes - (op == 'W' ? 1 : 0);
+    unsigned long vpn = sim_page_key(sim, addr);
+    int frame = -1;
+
+    sim->tick += rest;
+    if (sim_clocked(sim)) {
+        sim->now += (double)rest * (sim->cfg.tlb_size > 0 ? sim->cfg.tlb_lat
+                                                         : sim->cfg.mem_lat);
+    }
+    sim->stats.writes += (long long)rest_writes;
+    sim->stats.reads  += (long long)(rest - rest_writes);
+
+    if (sim->cfg.tlb_size > 0) {
+        tlb_lookup(&sim->tlb, vpn, &frame);
+        sim->stats.tlb_hits += (long long)rest;
+    } else {
+        frame = find_frame(sim, vpn);
+    }
+    hit_frame(sim, frame, vpn, rest_writes > 0 ? 'W' : 'R', rest);
+    if (sim->pc && count_pc(sim, ACC_HIT, rest) != 0) return -1;
+    touch_frame(sim, frame, rest_writes > 0 ? 'W' : 'R');
+
+    if (!sim->cfg.quiet) {
+        printf("Run: %lu more accesses | VPN: %lu -> %s\n", rest, vpn,
+               sim->cfg.tlb_size > 0 ? "TLB HIT" : "HIT");
+        sim_print_frames(sim);
+    }
+    return result;
+}
+
+void sim_mark_dirty(Simulator *sim, unsigned long addr) {
+    if (sim->cfg.write_policy != WP_WRITE_BACK) return;
+    int frame = find_frame(sim, sim_page_key(sim, addr));
+    if (frame >= 0) set_dirty(sim, frame, 1);
+}
+
+int sim_replay_record(Simulator *sim, const TraceRecord *rec) {
+    if (rec->op == 'D') {
+        sim_mark_dirty(sim, rec->addr);
+        return ACC_HIT;
+    }
+    if (rec->op != 'R' && rec->op != 'W') {
+        // ignore unknown ops
+        for (unsigned long n = 0; n < rec->count; n++) sim_skip(sim);
+        return ACC_HIT;
+    }
+    sim->cpu = rec->src;
+    sim->pc = rec->pc;
+    int r = (rec->count == 1)
+                ? sim_access(sim, rec->op, rec->addr)
+                : sim_access_run(sim, rec->op, rec->addr, rec->count, rec->writes);
+    if (r >= 0 && rec->has_content) sim_page_content(sim, rec->addr, rec->content);
+    return r;
+}
+
+const char *sim_alg_name(const Simulator *sim) {
+    switch (sim->cfg.alg) {
+    case ALG_FIFO:   return "FIFO";
+    case ALG_LRU:    return "LRU";
+    case ALG_CLOCK:  return "CLOCK";
+    case ALG_SRRIP:  return "SRRIP";
+    case ALG_BRRIP:  return "BRRIP";
+    case ALG_DRRIP:  return "DRRIP";
+    case ALG_SHIP:   return "SHiP";
+    case ALG_PLUGIN:
+        // The name is optional; the file tells plugins apart just as well
+        return sim->plugin->ops->name ? sim->plugin->ops->name : sim->plugin->path;
+    }
+    return "?";
+}
+
+double sim_fault_time(const Simulator *sim) {
+    const SimConfig *cfg = &sim->cfg;
+    const SimStats *st = &sim->stats;
+    double t = (double)st->zero_faults * cfg->zero_lat +
+               (double)st->minor_faults * cfg->minor_lat;
+    if (sim_has_device(sim)) {
+        t += st->major_wait + st->write_stall;
+    } else {
+        t += (double)st->major_faults * cfg->disk_lat;
+    }
+    if (sim->wb) t += sim->wb->throttle_wait + sim->wb->evict_wait;
+    return t;
+}
+
+double sim_amat(const Simulator *sim) {
+    const SimConfig *cfg = &sim->cfg;
+    const SimStats *st = &sim->stats;
+    long long total_accesses = st->trace_accesses > 0 ? st->trace_accesses
+                                                      : st->reads + st->writes;
+    long long tlb_total = st->tlb_hits + st->tlb_misses;
+    double base = cfg->mem_lat;
+    if (cfg->tlb_size > 0 && tlb_total > 0) {
+        double tlb_hit_rate = (double)st->tlb_hits / (double)tlb_total;
+        base = tlb_hit_rate * cfg->tlb_lat + (1.0 - tlb_hit_rate) * cfg->mem_lat;
+    }
+    return base + (total_accesses > 0 ? sim_fault_time(sim) / (double)total_accesses : 0.0);
+}
+
+void sim_print_stats(const Simulator *sim) {
+    const SimConfig *cfg = &sim->cfg;
+    const SimStats *st = &sim->stats;
+
+    printf("\n--- Stats ---\n");
+    printf("Algorithm: %s\n", sim_alg_name(sim));
+
+    printf("Write policy: %s\n",
+           (cfg->write_policy == WP_WRITE_THROUGH)
+               ? "Write-Through"
+               : "Write-Back");
+
+    if (cfg->pt_mode == PT_INVERTED) {
+        printf("Page table: inverted (%zu bytes)\n", ipt_bytes(&sim->ipt));
+    } else if (cfg->pt_mode == PT_CUCKOO) {
+        printf("Page table: cuckoo (%zu bytes, load %.2f)\n",
+               cuckoo_bytes(&sim->dir), cuckoo_load(&sim->dir));
+    } else if (cfg->pt_mode == PT_COMPACT) {
+        printf("Page table: compact (in frame table)\n");
+    } else {
+        printf("Page table: flat (%zu bytes)\n",
+               (size_t)cfg->num_frames * sizeof(long));
+    }
+    printf("Frame table: %s (%zu bytes, %.2f bytes/frame)\n",
+           cfg->compact ? "compact" : "wide", ft_bytes(&sim->ft),
+           (double)ft_bytes(&sim->ft) / (double)cfg->num_frames);
+    printf("Page history: %zu pages touched (%zu bytes)\n", sim->seen.count,
+           cuckoo_bytes(&sim->seen));
+    size_t pt_bytes = cfg->pt_mode == PT_INVERTED ? ipt_bytes(&sim->ipt)
+                    : cfg->pt_mode == PT_CUCKOO   ? cuckoo_bytes(&sim->dir)
+                    : cfg->pt_mode == PT_COMPACT  ? 0
+                    : (size_t)cfg->num_frames * sizeof(long);
+    size_t mem_bytes = ft_bytes(&sim->ft) + pt_bytes + cuckoo_bytes(&sim->seen);
+    printf("Simulator memory: %zu bytes (%.2f bytes/frame)\n", mem_bytes,
+           (double)mem_bytes / (double)cfg->num_frames);
+
+    printf("Frames: %d\n", cfg->num_frames);
+    printf("Reads: %lld\n", st->reads);
+    printf("Writes: %lld\n", st->writes);
+
+    // A filtered trace is rated against the accesses it was made from
+    long long total_accesses = st->reads + st->writes;
+    if (st->trace_accesses > 0) {
+        printf("Total accesses: %lld simulated, %lld in the trace\n", total_accesses,
+               st->trace_accesses);
+        total_accesses = st->trace_accesses;
+    } else {
+        printf("Total accesses: %lld\n", total_accesses);
+    }
+    printf("Total page faults: %lld\n", st->page_faults);
+    printf("Demand-zero faults: %lld\n", st->zero_faults);
+    printf("Minor faults: %lld (swap cache: %d pages)\n", st->minor_faults,
+           cfg->swap_cache);
+    printf("Major faults: %lld\n", st->major_faults);
+    if (sim_has_device(sim) && st->major_faults > 0) {
+        printf("Major fault wait: %.0f cycles average\n",
+               st->major_wait / (double)st->major_faults);
+        printf("Swap-out stalls: %.0f cycles\n", st->write_stall);
+    }
+    if (sim_clocked(sim)) printf("Simulated time: %.0f cycles\n", sim->now);
+
+    if (total_accesses > 0) {
+        double fault_rate = (double)st->page_faults / (double)total_accesses;
+        double hit_rate   = 1.0 - fault_rate;
+        printf("Memory hit rate: %.2f%%\n", hit_rate * 100.0);
+        printf("Page fault rate: %.2f%%\n", fault_rate * 100.0);
+    }
+
+    if (cfg->tlb_size > 0) {
+        long long tlb_total = st->tlb_hits + st->tlb_misses;
+        printf("TLB entries: %d\n", cfg->tlb_size);
+        printf("TLB hits: %lld\n", st->tlb_hits);
+        printf("TLB misses: %lld\n", st->tlb_misses);
+
+        if (tlb_total > 0) {
+            double tlb_hit_rate = (double)st->tlb_hits / (double)tlb_total;
+            printf("TLB hit rate: %.2f%%\n", tlb_hit_rate * 100.0);
+            printf("Approx. AMAT: %.2f cycles\n", sim_amat(sim));
+        }
+    }
+
+    printf("Write-backs (dirty evictions): %lld\n", st->write_backs);
+    if (st->reclaimed > 0) printf("Proactively reclaimed frames: %lld\n", st->reclaimed);
+    if (sim->swap) swap_print_stats(sim->swap);
+    if (sim->ksm) ksm_print_stats(sim->ksm, total_accesses);
+    if (sim->damon) damon_print_stats(sim->damon);
+    if (sim->reclaim) reclaim_print_stats(sim->reclaim);
+    if (sim->wb) writeback_print_stats(sim->wb, sim);
+    if (alg_is_rrip(cfg->alg)) rrip_print_stats(&sim->rrip);
+    if (cfg->alg == ALG_SHIP) ship_print_stats(&sim->ship);
+    if (sim->pcprof) pcprof_print(sim->pcprof, st->page_faults);
+    if (sim->plugin) plugin_print_stats(sim->plugin);
+}
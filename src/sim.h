@@ -0,0 +1,224 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "cuckoo.h"
+#include "damon.h"
+#include "frames.h"
+#include "ipt.h"
+#include "ksm.h"
+#include "pcprof.h"
+#include "plugin.h"
+#include "reclaim.h"
+#include "rrip.h"
+#include "ship.h"
+#include "swap.h"
+#include "tlb.h"
+#include "trace.h"
+#include "writeback.h"
+
+#define PAGE_SIZE 4096
+#define DEFAULT_NUM_FRAMES 3
+
+// Address spaces are told apart by folding the ASID into the page key
+#define SIM_ASID_SHIFT 48
+
+typedef enum {
+    ALG_FIFO, ALG_LRU, ALG_CLOCK, ALG_SRRIP, ALG_BRRIP, ALG_DRRIP, ALG_SHIP,
+    ALG_PLUGIN
+} Algorithm;
+typedef enum { WP_WRITE_THROUGH, WP_WRITE_BACK } WritePolicy;
+typedef enum { PT_FLAT, PT_INVERTED, PT_CUCKOO, PT_COMPACT } PageTableMode;
+
+// Outcome of one access. ACC_FAULT is a major fault (the page is read from
+// disk); the other faults are served from memory.
+typedef enum {
+    ACC_TLB_HIT, ACC_HIT, ACC_FAULT, ACC_MINOR_FAULT, ACC_ZERO_FAULT
+} AccessResult;
+
+typedef struct {
+    Algorithm alg;
+    const char *plugin;     // ALG_PLUGIN: "path.so[:args]"
+    int rrpv_bits;          // RRIP policies: 2 or 3
+    WritePolicy write_policy;
+    PageTableMode pt_mode;
+    int num_frames;
+    int tlb_size;
+    int compact;
+    int quiet;              // no per-access output
+    int swap_cache;         // evicted pages kept for minor faults
+
+    // Latencies in cycles
+    double tlb_lat;
+    double mem_lat;
+    double zero_lat;        // demand-zero fault: zero-fill a new page
+    double minor_lat;       // minor fault: remap a page still in memory
+    double disk_lat;        // major fault
+} SimConfig;
+
+typedef struct {
+    long long reads, writes;
+    long long page_faults;  // all three kinds below
+    long long zero_faults, minor_faults, major_faults;
+    long long tlb_hits, tlb_misses;
+    long long write_backs;  // evictions of dirty pages
+    long long reclaimed;    // frames freed by proactive reclaim
+    long long trace_accesses;   // accesses before a trace filter, 0 if none
+
+    // With a device model: time spent waiting for it, in cycles
+    double major_wait;      // major faults until their read completed
+    double write_stall;     // swap-outs held up by a full device queue
+} SimStats;
+
+typedef struct Simulator {
+    SimConfig cfg;
+    SimStats stats;
+
+    // ---- Memory frames & metadata ----
+    FrameTable ft;
+    int frames_used;        // frames are never freed, so they fill in order
+
+    // ---- Optional vpn -> frame directories ----
+    InvertedPageTable ipt;
+    CuckooMap dir;
+
+    // ---- Optional TLB ----
+    TLB tlb;
+
+    int fifo_index;         // FIFO state
+    int clock_hand;         // CLOCK state
+    Rrip rrip;              // SRRIP/BRRIP/DRRIP/SHiP state
+    Ship ship;              // SHiP predictor
+    unsigned long tick;     // Tick counter (for LRU timing)
+    struct Plugin *plugin;  // ALG_PLUGIN state
+
+    unsigned short asid;    // address space of the running process
+
+    // ---- Fault classification ----
+    CuckooMap seen;         // pages touched before: not demand-zero
+    CuckooMap sc_index;     // swap cache: page -> ring slot
+    unsigned long *sc_ring; // evicted pages, oldest is overwritten first
+    unsigned char *sc_ra;   // entry was brought in by readahead
+    int sc_head;
+
+    // ---- Optional swap space ----
+    struct Swap *swap;
+    int cpu;                // CPU issuing the accesses, for slot caches
+    unsigned long pc;       // instruction making the access, 0 if unknown
+    struct PcProfile *pcprof;   // faults by instruction, once PCs are seen
+
+    // Simulated time, kept when the swap device or writeback is modelled
+    double now;
+    double fault_done;      // completion of the last major fault's read
+
+    // ---- Optional same-page merging ----
+    struct Ksm *ksm;
+    int *free_frames;       // frames given back by merging or reclaim
+    int nfree;
+
+    // ---- Optional region-based access monitor ----
+    struct Damon *damon;
+
+    // ---- Optional proactive reclaim controller ----
+    struct Reclaim *reclaim;
+
+    // ---- Optional dirty throttling and writeback ----
+    struct Writeback *wb;
+} Simulator;
+
+static inline int alg_is_rrip(Algorithm alg) {
+    return alg == ALG_SRRIP || alg == ALG_BRRIP || alg == ALG_DRRIP || alg == ALG_SHIP;
+}
+
+void sim_config_defaults(SimConfig *cfg);
+
+// Sets the policy from its -a name ("lru", "plugin:path.so", ...); the
+// plugin spec is kept by reference. Returns -1 for an unknown name.
+int  sim_config_algorithm(SimConfig *cfg, const char *name);
+
+int  sim_init(Simulator *sim, const SimConfig *cfg);
+void sim_free(Simulator *sim);
+
+// Turns on same-page merging. Traces then report page contents through
+// sim_page_content.
+int  sim_enable_ksm(Simulator *sim, const KsmConfig *kc);
+void sim_page_content(Simulator *sim, unsigned long addr, unsigned long long content);
+
+// Gives evicted pages swap slots. Needs a swap cache for readahead.
+int  sim_enable_swap(Simulator *sim, const SwapConfig *sc);
+int  sim_in_swap_cache(const Simulator *sim, unsigned long key);
+void sim_swap_cache_add(Simulator *sim, unsigned long key, int readahead);
+
+// Models the swap device as an SSD; major faults then take as long as the
+// device needs under the current load. Requires swap.
+int  sim_enable_ssd(Simulator *sim, const SsdConfig *sc);
+
+// Puts swap in far memory instead, with the same timing treatment
+int  sim_enable_far(Simulator *sim, const FarConfig *fc);
+
+static inline int sim_has_device(const Simulator *sim) {
+    return sim->swap && (sim->swap->ssd || sim->swap->far);
+}
+
+// Whether accesses advance the simulated clock
+static inline int sim_clocked(const Simulator *sim) {
+    return sim_has_device(sim) || sim->wb;
+}
+
+// Turns on DAMON-style monitoring (and its pageout scheme, if configured)
+int  sim_enable_damon(Simulator *sim, const DamonConfig *dc);
+
+// Turns on the SLO-driven proactive reclaim controller. Needs the wide
+// frame table, whose last-use ticks it keeps for every policy.
+int  sim_enable_reclaim(Simulator *sim, const ReclaimConfig *rc);
+
+// Turns on dirty page throttling and background writeback. Write-back mode.
+int  sim_enable_writeback(Simulator *sim, const WritebackConfig *wc);
+
+// Simulates one access. Returns -1 if the address cannot be simulated.
+int  sim_access(Simulator *sim, char op, unsigned long addr);
+
+// Simulates `count` consecutive accesses to the page of addr, `writes` of
+// which are writes, starting with an `op` access. Only the first access
+// can miss, so the rest are applied in O(1) with identical stats. With
+// merging, monitoring, reclaim, dirty throttling or DRRIP the rest are
+// simulated one at a time, writes first.
+int  sim_access_run(Simulator *sim, char op, unsigned long addr,
+                    unsigned long count, unsigned long writes);
+
+// Marks the page of addr dirty if it is resident, without counting an access
+void sim_mark_dirty(Simulator *sim, unsigned long addr);
+
+// Counts an access that was skipped (unknown op) so LRU ticks stay aligned
+static inline void sim_skip(Simulator *sim) { sim->tick++; }
+
+// Replays one trace record: a dirty mark, skipped accesses for an unknown
+// op, or accesses from the record's CPU and PC followed by its page
+// content. Returns the access result (ACC_HIT for records that are not
+// accesses), or -1 if the address cannot be simulated.
+int  sim_replay_record(Simulator *sim, const TraceRecord *rec);
+
+static inline unsigned long sim_page_key(const Simulator *sim, unsigned long addr) {
+    return (addr / PAGE_SIZE) | ((unsigned long)sim->asid << SIM_ASID_SHIFT);
+}
+
+// Frame plumbing for the merging scanner
+int  sim_frame_of(const Simulator *sim, unsigned long key);
+void sim_map_frame(Simulator *sim, int f, unsigned long key);
+void sim_unmap_frame(Simulator *sim, int f);
+void sim_release_frame(Simulator *sim, int f);
+
+// Proactive reclaim: evicts frame f (writing it back or out as needed)
+// and puts it on the free list
+void sim_reclaim_frame(Simulator *sim, int f);
+
+const char *sim_alg_name(const Simulator *sim);
+
+// Cycles spent in faults so far, and the approximate average memory access
+// time: a TLB or memory access, plus the fault time spread over accesses
+double sim_fault_time(const Simulator *sim);
+double sim_amat(const Simulator *sim);
+
+void sim_print_frames(const Simulator *sim);
+void sim_print_stats(const Simulator *sim);
+
+#endif
@@ -0,0 +1,398 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cuckoo.h"
+#include "mrc.h"
+#include "sizing.h"
+
+typedef struct {
+    const SimConfig *cfg;
+    const SizingConfig *zc;
+    char **traces;
+    int ntraces, collapse;
+    long long accesses;         // in the whole trace
+    long footprint;
+    int probes, stopped;        // runs made, and cut short
+} SizingJob;
+
+typedef struct {
+    SizingJob *job;
+    int frames;
+    int run_out;                // no early stop: the full run is wanted
+    long long faults;
+    double amat;
+    int stopped;                // over the target before the end of the trace
+    int rc;
+} Probe;
+
+static int open_all(TraceReader *tr, const SizingJob *j) {
+    if (j->ntraces == 1) return trace_open(tr, j->traces[0], j->collapse);
+    return trace_open_merged(tr, j->traces, j->ntraces, j->collapse);
+}
+
+// Accesses and distinct pages, for the fault budgets and the search range
+static int count_trace(SizingJob *j) {
+    TraceReader tr;
+    CuckooMap pages;
+    if (open_all(&tr, j) != 0) return -1;
+    if (cuckoo_init(&pages, 1024) != 0) {
+        trace_close(&tr);
+        return -1;
+    }
+    int rc = 0;
+    TraceRecord rec;
+    while (rc == 0 && trace_next(&tr, &rec)) {
+        if (rec.op != 'R' && rec.op != 'W') continue;
+        j->accesses += (long long)rec.count;
+        unsigned long key = rec.addr / PAGE_SIZE;
+        if (cuckoo_find(&pages, key) < 0) rc = cuckoo_insert(&pages, key, 0);
+    }
+    j->footprint = (long)pages.count;
+    cuckoo_free(&pages);
+    trace_close(&tr);
+    return rc;
+}
+
+// ---- Simulated runs ----
+
+// Whether the run so far already spends more than the whole trace may
+static int over_budget(const Simulator *sim, const SizingJob *j) {
+    const SizingConfig *zc = j->zc;
+    if (zc->fault_rate > 0.0 &&
+        (double)sim->stats.page_faults > zc->fault_rate * (double)j->accesses)
+        return 1;
+    if (zc->amat > 0.0) {
+        // Every access costs at least a TLB hit or a memory access
+        double floor = sim->cfg.mem_lat;
+        if (sim->cfg.tlb_size > 0 && sim->cfg.tlb_lat < floor) floor = sim->cfg.tlb_lat;
+        if (floor + sim_fault_time(sim) / (double)j->accesses > zc->amat) return 1;
+    }
+    return 0;
+}
+
+static void *probe_run(void *arg) {
+    Probe *p = (Probe *)arg;
+    const SizingJob *j = p->job;
+    const SizingConfig *zc = j->zc;
+    TraceReader tr;
+    if (open_all(&tr, j) != 0) {
+        p->rc = -1;
+        return NULL;
+    }
+    SimConfig cfg = *j->cfg;
+    cfg.num_frames = p->frames;
+    cfg.quiet = 1;
+    Simulator sim;
+    if (sim_init(&sim, &cfg) != 0) {
+        trace_close(&tr);
+        p->rc = -1;
+        return NULL;
+    }
+    if ((zc->swap && sim_enable_swap(&sim, zc->swap) != 0) ||
+        (zc->ssd && sim_enable_ssd(&sim, zc->ssd) != 0) ||
+        (zc->far && sim_enable_far(&sim, zc->far) != 0)) {
+        p->rc = -1;
+    }
+
+    long records = 0;
+    TraceRecord rec;
+    while (p->rc == 0 && trace_next(&tr, &rec)) {
+        if (sim_replay_record(&sim, &rec) < 0) p->rc = -1;
+        if (!p->run_out && (++records & 4095) == 0 && over_budget(&sim, j)) {
+            p->stopped = 1;
+            break;
+        }
+    }
+    if (!p->run_out && !p->stopped && over_budget(&sim, j)) p->stopped = 1;
+    p->faults = sim.stats.page_faults;
+    p->amat = sim_amat(&sim);
+    sim_free(&sim);
+    trace_close(&tr);
+    return NULL;
+}
+
+// Runs the probes side by side, one thread each
+static int run_batch(Probe *p, int n) {
+    pthread_t *tid = (pthread_t *)malloc((size_t)n * sizeof(pthread_t));
+    if (!tid) return -1;
+    int started = 0, rc = 0;
+    for (; started < n; started++)
+        if (pthread_create(&tid[started], NULL, probe_run, &p[started]) != 0) break;
+    for (int i = started; i < n; i++) probe_run(&p[i]);     // no threads left
+    for (int i = 0; i < started; i++) pthread_join(tid[i], NULL);
+    free(tid);
+    for (int i = 0; i < n; i++) {
+        if (p[i].rc != 0) rc = -1;
+        p[i].job->probes++;
+        p[i].job->stopped += p[i].stopped;
+    }
+    return rc;
+}
+
+static int meets(const Probe *p, const SizingConfig *zc) {
+    if (p->stopped) return 0;
+    if (zc->fault_rate > 0.0 &&
+        (double)p->faults > zc->fault_rate * (double)p->job->accesses)
+        return 0;
+    return zc->amat <= 0.0 || p->amat <= zc->amat;
+}
+
+// Gallops up to a size that meets the target, then narrows the bracket.
+// Returns the size, 0 if even the whole footprint misses, -1 on error.
+static int search(SizingJob *j, Probe *best) {
+    const SizingConfig *zc = j->zc;
+    int t = zc->threads;
+    int lo = 0, hi = 0, rc = 0;
+    Probe *batch = (Probe *)malloc((size_t)t * sizeof(Probe));
+    if (!batch) return -1;
+    long size = SIZING_START;
+    while (rc == 0 && hi == 0) {
+        if (lo >= j->footprint) break;
+        int n = 0;
+        for (; n < t; n++) {
+            long s = size < j->footprint ? size : j->footprint;
+            if (s <= lo || (n > 0 && s == batch[n - 1].frames)) break;
+            Probe zero = {0};
+            batch[n] = zero;
+            batch[n].job = j;
+            batch[n].frames = (int)s;
+            size *= 2;
+        }
+        if (run_batch(batch, n) != 0) rc = -1;
+        for (int k = 0; rc == 0 && k < n; k++) {
+            if (meets(&batch[k], zc)) {
+                hi = batch[k].frames;
+                *best = batch[k];
+                break;
+            }
+            lo = batch[k].frames;
+        }
+    }
+    while (rc == 0 && hi - lo > 1) {
+        int n = hi - lo - 1 < t ? hi - lo - 1 : t;
+        for (int k = 0; k < n; k++) {
+            Probe zero = {0};
+            batch[k] = zero;
+            batch[k].job = j;
+            batch[k].frames = lo + (int)((long)(hi - lo) * (k + 1) / (n + 1));
+        }
+        if (run_batch(batch, n) != 0) rc = -1;
+        for (int k = 0; rc == 0 && k < n; k++) {
+            if (meets(&batch[k], zc)) {
+                hi = batch[k].frames;
+                *best = batch[k];
+                break;
+            }
+            lo = batch[k].frames;
+        }
+    }
+    free(batch);
+    return rc == 0 ? hi : -1;
+}
+
+// ---- Miss ratio curve ----
+
+// Faults at 0..footprint frames; with LRU and no swap cache, the first
+// touch of each page is a demand-zero fault and every other fault is major
+static long long *lru_curve(SizingJob *j) {
+    TraceReader tr;
+    MrcTrace t = {0};
+    MrcCurve c = {0};
+    long footprint = 0;
+    if (open_all(&tr, j) != 0) return NULL;
+    int rc = mrc_lru_stream(&tr, &t, 0, j->zc->threads, &c, &footprint);
+    trace_close(&tr);
+    long long *faults = NULL;
+    int max = c.max_size;
+    if (rc == 0) faults = (long long *)malloc(((size_t)max + 1) * sizeof(long long));
+    if (faults) {
+        faults[0] = c.accesses;
+        for (int s = 1; s <= max; s++) faults[s] = faults[s - 1] - c.hits[s];
+    }
+    mrc_curve_free(&c);
+    return faults;
+}
+
+static double curve_amat(const SizingJob *j, long long faults) {
+    const SimConfig *cfg = j->cfg;
+    if (j->accesses == 0) return cfg->mem_lat;
+    double zero = (double)j->footprint;
+    return cfg->mem_lat +
+           (zero * cfg->zero_lat + ((double)faults - zero) * cfg->disk_lat) /
+               (double)j->accesses;
+}
+
+static int curve_meets(const SizingJob *j, long long faults) {
+    const SizingConfig *zc = j->zc;
+    if (zc->fault_rate > 0.0 && (double)faults > zc->fault_rate * (double)j->accesses)
+        return 0;
+    return zc->amat <= 0.0 || curve_amat(j, faults) <= zc->amat;
+}
+
+// ---- Report ----
+
+static double pct(long long faults, long long accesses) {
+    return accesses > 0 ? 100.0 * (double)faults / (double)accesses : 0.0;
+}
+
+// Sizes past the minimum the marginal table looks at, in percent
+static const int extra_pct[] = { 10, 25, 50, 100 };
+#define NEXTRA ((int)(sizeof extra_pct / sizeof extra_pct[0]))
+
+static int extra_frames(const SizingJob *j, int best, int k) {
+    long s = (long)best * (100 + extra_pct[k]) / 100;
+    if (s <= best) s = best + 1;
+    return s < j->footprint ? (int)s : (int)j->footprint;
+}
+
+static void print_marginal(int best, long long best_faults, const int *frames,
+                           const long long *faults, const double *amat, int n,
+                           long long accesses) {
+    printf("Marginal value of memory beyond that size:\n");
+    printf("%10s %7s %11s %12s %18s\n", "frames", "extra", "fault rate", "AMAT",
+           "faults saved/frame");
+    for (int k = 0; k < n; k++) {
+        printf("%10d %6.0f%% %10.3f%% %12.1f", frames[k],
+               100.0 * (double)(frames[k] - best) / (double)best,
+               pct(faults[k], accesses), amat[k]);
+        if (frames[k] > best)
+            printf(" %18.2f\n", (double)(best_faults - faults[k]) / (double)(frames[k] - best));
+        else
+            printf(" %18s\n", "-");
+    }
+}
+
+int sizing_run(const SimConfig *cfg, const SizingConfig *zc, char **traces, int ntraces,
+               int collapse) {
+    SizingJob j = {0};
+    j.cfg = cfg;
+    j.zc = zc;
+    j.traces = traces;
+    j.ntraces = ntraces;
+    j.collapse = collapse;
+    if (count_trace(&j) != 0) {
+        perror("Error reading trace");
+        return -1;
+    }
+
+    printf("\n--- Memory sizing ---\n");
+    printf("Target:");
+    if (zc->fault_rate > 0.0) printf(" fault rate <= %.3f%%", 100.0 * zc->fault_rate);
+    if (zc->fault_rate > 0.0 && zc->amat > 0.0) printf(" and");
+    if (zc->amat > 0.0) printf(" AMAT <= %.1f cycles", zc->amat);
+    printf("\nTrace: %lld accesses, footprint %ld pages\n", j.accesses, j.footprint);
+
+    // LRU is a stack algorithm; the curve prices every size at once
+    int stack = cfg->alg == ALG_LRU && cfg->swap_cache == 0 && !zc->swap &&
+                (zc->amat <= 0.0 || cfg->tlb_size == 0);
+    int frames[NEXTRA + 1];
+    long long faults[NEXTRA + 1];
+    double amat[NEXTRA + 1];
+    int n = 0, best = 0, checked = 0;
+    Probe check[2] = {{0}, {0}};
+
+    if (stack) {
+        long long *curve = lru_curve(&j);
+        if (!curve) {
+            perror("Error computing miss ratio curve");
+            return -1;
+        }
+        for (int s = 1; s <= j.footprint && best == 0; s++)
+            if (curve_meets(&j, curve[s])) best = s;
+        printf("Method: LRU miss ratio curve, checked by simulation\n");
+        if (best > 0) {
+            frames[n] = best;
+            for (int k = 0; k < NEXTRA; k++) {
+                int s = extra_frames(&j, best, k);
+                if (s > frames[n]) frames[++n] = s;
+            }
+            n++;
+            for (int k = 0; k < n; k++) {
+                faults[k] = curve[frames[k]];
+                amat[k] = curve_amat(&j, faults[k]);
+            }
+        }
+        free(curve);
+
+        // The answer should meet the target in a real run, one frame less not
+        if (best > 0) {
+            checked = best > 1 ? 2 : 1;
+            for (int k = 0; k < checked; k++) {
+                check[k].job = &j;
+                check[k].frames = best - k;
+                check[k].run_out = 1;
+            }
+            if (run_batch(check, checked) != 0) {
+                perror("Error simulating");
+                return -1;
+            }
+        }
+    } else {
+        Probe at_best = {0};
+        best = search(&j, &at_best);
+        if (best < 0) {
+            perror("Error simulating");
+            return -1;
+        }
+        printf("Method: search over simulated runs, %d at a time: %d runs, %d stopped early\n",
+               zc->threads, j.probes, j.stopped);
+        if (best > 0) {
+            // The minimum ran without stopping; price the larger sizes
+            frames[0] = best;
+            faults[0] = at_best.faults;
+            amat[0] = at_best.amat;
+            Probe more[NEXTRA];
+            int m = 0;
+            for (int k = 0; k < NEXTRA; k++) {
+                int s = extra_frames(&j, best, k);
+                if (s <= (m ? more[m - 1].frames : best)) continue;
+                Probe zero = {0};
+                more[m] = zero;
+                more[m].job = &j;
+                more[m].frames = s;
+                more[m].run_out = 1;
+                m++;
+            }
+            for (int k = 0; k < m; k += zc->threads) {
+                int batch = m - k < zc->threads ? m - k : zc->threads;
+                if (run_batch(&more[k], batch) != 0) {
+                    perror("Error simulating");
+                    return -1;
+                }
+            }
+            n = 1;
+            for (int k = 0; k < m; k++, n++) {
+                frames[n] = more[k].frames;
+                faults[n] = more[k].faults;
+                amat[n] = more[k].amat;
+            }
+        }
+    }
+
+    if (best == 0) {
+        printf("The target is out of reach: even %ld frames, the whole footprint, "
+               "miss it\n", j.footprint);
+        return 0;
+    }
+    // The search ends on a size that meets the target next to one that
+    // misses it. Only for a stack algorithm does that make it the minimum:
+    // FIFO, CLOCK and the rest can fault more with more memory (Belady's
+    // anomaly), so a smaller size may meet the target too.
+    int minimum = cfg->alg == ALG_LRU;
+    printf("%s frames: %d (%.1f%% of the footprint): fault rate %.3f%%, "
+           "AMAT %.1f cycles\n", minimum ? "Minimum" : "Found", best,
+           100.0 * (double)best / (double)j.footprint, pct(faults[0], j.accesses), amat[0]);
+    if (!minimum && best > 1)
+        printf("Bracket: %d frames miss the target, but the policy is not a stack algorithm; "
+               "fewer frames may still meet it\n", best - 1);
+    if (checked) {
+        printf("Simulated: %d frames %s the target", best,
+               meets(&check[0], zc) ? "meet" : "MISS");
+        if (checked == 2)
+            printf(", %d frames %s", best - 1, meets(&check[1], zc) ? "MEET it too" : "do not");
+        printf("\n");
+    }
+    print_marginal(best, faults[0], frames, faults, amat, n, j.accesses);
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef SIZING_H
+#define SIZING_H
+
+#include "sim.h"
+
+// Memory sizing (-target-fault-rate, -target-amat): the fewest frames with
+// which the trace meets a fault-rate and/or AMAT target, and what memory
+// beyond that still buys.
+//
+// For LRU without a swap cache or device model, faults at every size come
+// from the miss ratio curve in one pass, and the answer is checked by
+// simulating it and one frame less. Other configurations are searched by
+// simulation, assuming more memory never hurts: sizes double from
+// SIZING_START frames in batches of parallel runs until one meets the
+// target, then the bracket is narrowed a batch of points at a time. A run
+// stops as soon as its faults or fault time are over what the target
+// allows for the whole trace. That assumption holds for LRU only; for
+// other policies the answer is a size that meets the target next to one
+// that misses it, not necessarily the minimum, and is reported as such.
+
+#define SIZING_START 16
+
+typedef struct {
+    double fault_rate;          // faults per access, 0 if unset
+    double amat;                // cycles per access, 0 if unset
+    int threads;                // simulations run at once
+    const SwapConfig *swap;     // optional swap space, device models
+    const SsdConfig *ssd;
+    const FarConfig *far;
+} SizingConfig;
+
+int sizing_run(const SimConfig *cfg, const SizingConfig *zc, char **traces, int ntraces,
+               int collapse);
+
+#endif
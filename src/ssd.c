@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ssd.h"
+
+void ssd_config_defaults(SsdConfig *sc) {
+    sc->channels = 4;
+    sc->dies_per_channel = 2;
+    sc->pages_per_block = 64;
+    sc->op = 0.07;
+    sc->queue_depth = 32;
+
+    // TLC-like timings at ~3 GHz
+    sc->read_lat  = 150000.0;       // 50 us
+    sc->prog_lat  = 1500000.0;      // 500 us
+    sc->erase_lat = 10000000.0;     // ~3.3 ms
+    sc->xfer_lat  = 15000.0;        // 4 KB at ~800 MB/s
+}
+
+int ssd_init(Ssd *ssd, const SsdConfig *sc, int logical_pages) {
+    Ssd zero = {0};
+    *ssd = zero;
+    ssd->cfg = *sc;
+    ssd->ndies = sc->channels * sc->dies_per_channel;
+    ssd->logical_pages = logical_pages;
+
+    // Enough blocks for the logical space plus spare area, and never fewer
+    // than two spare blocks per die so GC always has somewhere to copy to.
+    int ppb = sc->pages_per_block;
+    long per_die = ((long)logical_pages + ssd->ndies - 1) / ssd->ndies;
+    int blocks = (int)((per_die + ppb - 1) / ppb);
+    int spare = (int)((double)blocks * sc->op + 0.999);
+    ssd->blocks_per_die = blocks + (spare < 2 ? 2 : spare);
+
+    size_t nblocks = (size_t)ssd->ndies * (size_t)ssd->blocks_per_die;
+    size_t npages = nblocks * (size_t)ppb;
+    ssd->l2p = (int *)malloc((size_t)logical_pages * sizeof(int));
+    ssd->p2l = (int *)malloc(npages * sizeof(int));
+    ssd->valid = (int *)calloc(nblocks, sizeof(int));
+    ssd->erases = (int *)calloc(nblocks, sizeof(int));
+    ssd->full = (unsigned char *)calloc(nblocks, 1);
+    ssd->dies = (SsdDie *)calloc((size_t)ssd->ndies, sizeof(SsdDie));
+    ssd->chan_busy = (double *)calloc((size_t)sc->channels, sizeof(double));
+    ssd->inflight = (double *)malloc((size_t)sc->queue_depth * sizeof(double));
+    if (!ssd->l2p || !ssd->p2l || !ssd->valid || !ssd->erases || !ssd->full || !ssd->dies ||
+        !ssd->chan_busy || !ssd->inflight) {
+        ssd_free(ssd);
+        return -1;
+    }
+    for (int i = 0; i < logical_pages; i++) ssd->l2p[i] = -1;
+    for (size_t i = 0; i < npages; i++) ssd->p2l[i] = -1;
+
+    for (int d = 0; d < ssd->ndies; d++) {
+        SsdDie *die = &ssd->dies[d];
+        die->free_blocks = (int *)malloc((size_t)ssd->blocks_per_die * sizeof(int));
+        if (!die->free_blocks) {
+            ssd_free(ssd);
+            return -1;
+        }
+        for (int b = ssd->blocks_per_die - 1; b >= 0; b--) die->free_blocks[die->nfree++] = b;
+        die->open_block = -1;
+    }
+    return 0;
+}
+
+void ssd_free(Ssd *ssd) {
+    if (ssd->dies) {
+        for (int d = 0; d < ssd->ndies; d++) free(ssd->dies[d].free_blocks);
+    }
+    free(ssd->l2p);
+    free(ssd->p2l);
+    free(ssd->valid);
+    free(ssd->erases);
+    free(ssd->full);
+    free(ssd->dies);
+    free(ssd->chan_busy);
+    free(ssd->inflight);
+
+    Ssd zero = {0};
+    *ssd = zero;
+}
+
+// ---- FTL ----
+
+static int block_of(const Ssd *ssd, int ppn) {
+    return ppn / ssd->cfg.pages_per_block;
+}
+
+static int die_of_block(const Ssd *ssd, int gblock) {
+    return gblock / ssd->blocks_per_die;
+}
+
+static void invalidate(Ssd *ssd, int lpn) {
+    int ppn = ssd->l2p[lpn];
+    if (ppn < 0) return;
+    ssd->p2l[ppn] = -1;
+    ssd->valid[block_of(ssd, ppn)]--;
+    ssd->l2p[lpn] = -1;
+}
+
+// Next free physical page on die d, opening a new block when needed
+static int take_page(Ssd *ssd, int d) {
+    SsdDie *die = &ssd->dies[d];
+    if (die->open_block < 0 || die->next_page == ssd->cfg.pages_per_block) {
+        if (die->nfree == 0) return -1;
+        if (die->open_block >= 0) ssd->full[die->open_block] = 1;
+        die->open_block = d * ssd->blocks_per_die + die->free_blocks[--die->nfree];
+        die->next_page = 0;
+    }
+    return die->open_block * ssd->cfg.pages_per_block + die->next_page++;
+}
+
+static void place(Ssd *ssd, int lpn, int ppn) {
+    ssd->l2p[lpn] = ppn;
+    ssd->p2l[ppn] = lpn;
+    ssd->valid[block_of(ssd, ppn)]++;
+}
+
+// Greedy GC on die d, starting at time `start`. Returns when the die is
+// done, or a negative time if no full block has an invalid page to reclaim
+// (collecting a fully valid block would only move it, freeing nothing).
+static double collect(Ssd *ssd, int d, double start) {
+    SsdDie *die = &ssd->dies[d];
+    int ppb = ssd->cfg.pages_per_block;
+    int first = d * ssd->blocks_per_die;
+
+    int victim = -1;
+    for (int b = first; b < first + ssd->blocks_per_die; b++) {
+        if (ssd->full[b] && (victim < 0 || ssd->valid[b] < ssd->valid[victim])) victim = b;
+    }
+    if (victim < 0 || ssd->valid[victim] == ppb) return -1.0;
+
+    ssd->gc_runs++;
+    ssd->full[victim] = 0;
+    double t = start;
+    for (int p = 0; p < ppb; p++) {
+        int lpn = ssd->p2l[victim * ppb + p];
+        if (lpn < 0) continue;
+        invalidate(ssd, lpn);
+        int dst = take_page(ssd, d);
+        if (dst < 0) break;     // cannot happen with two spare blocks
+        place(ssd, lpn, dst);
+        ssd->gc_copies++;
+        t += ssd->cfg.read_lat + ssd->cfg.prog_lat;
+    }
+    t += ssd->cfg.erase_lat;
+    ssd->erases[victim]++;
+    ssd->erase_count++;
+    die->free_blocks[die->nfree++] = victim - first;
+    ssd->gc_time += t - start;
+    return t;
+}
+
+// ---- Queue ----
+
+// Waits for a free queue slot; returns when the request is accepted
+static double admit(Ssd *ssd, double now) {
+    // Retire everything finished by now
+    int n = 0;
+    for (int i = 0; i < ssd->ninflight; i++) {
+        if (ssd->inflight[i] > now) ssd->inflight[n++] = ssd->inflight[i];
+    }
+    ssd->ninflight = n;
+    if (n < ssd->cfg.queue_depth) return now;
+
+    int first = 0;
+    for (int i = 1; i < n; i++) {
+        if (ssd->inflight[i] < ssd->inflight[first]) first = i;
+    }
+    double t = ssd->inflight[first];
+    ssd->inflight[first] = ssd->inflight[--ssd->ninflight];
+    ssd->queue_wait += t - now;
+    return t;
+}
+
+static double max2(double a, double b) {
+    return a > b ? a : b;
+}
+
+double ssd_read(Ssd *ssd, int lpn, double now, double *accepted) {
+    double t = admit(ssd, now);
+    if (accepted) *accepted = t;
+    ssd->host_reads++;
+
+    int ppn = ssd->l2p[lpn];
+    int d = (ppn >= 0) ? die_of_block(ssd, block_of(ssd, ppn)) : lpn % ssd->ndies;
+    int c = d / ssd->cfg.dies_per_channel;
+
+    double start = max2(t, ssd->dies[d].busy_until);
+    ssd->dies[d].busy_until = start + ssd->cfg.read_lat;
+    double xfer = max2(ssd->dies[d].busy_until, ssd->chan_busy[c]);
+    ssd->chan_busy[c] = xfer + ssd->cfg.xfer_lat;
+    double done = ssd->chan_busy[c];
+
+    ssd->inflight[ssd->ninflight++] = done;
+    ssd->read_lat_sum += done - now;
+    if (done - now > ssd->read_lat_max) ssd->read_lat_max = done - now;
+    return done;
+}
+
+double ssd_write(Ssd *ssd, int lpn, double now, double *accepted) {
+    double t = admit(ssd, now);
+    if (accepted) *accepted = t;
+    ssd->host_writes++;
+
+    int d = ssd->next_die;
+    ssd->next_die = (ssd->next_die + 1) % ssd->ndies;
+    int c = d / ssd->cfg.dies_per_channel;
+    SsdDie *die = &ssd->dies[d];
+
+    invalidate(ssd, lpn);
+
+    // Keep one erased block in reserve for GC to copy into
+    while (die->nfree <= 1 &&
+           (die->open_block < 0 || die->next_page == ssd->cfg.pages_per_block)) {
+        double gc_done = collect(ssd, d, max2(t, die->busy_until));
+        if (gc_done < 0.0) break;
+        die->busy_until = gc_done;
+    }
+    int ppn = take_page(ssd, d);
+    if (ppn >= 0) place(ssd, lpn, ppn);
+
+    double xfer = max2(t, ssd->chan_busy[c]);
+    ssd->chan_busy[c] = xfer + ssd->cfg.xfer_lat;
+    double start = max2(ssd->chan_busy[c], die->busy_until);
+    die->busy_until = start + ssd->cfg.prog_lat;
+    double done = die->busy_until;
+
+    ssd->inflight[ssd->ninflight++] = done;
+    return done;
+}
+
+void ssd_trim(Ssd *ssd, int lpn) {
+    if (ssd->l2p[lpn] < 0) return;
+    invalidate(ssd, lpn);
+    ssd->trims++;
+}
+
+void ssd_print_stats(const Ssd *ssd) {
+    size_t nblocks = (size_t)ssd->ndies * (size_t)ssd->blocks_per_die;
+    int max_erase = 0;
+    for (size_t b = 0; b < nblocks; b++) {
+        if (ssd->erases[b] > max_erase) max_erase = ssd->erases[b];
+    }
+    long long flash_writes = ssd->host_writes + ssd->gc_copies;
+
+    printf("\n--- SSD ---\n");
+    printf("Geometry: %d channels x %d dies, %d blocks/die of %d pages "
+           "(%.0f%% over-provisioning), queue depth %d\n",
+           ssd->cfg.channels, ssd->cfg.dies_per_channel, ssd->blocks_per_die,
+           ssd->cfg.pages_per_block, ssd->cfg.op * 100.0, ssd->cfg.queue_depth);
+    printf("Host reads: %lld, host writes: %lld, trims: %lld\n",
+           ssd->host_reads, ssd->host_writes, ssd->trims);
+    printf("GC: %lld runs, %lld pages relocated, %lld erases (%.0f die cycles)\n",
+           ssd->gc_runs, ssd->gc_copies, ssd->erase_count, ssd->gc_time);
+    printf("Write amplification: %.2f\n",
+           ssd->host_writes > 0 ? (double)flash_writes / (double)ssd->host_writes : 0.0);
+    printf("Wear: %.2f erases/block average, %d max\n",
+           (double)ssd->erase_count / (double)nblocks, max_erase);
+    printf("Read latency: %.0f cycles average, %.0f max\n",
+           ssd->host_reads > 0 ? ssd->read_lat_sum / (double)ssd->host_reads : 0.0,
+           ssd->read_lat_max);
+    printf("Queue-full waits: %.0f cycles\n", ssd->queue_wait);
+}
@@ -0,0 +1,78 @@
+#ifndef SSD_H
+#define SSD_H
+
+// SSD model for the swap device. Dies work in parallel and share their
+// channel's bus; a read occupies the die and then the bus, a write the
+// bus and then the die. At most `queue_depth` requests are outstanding, so
+// a burst of writes makes the next submitter wait.
+//
+// The FTL maps logical pages (swap slots) to physical pages page by page.
+// Writes go round-robin over the dies into each die's open block. When a
+// die runs out of free blocks, greedy garbage collection relocates the
+// valid pages of the block with the fewest of them and erases it, keeping
+// the die busy meanwhile. Over-provisioning sets how much spare space GC
+// has to work with, and thereby the write amplification.
+
+typedef struct {
+    int channels;
+    int dies_per_channel;
+    int pages_per_block;
+    double op;              // over-provisioning, fraction of logical space
+    int queue_depth;
+
+    // Latencies in cycles
+    double read_lat;        // array read
+    double prog_lat;        // page program
+    double erase_lat;       // block erase
+    double xfer_lat;        // one page over the channel
+} SsdConfig;
+
+typedef struct {
+    int *free_blocks;       // stack of erased blocks (die-local numbers)
+    int nfree;
+    int open_block;         // block being written, -1 if none
+    int next_page;          // next page in the open block
+    double busy_until;
+} SsdDie;
+
+typedef struct Ssd {
+    SsdConfig cfg;
+    int ndies;
+    int blocks_per_die;
+    int logical_pages;
+
+    int *l2p;               // logical -> physical page, -1 if unmapped
+    int *p2l;               // physical -> logical page, -1 if invalid
+    int *valid;             // valid pages per block (global block numbers)
+    int *erases;            // erase count per block
+    unsigned char *full;    // block completely written, a GC candidate
+    SsdDie *dies;
+    double *chan_busy;      // per channel
+    int next_die;           // write striping
+
+    double *inflight;       // completion times of outstanding requests
+    int ninflight;
+
+    long long host_reads, host_writes, trims;
+    long long gc_runs, gc_copies, erase_count;
+    double gc_time;         // die time spent in GC
+    double queue_wait;      // submit delays from a full queue
+    double read_lat_sum, read_lat_max;
+} Ssd;
+
+void ssd_config_defaults(SsdConfig *sc);
+
+int  ssd_init(Ssd *ssd, const SsdConfig *sc, int logical_pages);
+void ssd_free(Ssd *ssd);
+
+// Submit a request at time `now`. Both return the completion time; *accepted
+// (if not NULL) is when the queue took the request.
+double ssd_read(Ssd *ssd, int lpn, double now, double *accepted);
+double ssd_write(Ssd *ssd, int lpn, double now, double *accepted);
+
+// The logical page no longer holds data
+void ssd_trim(Ssd *ssd, int lpn);
+
+void ssd_print_stats(const Ssd *ssd);
+
+#endif
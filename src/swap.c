@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+#include "swap.h"
+
+void swap_config_defaults(SwapConfig *sc) {
+    sc->slots = 0;
+    sc->cluster = 256;
+    sc->cpu_cache = 64;
+    sc->readahead = RA_SLOT;
+    sc->ra_pages = 8;
+    sc->max_io = 32;        // one reclaim batch (SWAP_CLUSTER_MAX)
+}
+
+int swap_init(Swap *sw, const SwapConfig *sc) {
+    Swap zero = {0};
+    *sw = zero;
+    sw->cfg = *sc;
+    size_t n = (size_t)sc->slots;
+    sw->nclusters = (sc->slots + sc->cluster - 1) / sc->cluster;
+
+    sw->owner = (unsigned long *)malloc(n * sizeof(unsigned long));
+    sw->cluster_used = (int *)calloc((size_t)sw->nclusters, sizeof(int));
+    sw->free_clusters = (int *)malloc((size_t)sw->nclusters * sizeof(int));
+    sw->listed = (unsigned char *)calloc((size_t)sw->nclusters, 1);
+    if (!sw->owner || !sw->cluster_used || !sw->free_clusters || !sw->listed ||
+        cuckoo_init(&sw->slot_of, n) != 0) {
+        swap_free(sw);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) sw->owner[i] = SWAP_FREE;
+
+    // Hand out low clusters first; cluster 0 starts as the current one
+    for (int c = sw->nclusters - 1; c >= 1; c--) {
+        sw->free_clusters[sw->nfree_clusters++] = c;
+        sw->listed[c] = 1;
+    }
+    sw->wr.next = sw->rd.next = -1;
+    sw->wr.cur_start = -1;
+    return 0;
+}
+
+void swap_free(Swap *sw) {
+    free(sw->owner);
+    free(sw->cluster_used);
+    free(sw->free_clusters);
+    free(sw->listed);
+    cuckoo_free(&sw->slot_of);
+    for (int c = 0; c < SWAP_MAX_CPUS; c++) free(sw->cpu[c].slots);
+    if (sw->ssd) {
+        ssd_free(sw->ssd);
+        free(sw->ssd);
+    }
+    if (sw->far) {
+        far_free(sw->far);
+        free(sw->far);
+    }
+
+    Swap zero = {0};
+    *sw = zero;
+}
+
+int swap_attach_ssd(Swap *sw, const SsdConfig *sc) {
+    sw->ssd = (Ssd *)malloc(sizeof(Ssd));
+    if (!sw->ssd) return -1;
+    if (ssd_init(sw->ssd, sc, sw->cfg.slots) != 0) {
+        free(sw->ssd);
+        sw->ssd = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int swap_attach_far(Swap *sw, const FarConfig *fc) {
+    sw->far = (Far *)malloc(sizeof(Far));
+    if (!sw->far) {
+        perror("Error allocating far memory");
+        return -1;
+    }
+    if (far_init(sw->far, fc) != 0) {
+        free(sw->far);
+        sw->far = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// ---- Slot allocation ----
+
+static int cluster_of(const Swap *sw, int slot) {
+    return slot / sw->cfg.cluster;
+}
+
+static int cluster_end(const Swap *sw, int c) {
+    int end = (c + 1) * sw->cfg.cluster;
+    return end < sw->cfg.slots ? end : sw->cfg.slots;
+}
+
+// Takes one slot from the global allocator: sequentially within the
+// current cluster, then from the next free cluster, and only when none is
+// left by scanning for holes.
+static int alloc_global(Swap *sw) {
+    for (;;) {
+        if (sw->cur_cluster >= 0) {
+            int end = cluster_end(sw, sw->cur_cluster);
+            while (sw->cur_next < end && sw->owner[sw->cur_next] != SWAP_FREE) {
+                sw->cur_next++;
+            }
+            if (sw->cur_next < end) {
+                sw->cluster_used[sw->cur_cluster]++;
+                return sw->cur_next++;
+            }
+        }
+        if (sw->nfree_clusters == 0) break;
+        sw->cur_cluster = sw->free_clusters[--sw->nfree_clusters];
+        sw->listed[sw->cur_cluster] = 0;
+        sw->cur_next = sw->cur_cluster * sw->cfg.cluster;
+    }
+
+    // Fragmented: any hole will do
+    sw->cur_cluster = -1;
+    for (int i = 0; i < sw->cfg.slots; i++) {
+        int s = (sw->scan + i) % sw->cfg.slots;
+        if (sw->owner[s] == SWAP_FREE) {
+            sw->scan = s + 1;
+            sw->cluster_used[cluster_of(sw, s)]++;
+            return s;
+        }
+    }
+    return -1;
+}
+
+static int alloc_slot(Swap *sw, int cpu) {
+    SwapSlotCache *pc = &sw->cpu[cpu % SWAP_MAX_CPUS];
+    if (!pc->slots) {
+        pc->slots = (int *)malloc((size_t)sw->cfg.cpu_cache * sizeof(int));
+        if (!pc->slots) return alloc_global(sw);
+    }
+    if (pc->n == 0) {
+        // Refill in one batch, then hand out in allocation order
+        int got = 0;
+        while (got < sw->cfg.cpu_cache) {
+            int s = alloc_global(sw);
+            if (s < 0) break;
+            pc->slots[got++] = s;
+            sw->owner[s] = SWAP_RESERVED;
+        }
+        for (int i = 0; i < got / 2; i++) {
+            int t = pc->slots[i];
+            pc->slots[i] = pc->slots[got - 1 - i];
+            pc->slots[got - 1 - i] = t;
+        }
+        pc->n = got;
+        if (got == 0) return -1;
+    }
+    return pc->slots[--pc->n];
+}
+
+static void free_slot(Swap *sw, int s) {
+    if (sw->ssd) ssd_trim(sw->ssd, s);
+    cuckoo_erase(&sw->slot_of, sw->owner[s]);
+    sw->owner[s] = SWAP_FREE;
+    sw->used--;
+
+    int c = cluster_of(sw, s);
+    if (--sw->cluster_used[c] == 0 && c != sw->cur_cluster && !sw->listed[c]) {
+        sw->free_clusters[sw->nfree_clusters++] = c;
+        sw->listed[c] = 1;
+    }
+}
+
+// ---- I/O accounting ----
+
+static void io_done(SwapIoStats *io, long start, long len) {
+    io->ios++;
+    io->pages += len;
+    if (start == io->next) io->sequential++;
+    io->next = start + len;
+
+    int b = 0;
+    while (b < SWAP_IO_BUCKETS - 1 && (2L << b) <= len) b++;
+    io->size_hist[b]++;
+}
+
+static void write_page(Swap *sw, int slot) {
+    SwapIoStats *io = &sw->wr;
+    if (io->cur_start >= 0 && slot == io->cur_start + io->cur_len &&
+        io->cur_len < sw->cfg.max_io) {
+        io->cur_len++;
+        return;
+    }
+    if (io->cur_start >= 0) io_done(io, io->cur_start, io->cur_len);
+    io->cur_start = slot;
+    io->cur_len = 1;
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Reads the given slots, merging adjacent ones into single I/Os
+static void read_slots(Swap *sw, int *slots, int n) {
+    qsort(slots, (size_t)n, sizeof(int), cmp_int);
+    int i = 0;
+    while (i < n) {
+        int j = i + 1;
+        while (j < n && slots[j] == slots[j - 1] + 1 && j - i < sw->cfg.max_io) j++;
+        io_done(&sw->rd, slots[i], j - i);
+        i = j;
+    }
+}
+
+// ---- Paging ----
+
+void swap_out(Simulator *sim, unsigned long key) {
+    Swap *sw = sim->swap;
+    if (cuckoo_find(&sw->slot_of, key) >= 0) {
+        sw->clean_evictions++;
+        return;
+    }
+
+    int s = alloc_slot(sw, sim->cpu);
+    if (s < 0) {
+        sw->full_failures++;
+        return;
+    }
+    sw->owner[s] = key;
+    cuckoo_insert(&sw->slot_of, key, s);
+    if (++sw->used > sw->peak_used) sw->peak_used = sw->used;
+    write_page(sw, s);
+
+    // Writes are asynchronous unless the device queue is full
+    if (sw->ssd || sw->far) {
+        double accepted;
+        if (sw->ssd) ssd_write(sw->ssd, s, sim->now, &accepted);
+        else accepted = far_write(sw->far, s, sim->now);
+        if (accepted > sim->now) {
+            sim->stats.write_stall += accepted - sim->now;
+            sim->now = accepted;
+        }
+    }
+}
+
+void swap_dirty(Swap *sw, unsigned long key) {
+    int s = cuckoo_find(&sw->slot_of, key);
+    if (s >= 0) free_slot(sw, s);
+}
+
+// A readahead candidate must be on swap and not already in memory
+static int want_page(Simulator *sim, unsigned long key) {
+    return sim_frame_of(sim, key) < 0 && !sim_in_swap_cache(sim, key);
+}
+
+void swap_in(Simulator *sim, unsigned long key) {
+    Swap *sw = sim->swap;
+    int s = cuckoo_find(&sw->slot_of, key);
+    sim->fault_done = sim->now + sim->cfg.disk_lat;
+    if (s < 0) {            // lost when swap was full
+        sw->lost_reads++;
+        return;
+    }
+
+    // A stable page's neighbours, in slots or keys, are unrelated pages
+    int alone = sw->cfg.readahead == RA_NONE || ksm_is_stable_key(key);
+    int ra = alone ? 1 : sw->cfg.ra_pages;
+    int slots[SWAP_RA_MAX];
+    int n = 0;
+    slots[n++] = s;
+
+    if (!alone && sw->cfg.readahead == RA_SLOT) {
+        // The aligned block of slots around the faulting one
+        int base = s & ~(ra - 1);
+        for (int t = base; t < base + ra && t < sw->cfg.slots; t++) {
+            unsigned long k = sw->owner[t];
+            if (t == s || k == SWAP_FREE || k == SWAP_RESERVED || ksm_is_stable_key(k) ||
+                !want_page(sim, k))
+                continue;
+            slots[n++] = t;
+            sim_swap_cache_add(sim, k, 1);
+        }
+    } else if (!alone && sw->cfg.readahead == RA_VMA) {
+        // The virtual pages around the faulting one
+        unsigned long base = key & ~(unsigned long)(ra - 1);
+        for (unsigned long k = base; k < base + (unsigned long)ra; k++) {
+            if (k == key) continue;
+            int t = cuckoo_find(&sw->slot_of, k);
+            if (t < 0 || !want_page(sim, k)) continue;
+            slots[n++] = t;
+            sim_swap_cache_add(sim, k, 1);
+        }
+    }
+    sw->ra_reads += n - 1;
+
+    // The fault waits for its own page; readahead completes in the background
+    if (sw->ssd) {
+        sim->fault_done = ssd_read(sw->ssd, s, sim->now, NULL);
+        for (int i = 1; i < n; i++) ssd_read(sw->ssd, slots[i], sim->now, NULL);
+    }
+    if (sw->far) sim->fault_done = far_read(sw->far, slots, n, sim->now);
+    read_slots(sw, slots, n);
+}
+
+// ---- Report ----
+
+static void print_io(const char *what, const SwapIoStats *io) {
+    printf("%s: %lld pages in %lld I/Os (%.2f pages/I/O, %.1f%% sequential)\n",
+           what, io->pages, io->ios,
+           io->ios > 0 ? (double)io->pages / (double)io->ios : 0.0,
+           io->ios > 0 ? 100.0 * (double)io->sequential / (double)io->ios : 0.0);
+    printf("  I/O sizes:");
+    for (int b = 0; b < SWAP_IO_BUCKETS; b++) {
+        if (b < SWAP_IO_BUCKETS - 1) printf(" %d-%d:%lld", 1 << b, (2 << b) - 1, io->size_hist[b]);
+        else printf(" %d+:%lld", 1 << b, io->size_hist[b]);
+    }
+    printf("\n");
+}
+
+void swap_print_stats(const Swap *sw) {
+    // Close the write I/O still being built
+    SwapIoStats wr = sw->wr;
+    if (wr.cur_start >= 0) io_done(&wr, wr.cur_start, wr.cur_len);
+
+    static const char *ra_names[] = { "none", "slot", "vma" };
+    printf("\n--- Swap ---\n");
+    printf("Swap space: %d slots in %d clusters of %d, %d used (%d peak)\n",
+           sw->cfg.slots, sw->nclusters, sw->cfg.cluster, sw->used, sw->peak_used);
+    print_io("Swap-out", &wr);
+    printf("Clean evictions (slot still valid): %lld\n", sw->clean_evictions);
+    if (sw->full_failures > 0) {
+        printf("Evictions with swap full (page lost): %lld\n", sw->full_failures);
+    }
+    print_io("Swap-in", &sw->rd);
+    if (sw->lost_reads > 0) {
+        printf("Major faults on lost pages (read at disk latency): %lld\n", sw->lost_reads);
+    }
+    printf("Readahead (%s, %d pages): %lld pages read, %lld used\n",
+           ra_names[sw->cfg.readahead], sw->cfg.ra_pages, sw->ra_reads, sw->ra_hits);
+    if (sw->ssd) ssd_print_stats(sw->ssd);
+    if (sw->far) far_print_stats(sw->far);
+}
@@ -0,0 +1,97 @@
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "cuckoo.h"
+#include "far.h"
+#include "ssd.h"
+
+// Swap space model. Evicted pages get a slot on the swap device. Slots are
+// handed out through small per-CPU caches that are refilled in batches
+// from the current cluster, so pages evicted together land next to each
+// other and their writes merge into large sequential I/Os. A page keeps
+// its slot after swap-in until it is written, so evicting it while still
+// clean costs no I/O. A major fault reads its slot plus a readahead window,
+// either the neighbouring slots or the neighbouring virtual pages; the
+// extra pages go to the swap cache, where a later fault is minor.
+
+struct Simulator;
+
+typedef enum { RA_NONE, RA_SLOT, RA_VMA } Readahead;
+
+typedef struct {
+    int slots;              // device size in pages
+    int cluster;            // slots per allocation cluster
+    int cpu_cache;          // slots per per-CPU cache
+    Readahead readahead;
+    int ra_pages;           // readahead window, a power of two
+    int max_io;             // largest I/O in pages; writes merge per reclaim batch
+} SwapConfig;
+
+#define SWAP_FREE       (~0UL)
+#define SWAP_RESERVED   (~0UL - 1)  // sitting in a per-CPU slot cache
+#define SWAP_RA_MAX     256
+#define SWAP_MAX_CPUS   64
+#define SWAP_IO_BUCKETS 8   // I/O size histogram: 1, 2-3, 4-7, ... pages
+
+typedef struct {
+    int *slots;
+    int n;
+} SwapSlotCache;
+
+typedef struct {
+    long long ios, pages, sequential;
+    long long size_hist[SWAP_IO_BUCKETS];
+    long next;              // slot after the last I/O, for sequentiality
+    long cur_start, cur_len;    // write I/O being built
+} SwapIoStats;
+
+typedef struct Swap {
+    SwapConfig cfg;
+    unsigned long *owner;   // slot -> page key, SWAP_FREE if unused
+    CuckooMap slot_of;      // page key -> slot
+
+    int nclusters;
+    int *cluster_used;      // slots in use (or cached) per cluster
+    int *free_clusters;     // stack of entirely free clusters
+    unsigned char *listed;  // cluster is on the free stack
+    int nfree_clusters;
+    int cur_cluster, cur_next;  // allocation point
+    int scan;               // fallback scan for fragmented space
+
+    SwapSlotCache cpu[SWAP_MAX_CPUS];
+
+    // Device models; without one a read costs disk_lat
+    Ssd *ssd;
+    Far *far;
+
+    int used, peak_used;
+    long long clean_evictions;  // evicted with a valid slot: no write
+    long long full_failures;    // evictions that found no free slot
+    long long lost_reads;       // major faults on pages with no slot
+    long long ra_reads, ra_hits;
+    SwapIoStats wr, rd;
+} Swap;
+
+void swap_config_defaults(SwapConfig *sc);
+
+int  swap_init(Swap *sw, const SwapConfig *sc);
+void swap_free(Swap *sw);
+
+// Puts the swap space on a modelled SSD
+int  swap_attach_ssd(Swap *sw, const SsdConfig *sc);
+
+// Puts the swap space in a remote node's memory
+int  swap_attach_far(Swap *sw, const FarConfig *fc);
+
+// A page leaves memory; writes it to a slot unless its swap copy is valid
+void swap_out(struct Simulator *sim, unsigned long key);
+
+// The page was written, so its copy on swap (if any) is stale
+void swap_dirty(Swap *sw, unsigned long key);
+
+// Major fault: reads the page and its readahead window
+void swap_in(struct Simulator *sim, unsigned long key);
+
+void swap_print_stats(const Swap *sw);
+
+#endif
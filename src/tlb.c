@@ -0,0 +1,108 @@
+#include <stdlib.h>
+
+#include "tlb.h"
+
+int tlb_init(TLB *tlb, int size) {
+    tlb->size = size;
+    tlb->nfree = size;
+    tlb->head = tlb->tail = -1;
+    tlb->entries = (TLBEntry *)calloc((size_t)size, sizeof(TLBEntry));
+    tlb->free_slots = (int *)malloc((size_t)size * sizeof(int));
+    if (!tlb->entries || !tlb->free_slots ||
+        cuckoo_init(&tlb->index, (size_t)size) != 0) {
+        return -1;
+    }
+    // Hand out slot 0 first
+    for (int i = 0; i < size; i++) tlb->free_slots[i] = size - 1 - i;
+    return 0;
+}
+
+void tlb_free(TLB *tlb) {
+    free(tlb->entries);
+    free(tlb->free_slots);
+    cuckoo_free(&tlb->index);
+}
+
+// ---- Recency list ----
+
+static void unlink_slot(TLB *tlb, int slot) {
+    TLBEntry *e = &tlb->entries[slot];
+    if (e->prev >= 0) tlb->entries[e->prev].next = e->next;
+    else tlb->head = e->next;
+    if (e->next >= 0) tlb->entries[e->next].prev = e->prev;
+    else tlb->tail = e->prev;
+}
+
+static void push_front(TLB *tlb, int slot) {
+    TLBEntry *e = &tlb->entries[slot];
+    e->prev = -1;
+    e->next = tlb->head;
+    if (tlb->head >= 0) tlb->entries[tlb->head].prev = slot;
+    else tlb->tail = slot;
+    tlb->head = slot;
+}
+
+static void touch(TLB *tlb, int slot) {
+    if (tlb->head == slot) return;
+    unlink_slot(tlb, slot);
+    push_front(tlb, slot);
+}
+
+// ---- Lookup and update ----
+
+int tlb_lookup(TLB *tlb, unsigned long vpn, int *out_frame) {
+    if (tlb->size <= 0) return 0;
+    int slot = cuckoo_find(&tlb->index, vpn);
+    if (slot < 0) return 0; // miss
+
+    touch(tlb, slot);
+    *out_frame = tlb->entries[slot].frame_index;
+    return 1; // hit
+}
+
+void tlb_insert(TLB *tlb, unsigned long vpn, int frame_index) {
+    if (tlb->size <= 0) return;
+
+    // If already there, update it
+    int slot = cuckoo_find(&tlb->index, vpn);
+    if (slot >= 0) {
+        tlb->entries[slot].frame_index = frame_index;
+        touch(tlb, slot);
+        return;
+    }
+
+    if (tlb->nfree > 0) {
+        // Use an empty slot
+        slot = tlb->free_slots[--tlb->nfree];
+    } else {
+        // Evict LRU entry
+        slot = tlb->tail;
+        unlink_slot(tlb, slot);
+        cuckoo_erase(&tlb->index, tlb->entries[slot].vpn);
+    }
+
+    tlb->entries[slot].valid = 1;
+    tlb->entries[slot].vpn = vpn;
+    tlb->entries[slot].frame_index = frame_index;
+    push_front(tlb, slot);
+    cuckoo_insert(&tlb->index, vpn, slot);
+}
+
+void tlb_invalidate_vpn(TLB *tlb, unsigned long vpn) {
+    if (tlb->size <= 0) return;
+    int slot = cuckoo_find(&tlb->index, vpn);
+    if (slot < 0) return;
+
+    tlb->entries[slot].valid = 0;
+    unlink_slot(tlb, slot);
+    cuckoo_erase(&tlb->index, vpn);
+    tlb->free_slots[tlb->nfree++] = slot;
+}
+
+void tlb_invalidate_frame(TLB *tlb, int frame_index) {
+    for (int i = 0; i < tlb->size; i++) {
+        if (tlb->entries[i].valid && tlb->entries[i].frame_index == frame_index) {
+            tlb_invalidate_vpn(tlb, tlb->entries[i].vpn);
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include "cuckoo.h"
+
+// Fully associative TLB with LRU replacement. Entries are found through a
+// cuckoo index and kept on a recency list, so neither lookups nor evictions
+// scan the whole TLB.
+
+typedef struct {
+    int valid;
+    unsigned long vpn;
+    int frame_index;
+    int prev, next;     // recency list neighbours, -1 at the ends
+} TLBEntry;
+
+typedef struct {
+    TLBEntry *entries;
+    int size;
+    int *free_slots;    // stack of invalid entries
+    int nfree;
+    int head, tail;     // most and least recently used valid entries
+    CuckooMap index;    // vpn -> entry slot
+} TLB;
+
+int  tlb_init(TLB *tlb, int size);
+void tlb_free(TLB *tlb);
+
+int  tlb_lookup(TLB *tlb, unsigned long vpn, int *out_frame);
+void tlb_insert(TLB *tlb, unsigned long vpn, int frame_index);
+void tlb_invalidate_vpn(TLB *tlb, unsigned long vpn);
+
+// Drops every entry that maps to frame_index (shared frames have several)
+void tlb_invalidate_frame(TLB *tlb, int frame_index);
+
+#endif
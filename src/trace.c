@@ -0,0 +1,351 @@
+#include <ctype.h>
+#include <stdlib.h>
+
+#include "merge.h"
+#include "sim.h"
+#include "trace.h"
+
+int trace_open(TraceReader *tr, const char *path, int collapse) {
+    TraceReader zero = {0};
+    *tr = zero;
+    tr->collapse = collapse;
+    tr->fp = fopen(path, "r");
+    return tr->fp ? 0 : -1;
+}
+
+int trace_open_merged(TraceReader *tr, char **paths, int k, int collapse) {
+    TraceReader zero = {0};
+    *tr = zero;
+    tr->collapse = collapse;
+    tr->merge = (TraceMerge *)malloc(sizeof(TraceMerge));
+    if (!tr->merge) return -1;
+    if (merge_open(tr->merge, paths, k) != 0) {
+        free(tr->merge);
+        tr->merge = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void list_free(SlotList *l) {
+    free(l->prev);
+    free(l->next);
+}
+
+static int list_init(SlotList *l, int n) {
+    l->head = l->tail = -1;
+    l->prev = (int *)malloc((size_t)n * sizeof(int));
+    l->next = (int *)malloc((size_t)n * sizeof(int));
+    return (l->prev && l->next) ? 0 : -1;
+}
+
+static void list_unlink(SlotList *l, int s) {
+    if (l->prev[s] != -1) l->next[l->prev[s]] = l->next[s];
+    else l->head = l->next[s];
+    if (l->next[s] != -1) l->prev[l->next[s]] = l->prev[s];
+    else l->tail = l->prev[s];
+}
+
+static void list_push_front(SlotList *l, int s) {
+    l->prev[s] = -1;
+    l->next[s] = l->head;
+    if (l->head != -1) l->prev[l->head] = s;
+    l->head = s;
+    if (l->tail == -1) l->tail = s;
+}
+
+void trace_close(TraceReader *tr) {
+    if (tr->fp) fclose(tr->fp);
+    tr->fp = NULL;
+    if (tr->merge) {
+        merge_close(tr->merge);
+        free(tr->merge);
+        tr->merge = NULL;
+    }
+
+    TraceFilter *f = tr->filter;
+    if (f) {
+        free(f->vpn);
+        free(f->dirty);
+        free(f->stale);
+        free(f->out);
+        list_free(&f->recency);
+        list_free(&f->emitted);
+        cuckoo_free(&f->index);
+        free(f);
+        tr->filter = NULL;
+    }
+}
+
+int trace_set_filter(TraceReader *tr, int entries) {
+    TraceFilter *f = (TraceFilter *)calloc(1, sizeof(TraceFilter));
+    if (!f) return -1;
+    tr->filter = f;
+
+    f->size  = entries;
+    f->vpn   = (unsigned long *)malloc((size_t)entries * sizeof(unsigned long));
+    f->dirty = (unsigned char *)calloc((size_t)entries, 1);
+    f->stale = (unsigned char *)calloc((size_t)entries, 1);
+    // A miss re-emits at most every other page, and a resync all of them
+    f->out   = (TraceRecord *)malloc((2 * (size_t)entries + 1) * sizeof(TraceRecord));
+    if (!f->vpn || !f->dirty || !f->stale || !f->out ||
+        list_init(&f->recency, entries) != 0 ||
+        list_init(&f->emitted, entries) != 0 ||
+        cuckoo_init(&f->index, (size_t)entries) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void filter_emit(TraceFilter *f, char op, unsigned long addr,
+                        unsigned long writes) {
+    TraceRecord *r = &f->out[f->out_len++];
+    r->op = op;
+    r->addr = addr;
+    r->count = 1;
+    r->writes = writes;
+    r->pc = 0;
+    r->has_content = 0;
+}
+
+// Re-emits slot e as the most recently emitted page
+static void filter_reemit(TraceReader *tr, TraceFilter *f, int e) {
+    filter_emit(f, 'R', f->vpn[e] * PAGE_SIZE, 0);
+    list_unlink(&f->emitted, e);
+    list_push_front(&f->emitted, e);
+    tr->reemitted++;
+}
+
+// Frees a slot for a new page, evicting the LRU page if the filter is full
+static int filter_slot(TraceFilter *f) {
+    if (f->used < f->size) return f->used++;
+    int s = f->recency.tail;
+    list_unlink(&f->recency, s);
+    list_unlink(&f->emitted, s);
+    cuckoo_erase(&f->index, f->vpn[s]);
+    return s;
+}
+
+static void filter_insert(TraceFilter *f, int s, unsigned long vpn, int dirty) {
+    f->vpn[s] = vpn;
+    f->dirty[s] = (unsigned char)dirty;
+    cuckoo_insert(&f->index, vpn, s);
+    list_push_front(&f->recency, s);
+    list_push_front(&f->emitted, s);
+}
+
+// Passes a record through while still tracking the LRU order; emitting
+// every access keeps the emitted order equal to it
+static void filter_pass(TraceReader *tr, TraceFilter *f, const TraceRecord *rec) {
+    unsigned long vpn = rec->addr / PAGE_SIZE;
+    int s = cuckoo_find(&f->index, vpn);
+    if (s >= 0) {
+        list_unlink(&f->recency, s);
+        list_unlink(&f->emitted, s);
+        list_push_front(&f->recency, s);
+        list_push_front(&f->emitted, s);
+        if (rec->writes > 0) f->dirty[s] = 1;
+    } else {
+        filter_insert(f, filter_slot(f), vpn, rec->writes > 0);
+    }
+    f->out[f->out_len++] = *rec;
+    tr->passed++;
+    if (--f->pass == 0) f->in_records = f->out_records = 0;
+}
+
+// Runs one input record through the filter, queueing what must be emitted.
+// Returns the number of input accesses dropped.
+static unsigned long filter_access(TraceReader *tr, const TraceRecord *rec) {
+    TraceFilter *f = tr->filter;
+    f->out_len = f->out_pos = 0;
+    if (f->pass > 0) {
+        filter_pass(tr, f, rec);
+        return 0;
+    }
+
+    unsigned long vpn = rec->addr / PAGE_SIZE;
+    int s = cuckoo_find(&f->index, vpn);
+    unsigned long dropped;
+    if (s >= 0) {
+        list_unlink(&f->recency, s);
+        list_push_front(&f->recency, s);
+        if (rec->writes > 0 && !f->dirty[s]) {
+            f->dirty[s] = 1;
+            filter_emit(f, 'D', rec->addr, 0);
+        }
+        dropped = rec->count;
+    } else {
+        if (f->used == f->size) {
+            // Pages emitted before the LRU page were touched after it, so
+            // they must be emitted again before it leaves. Starting from
+            // the least recently touched of them, re-emit every page
+            // touched later, oldest touch first: the LRU page is then the
+            // least recently emitted, and the emitted order of the rest
+            // follows their touches.
+            int lru = f->recency.tail;
+            int stale = 0;
+            for (int e = f->emitted.tail; e != lru; e = f->emitted.prev[e]) {
+                f->stale[e] = 1;
+                stale++;
+            }
+            int started = 0;
+            for (int e = f->recency.prev[lru]; e != -1 && stale > 0; e = f->recency.prev[e]) {
+                if (f->stale[e]) {
+                    f->stale[e] = 0;
+                    started = 1;
+                }
+                if (started) filter_reemit(tr, f, e);
+            }
+        }
+        filter_insert(f, filter_slot(f), vpn, rec->writes > 0);
+
+        // Only the first access of a run can miss; the rest are dropped,
+        // with any of their writes moved onto the emitted access.
+        filter_emit(f, rec->writes > 0 ? 'W' : 'R', rec->addr, rec->writes > 0);
+        f->out[f->out_len - 1].pc = rec->pc;
+        dropped = rec->count - 1;
+    }
+
+    // Filtering that no longer pays is stopped for a while, after putting
+    // the emitted order back to the LRU order
+    f->in_records++;
+    f->out_records += f->out_len;
+    if (f->out_records - f->in_records > f->size) {
+        for (int e = f->recency.tail; e != -1; e = f->recency.prev[e]) filter_reemit(tr, f, e);
+        f->pass = (long)TRACE_FILTER_PASS * f->size;
+    }
+    return dropped;
+}
+
+static int is_access(char op) {
+    return op == 'R' || op == 'W';
+}
+
+static int parse_line(const char *p, TraceRecord *rec) {
+    char *end;
+
+    while (isspace((unsigned char)*p)) p++;
+    if (!*p || *p == '#') return 0;
+    if (*p == '@') {
+        p++;
+        rec->ts = strtoull(p, &end, 10);
+        if (end == p) return -1;
+        p = end;
+        while (isspace((unsigned char)*p)) p++;
+    }
+    rec->pc = 0;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        rec->pc = strtoul(p, &end, 16);
+        if (end == p || *end != ':') return -1;
+        p = end + 1;
+        while (isspace((unsigned char)*p)) p++;
+    }
+    rec->op = *p++;
+
+    rec->addr = strtoul(p, &end, 16);
+    if (end == p) return -1;
+    p = end;
+
+    rec->count = 1;
+    rec->writes = (rec->op == 'W') ? 1 : 0;
+
+    unsigned long count = strtoul(p, &end, 10);
+    if (end != p) {
+        p = end;
+        unsigned long writes = strtoul(p, &end, 10);
+        if (end == p || count == 0 || writes > count) return -1;
+        rec->count = count;
+        rec->writes = writes;
+    }
+
+    rec->has_content = 0;
+    while (isspace((unsigned char)*p)) p++;
+    if (*p == '=') {
+        p++;
+        rec->content = strtoull(p, &end, 16);
+        if (end == p) return -1;
+        rec->has_content = 1;
+    }
+    return 1;
+}
+
+static int read_line(TraceReader *tr, TraceRecord *rec) {
+    if (tr->merge) {
+        if (!merge_next(tr->merge, rec)) return 0;
+        if (is_access(rec->op)) tr->accesses += (long long)rec->count;
+        return 1;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), tr->fp)) {
+        rec->ts = tr->last_ts;
+        rec->src = 0;
+        int r = parse_line(line, rec);
+        if (r > 0) {
+            tr->last_ts = rec->ts;
+            if (is_access(rec->op)) tr->accesses += (long long)rec->count;
+            return 1;
+        }
+        if (r < 0) return 0;    // malformed line ends the trace
+    }
+    return 0;
+}
+
+static int read_raw(TraceReader *tr, TraceRecord *rec) {
+    TraceFilter *f = tr->filter;
+    if (!f) return read_line(tr, rec);
+
+    while (f->out_pos >= f->out_len) {
+        if (!read_line(tr, rec)) return 0;
+        if (!is_access(rec->op)) return 1;
+        tr->filtered += (long long)filter_access(tr, rec);
+        for (int i = 0; i < f->out_len; i++) {
+            f->out[i].ts = rec->ts;
+            f->out[i].src = rec->src;
+        }
+    }
+    *rec = f->out[f->out_pos++];
+    return 1;
+}
+
+int trace_next(TraceReader *tr, TraceRecord *rec) {
+    if (tr->has_pending) {
+        *rec = tr->pending;
+        tr->has_pending = 0;
+    } else if (!read_raw(tr, rec)) {
+        return 0;
+    }
+
+    if (tr->collapse && is_access(rec->op)) {
+        TraceRecord next;
+        while (read_raw(tr, &next)) {
+            if (!is_access(next.op) || next.src != rec->src ||
+                next.addr / PAGE_SIZE != rec->addr / PAGE_SIZE) {
+                tr->pending = next;
+                tr->has_pending = 1;
+                break;
+            }
+            rec->count  += next.count;
+            rec->writes += next.writes;
+            if (next.writes > 0 || next.has_content) {
+                rec->has_content = next.has_content;
+                rec->content = next.content;
+            }
+        }
+    }
+
+    tr->records++;
+    return 1;
+}
+
+void trace_write(FILE *out, const TraceRecord *rec) {
+    if (rec->pc) fprintf(out, "0x%lx: ", rec->pc);
+    if (rec->count == 1) {
+        fprintf(out, "%c 0x%lx", rec->op, rec->addr);
+    } else {
+        fprintf(out, "%c 0x%lx %lu %lu", rec->op, rec->addr,
+                rec->count, rec->writes);
+    }
+    if (rec->has_content) fprintf(out, " =%llx", rec->content);
+    fputc('\n', out);
+}
@@ -0,0 +1,105 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+#include "cuckoo.h"
+
+// Trace records. A plain line "R 0x1000" is one access. A run line
+// "R 0x1000 37 5" stands for 37 consecutive accesses to the page of
+// 0x1000, starting with a read, 5 of which are writes. "D 0x1000" marks
+// an already resident page dirty without counting as an access; filtered
+// traces use it for writes whose access was dropped. Lines starting with
+// '#' are comments. Any record may be prefixed with a decimal timestamp,
+// "@1234 R 0x1000"; records without one inherit the previous timestamp of
+// their file. Timestamps are only used to merge several traces. A record
+// may end with "=<hex>", the content hash of the page after the access
+// ("=0" for a zero page), for the same-page merging model. An access may
+// name the instruction that made it, as in pinatrace output: the PC comes
+// first, in hex with a colon, "0x4005d0: R 0x1000" (after any timestamp).
+// A run keeps the PC of its first access, the only one that can fault.
+
+typedef struct {
+    char op;                // op of the first access
+    unsigned long addr;     // address of the first access
+    unsigned long count;    // accesses in the record (1 for plain lines)
+    unsigned long writes;   // of which writes
+    unsigned long pc;       // instruction of the first access, 0 if unknown
+    unsigned long long ts;  // timestamp, 0 if the file has none
+    int src;                // input the record came from when merging
+    int has_content;
+    unsigned long long content; // page content hash after the record
+} TraceRecord;
+
+// Doubly linked list over filter slots; head is newest, tail oldest
+typedef struct {
+    int *prev, *next;
+    int head, tail;
+} SlotList;
+
+// Small fully associative LRU used to drop accesses that would hit in it.
+// Misses are emitted, but the emitted stream must also agree with the true
+// LRU order whenever the filter evicts: before the LRU page leaves, pages
+// that were touched more recently but emitted earlier are re-emitted. The
+// LRU stack below the filter's depth then evolves exactly as in the full
+// trace, so LRU memories at least as large as the filter see identical
+// faults and dirty evictions.
+//
+// Re-emission starts at the least recently touched page that is out of
+// order and covers every page touched after it, so those pages are not
+// found out of order again one eviction later. When a stretch of trace
+// still comes out more than a filter's worth of records longer than it
+// went in, the filter re-emits everything in LRU order and passes the
+// next TRACE_FILTER_PASS filter sizes of records through unchanged, which
+// keeps the order exact for free; the output then never grows by more
+// than a few percent.
+#define TRACE_FILTER_PASS 64
+
+typedef struct {
+    int size;
+    int used;
+    unsigned long *vpn;
+    unsigned char *dirty;   // write already reported since the page entered
+    unsigned char *stale;   // scratch: needs re-emitting before an eviction
+    SlotList recency;       // true LRU order
+    SlotList emitted;       // order of the last emitted reference
+    CuckooMap index;        // vpn -> slot
+
+    TraceRecord *out;       // records produced by the last input access
+    int out_len, out_pos;
+    long long in_records, out_records;  // since filtering last resumed
+    long pass;              // records left to pass through unfiltered
+} TraceFilter;
+
+struct TraceMerge;
+
+typedef struct {
+    FILE *fp;
+    struct TraceMerge *merge;   // set when reading several merged inputs
+    unsigned long long last_ts;
+    int collapse;           // merge consecutive same-page accesses into runs
+    TraceFilter *filter;    // optional LRU pre-filter
+    long long filtered;     // accesses dropped by the filter
+    long long reemitted;    // records the filter emitted to restore LRU order
+    long long passed;       // records the filter passed through unfiltered
+    int has_pending;
+    TraceRecord pending;
+    long long records;      // records returned so far
+    long long accesses;     // accesses read from the trace file
+} TraceReader;
+
+int  trace_open(TraceReader *tr, const char *path, int collapse);
+
+// Reads k traces merged by timestamp as if they were one
+int  trace_open_merged(TraceReader *tr, char **paths, int k, int collapse);
+void trace_close(TraceReader *tr);
+
+// Routes the trace through an LRU filter of `entries` pages
+int  trace_set_filter(TraceReader *tr, int entries);
+
+// Returns 1 and fills rec, or 0 at end of trace / first malformed line.
+int  trace_next(TraceReader *tr, TraceRecord *rec);
+
+void trace_write(FILE *out, const TraceRecord *rec);
+
+#endif
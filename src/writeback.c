@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+#include "writeback.h"
+
+void writeback_config_defaults(WritebackConfig *wc) {
+    wc->background_ratio = 0.10;
+    wc->ratio = 0.20;
+    wc->expire = 30000;
+    wc->write_lat = 100000.0;   // a page of sequential writeback
+}
+
+int writeback_init(Writeback *wb, const WritebackConfig *wc, int num_frames) {
+    Writeback zero = {0};
+    *wb = zero;
+    wb->cfg = *wc;
+
+    wb->background = (int)(wc->background_ratio * num_frames);
+    wb->limit = (int)(wc->ratio * num_frames);
+    if (wb->background < 1) wb->background = 1;
+    if (wb->limit <= wb->background) wb->limit = wb->background + 1;
+    wb->freerun = (wb->background + wb->limit) / 2;
+
+    wb->qcap = num_frames > 16 ? num_frames : 16;
+    wb->queue = (DirtyEntry *)malloc((size_t)wb->qcap * sizeof(DirtyEntry));
+    wb->gen = (unsigned long *)calloc((size_t)num_frames, sizeof(unsigned long));
+    wb->dirtied_at = (unsigned long *)calloc((size_t)num_frames, sizeof(unsigned long));
+    if (!wb->queue || !wb->gen || !wb->dirtied_at) {
+        writeback_free(wb);
+        return -1;
+    }
+    return 0;
+}
+
+void writeback_free(Writeback *wb) {
+    free(wb->queue);
+    free(wb->gen);
+    free(wb->dirtied_at);
+
+    Writeback zero = {0};
+    *wb = zero;
+}
+
+// ---- Dirty queue ----
+
+static int entry_live(const Simulator *sim, const DirtyEntry *e) {
+    return ft_dirty(&sim->ft, e->f) && sim->wb->gen[e->f] == e->gen;
+}
+
+// Drops stale entries; grows the queue only if it is still half full
+static int make_room(Simulator *sim, Writeback *wb) {
+    int n = 0;
+    for (int i = 0; i < wb->qlen; i++) {
+        DirtyEntry e = wb->queue[(wb->qhead + i) % wb->qcap];
+        if (entry_live(sim, &e)) wb->queue[(wb->qhead + n++) % wb->qcap] = e;
+    }
+    wb->qlen = n;
+    if (n < wb->qcap / 2) return 0;
+
+    int cap = wb->qcap * 2;
+    DirtyEntry *q = (DirtyEntry *)malloc((size_t)cap * sizeof(DirtyEntry));
+    if (!q) return -1;
+    for (int i = 0; i < n; i++) q[i] = wb->queue[(wb->qhead + i) % wb->qcap];
+    free(wb->queue);
+    wb->queue = q;
+    wb->qcap = cap;
+    wb->qhead = 0;
+    return 0;
+}
+
+// Oldest frame that is still dirty since it was queued, or -1
+static int oldest(Simulator *sim, Writeback *wb) {
+    while (wb->qlen > 0) {
+        const DirtyEntry *e = &wb->queue[wb->qhead];
+        if (entry_live(sim, e)) return e->f;
+        wb->qhead = (wb->qhead + 1) % wb->qcap;
+        wb->qlen--;
+    }
+    return -1;
+}
+
+// Queues one page write behind the others; returns when it completes
+static double disk_write(Simulator *sim, Writeback *wb) {
+    double start = wb->disk_free > sim->now ? wb->disk_free : sim->now;
+    wb->disk_free = start + wb->cfg.write_lat;
+    return wb->disk_free;
+}
+
+// Writes frame f back. The page stays resident, now clean.
+static double flush(Simulator *sim, Writeback *wb, int f) {
+    ft_set_dirty(&sim->ft, f, 0);
+    wb->ndirty--;
+    return disk_write(sim, wb);
+}
+
+// ---- Hooks ----
+
+void writeback_dirtied(Simulator *sim, int f) {
+    Writeback *wb = sim->wb;
+    if (wb->qlen == wb->qcap && make_room(sim, wb) != 0) {
+        perror("Error growing dirty page queue");
+        exit(1);
+    }
+    wb->gen[f] = ++wb->next_gen;
+    wb->dirtied_at[f] = sim->tick;
+    DirtyEntry e = { f, wb->gen[f] };
+    wb->queue[(wb->qhead + wb->qlen++) % wb->qcap] = e;
+
+    wb->ndirty++;
+    if (wb->ndirty > wb->peak_dirty) wb->peak_dirty = wb->ndirty;
+
+    if (wb->ndirty > wb->limit) {
+        // Blocked until the disk has written the oldest page for us
+        double done = flush(sim, wb, oldest(sim, wb));
+        wb->flushed_background++;
+        wb->blocked++;
+        wb->throttle_wait += done - sim->now;
+        sim->now = done;
+    } else if (wb->ndirty > wb->freerun) {
+        // Pause longer the closer the writer gets to the limit
+        double pause = wb->cfg.write_lat * (double)(wb->ndirty - wb->freerun) /
+                       (double)(wb->limit - wb->freerun);
+        wb->throttled++;
+        wb->throttle_wait += pause;
+        sim->now += pause;
+    }
+}
+
+void writeback_cleaned(Writeback *wb) {
+    wb->ndirty--;
+}
+
+void writeback_evict(Simulator *sim, int dirty) {
+    Writeback *wb = sim->wb;
+    wb->evictions++;
+    if (!dirty) return;
+
+    wb->dirty_evictions++;
+    double done = disk_write(sim, wb);
+    wb->evict_wait += done - sim->now;
+    sim->now = done;
+}
+
+void writeback_tick(Simulator *sim) {
+    Writeback *wb = sim->wb;
+    while (wb->disk_free <= sim->now) {
+        int f = oldest(sim, wb);
+        if (f < 0) break;
+        if (wb->ndirty > wb->background) {
+            wb->flushed_background++;
+        } else if (sim->tick - wb->dirtied_at[f] >= (unsigned long)wb->cfg.expire) {
+            wb->flushed_expired++;
+        } else {
+            break;
+        }
+        // The flusher runs beside the workload and only occupies the disk
+        flush(sim, wb, f);
+    }
+}
+
+// ---- Report ----
+
+void writeback_print_stats(const Writeback *wb, const Simulator *sim) {
+    int frames = sim->cfg.num_frames;
+    long long flushed = wb->flushed_background + wb->flushed_expired;
+    long long written = flushed + wb->dirty_evictions;
+    long long accesses = sim->stats.reads + sim->stats.writes;
+
+    printf("\n--- Dirty writeback ---\n");
+    printf("Thresholds: background %d pages (%.0f%%), throttling from %d, "
+           "limit %d (%.0f%%), expiry %ld accesses\n",
+           wb->background, 100.0 * wb->background / frames, wb->freerun,
+           wb->limit, 100.0 * wb->limit / frames, wb->cfg.expire);
+    printf("Dirty pages: %d now, %d peak\n", wb->ndirty, wb->peak_dirty);
+    printf("Pages written: %lld (%lld by the flusher: %lld over background, "
+           "%lld expired; %lld on eviction)\n", written, flushed,
+           wb->flushed_background, wb->flushed_expired, wb->dirty_evictions);
+    printf("Writeback bandwidth: %.2f pages per 1000 accesses, %.1f bytes per 1000 cycles\n",
+           accesses > 0 ? 1000.0 * (double)written / (double)accesses : 0.0,
+           sim->now > 0.0 ? 1000.0 * (double)written * PAGE_SIZE / sim->now : 0.0);
+    printf("Writers throttled: %lld paused, %lld blocked at the limit, "
+           "%.0f cycles (%.2f%% of time)\n", wb->throttled, wb->blocked,
+           wb->throttle_wait,
+           sim->now > 0.0 ? 100.0 * wb->throttle_wait / sim->now : 0.0);
+    printf("Evictions: %lld, %lld dirty (%.1f%%), %.0f cycles average wait "
+           "for the victim's write\n", wb->evictions, wb->dirty_evictions,
+           wb->evictions > 0 ? 100.0 * (double)wb->dirty_evictions / (double)wb->evictions : 0.0,
+           wb->evictions > 0 ? wb->evict_wait / (double)wb->evictions : 0.0);
+}
@@ -0,0 +1,71 @@
+#ifndef WRITEBACK_H
+#define WRITEBACK_H
+
+// Dirty page throttling and background writeback for write-back mode,
+// after the kernel's dirty_background_ratio / dirty_ratio. A flusher
+// writes dirty pages oldest first, one at a time on the backing disk, while
+// more than the background threshold are dirty, and otherwise writes pages
+// that have been dirty longer than the expiry time. A writer dirtying a
+// page above the midpoint of the two thresholds pauses in proportion to
+// how close it is to the limit; at the limit it waits until the disk has
+// written a page for it. Evicting a dirty page writes it synchronously,
+// behind whatever writeback the disk is busy with.
+//
+// This is the only part of the simulator that needs wall time without a
+// device model, so it turns on the clock: accesses advance it by their
+// latency and a major fault by disk_lat.
+
+struct Simulator;
+
+typedef struct {
+    double background_ratio;    // flusher starts above this share of memory
+    double ratio;               // writers block at this share
+    long expire;                // accesses before a dirty page is written anyway
+    double write_lat;           // cycles for the disk to write one page
+} WritebackConfig;
+
+typedef struct {
+    int f;
+    unsigned long gen;          // matches the frame's dirtying generation
+} DirtyEntry;
+
+typedef struct Writeback {
+    WritebackConfig cfg;
+    int background, limit, freerun; // in pages
+    int ndirty;
+
+    // Dirty frames in dirtying order; stale entries are skipped lazily
+    DirtyEntry *queue;
+    int qhead, qlen, qcap;
+    unsigned long *gen;         // per frame, bumped each time it is dirtied
+    unsigned long *dirtied_at;  // per frame, tick it was dirtied
+    unsigned long next_gen;
+
+    double disk_free;           // when the disk finishes queued writes
+
+    long long flushed_background, flushed_expired;
+    long long throttled, blocked;
+    long long evictions, dirty_evictions;
+    int peak_dirty;
+    double throttle_wait;       // cycles writers spent paused or blocked
+    double evict_wait;          // cycles faults spent writing their victim
+} Writeback;
+
+void writeback_config_defaults(WritebackConfig *wc);
+
+int  writeback_init(Writeback *wb, const WritebackConfig *wc, int num_frames);
+void writeback_free(Writeback *wb);
+
+// Frame f went from clean to dirty (may throttle the writer) or back
+void writeback_dirtied(struct Simulator *sim, int f);
+void writeback_cleaned(Writeback *wb);
+
+// An eviction; a dirty victim is written before its frame is reused
+void writeback_evict(struct Simulator *sim, int dirty);
+
+// Lets the flusher start writes the disk has room for
+void writeback_tick(struct Simulator *sim);
+
+void writeback_print_stats(const Writeback *wb, const struct Simulator *sim);
+
+#endif